@@ -7,15 +7,26 @@
 #include <prism/core/archive_remover.h>
 #include <prism/core/archive_verifier.h>
 #include <prism/core/archive_propertier.h>
+#include <prism/core/archive_index.h>
+#include <prism/core/metadata_codec.h>
 #include <prism/core/result_types.h>
 #include <prism/core/file_utils.h>
+#include <prism/core/metrics.h>
+#include <prism/core/memory_budget.h>
+#include <prism/core/codec_benchmark.h>
 #include <iostream>
+#include <fstream>
+#include <sstream>
 #include <chrono>
 #include <stdexcept>
 #include <any>
+#include <algorithm>
+#include <iomanip>
 
 #ifdef _WIN32
 #include <windows.h>
+#include <io.h>
+#include <fcntl.h>
 #endif
 
 namespace prism {
@@ -165,12 +176,15 @@ void cli_log_handler(const std::string& msg, int level) {
 
 void print_version() {
     std::cout << "Version: 1.1 build 240" << std::endl;
-    std::cout << "Archive format Version: 2" << std::endl;
+    std::cout << "Archive format Version: " << core::ARCHIVE_VERSION << std::endl;
 }
 
 void print_usage();
 void print_command_help(const std::string& command);
 void print_extra_info(const std::string& command, int num_threads, core::CompressionType comp_type, int comp_level, core::HashType hash_type, const std::any& result);
+bool write_metrics_json(const std::string& target, const std::string& command, int num_threads, long long elapsed_ms, const std::any& result);
+void print_codec_benchmark(const core::CodecBenchmarkResult& result, const core::CodecBenchmarkOptions& options);
+bool parse_size_arg(const std::string& text, uint64_t& size);
 
 
 int run_cli(int argc, char* argv[]) {
@@ -224,6 +238,12 @@ int run_cli(int argc, char* argv[]) {
         bool no_preserve_props = false; 
         int num_threads = 1;
         bool solid_mode = false;
+        bool group_small_files = true;
+        bool plain_metadata = false;
+        std::string metrics_json_path;
+        std::string entry_name;
+        bool to_stdout = false;
+        core::CodecBenchmarkOptions bench_options;
         
         for (int i = 3; i < argc; i++) {
             std::string arg = argv[i];
@@ -252,8 +272,18 @@ int run_cli(int argc, char* argv[]) {
                 is_detailed_en = true;
             } else if (arg == "-s" || arg == "--solid") {
                 solid_mode = true;
+            } else if (arg == "--no-group") {
+                group_small_files = false;
+            } else if (arg == "--plain-metadata") {
+                plain_metadata = true;
             } else if (arg == "--full") {
                 use_full_path = true;
+            } else if (arg == "--name" && i + 1 < argc) {
+                entry_name = argv[++i];
+            } else if (arg == "--to-stdout") {
+                to_stdout = true;
+            } else if (arg == "--metrics-json" && i + 1 < argc) {
+                metrics_json_path = argv[++i];
             } else if (arg == "--exclude" && i + 1 < argc) {
                 exclude_patterns.push_back(argv[++i]);
             } else if (arg == "--threads" && i + 1 < argc) {
@@ -262,6 +292,41 @@ int run_cli(int argc, char* argv[]) {
                     err("Error: Number of threads must be at least 1");
                     return 1;
                 }
+            } else if (arg == "--memory-limit" && i + 1 < argc) {
+                uint64_t memory_limit = 0;
+                if (!parse_size_arg(argv[++i], memory_limit) || memory_limit == 0) {
+                    err("Error: Invalid memory limit '" + std::string(argv[i]) + "'");
+                    return 1;
+                }
+                core::MemoryBudget::global().set_limit(memory_limit);
+            } else if (command == "bench" && arg == "-c" && i + 1 < argc) {
+                std::stringstream list(argv[++i]);
+                std::string comp_str;
+                while (std::getline(list, comp_str, ',')) {
+                    if (!core::COMPRESSION_MAP.count(comp_str)) {
+                        err("Error: Invalid compression type '" + comp_str + "'");
+                        return 1;
+                    }
+                    bench_options.codecs.push_back(core::COMPRESSION_MAP.at(comp_str));
+                }
+            } else if (command == "bench" && arg == "-l" && i + 1 < argc) {
+                std::stringstream list(argv[++i]);
+                std::string level_str;
+                while (std::getline(list, level_str, ',')) {
+                    int level = std::atoi(level_str.c_str());
+                    if (level < 0 || level > 9) {
+                        err("Error: Compression level must be between 0 and 9");
+                        return 1;
+                    }
+                    bench_options.levels.push_back(level);
+                }
+            } else if (arg == "--sample-size" && i + 1 < argc) {
+                if (!parse_size_arg(argv[++i], bench_options.sample_bytes) || bench_options.sample_bytes == 0) {
+                    err("Error: Invalid sample size '" + std::string(argv[i]) + "'");
+                    return 1;
+                }
+            } else if (arg == "--target-mbps" && i + 1 < argc) {
+                bench_options.target_mbps = std::atof(argv[++i]);
             } else if (arg == "-c" && i + 1 < argc) {
                 std::string comp_str = argv[++i];
                 if (core::COMPRESSION_MAP.count(comp_str)) {
@@ -287,7 +352,7 @@ int run_cli(int argc, char* argv[]) {
                 }
             } else if (arg == "-o" && i + 1 < argc) {
                 output_dir = argv[++i];
-            } else if (arg[0] != '-') {
+            } else if (arg[0] != '-' || arg == "-") {
                 paths.push_back(arg);
             } else {
                 err("Error: Unknown option '" + arg + "'");
@@ -295,29 +360,87 @@ int run_cli(int argc, char* argv[]) {
             }
         }
         
+        // '-' as the only input of create reads the entry from stdin; --name or
+        // an archive of '-' without inputs implies it. An archive named '-' or --to-stdout makes stdout
+        // the data channel, so nothing else may be printed there.
+        bool stdin_input = command == "create" && ((paths.size() == 1 && paths[0] == "-") || (paths.empty() && (!entry_name.empty() || archive_file == "-")));
+        bool stdout_is_data = (command == "create" && archive_file == "-") || (command == "extract" && to_stdout);
+        if (archive_file == "-" && !(command == "create" && stdin_input)) {
+            err("Error: An archive on stdout is only supported for 'create' reading from stdin");
+            return 1;
+        }
+        if (stdout_is_data) {
+            is_output_en = false;
+            is_sum_en = false;
+            is_verb_en = false;
+            is_raw_output_en = false;
+            is_extra_info_en = false;
+            if (metrics_json_path == "-") {
+                err("Error: --metrics-json cannot use stdout while it carries archive data");
+                return 1;
+            }
+        }
+#ifdef _WIN32
+        if (stdin_input) _setmode(_fileno(stdin), _O_BINARY);
+        if (stdout_is_data) _setmode(_fileno(stdout), _O_BINARY);
+#endif
+
         core::set_progress_bar_detailed(is_detailed_en);
+        core::set_compact_metadata(!plain_metadata);
+
+        // Let the library skip building messages this handler would drop anyway.
+        core::set_log_level_enabled(core::LOG_INFO, !is_raw_output_en && is_output_en);
+        core::set_log_level_enabled(core::LOG_SUCCESS, !is_raw_output_en && is_output_en);
+        core::set_log_level_enabled(core::LOG_SUM, is_raw_output_en || is_sum_en);
+        core::set_log_level_enabled(core::LOG_WARN, is_raw_output_en || is_warn_en);
+        core::set_log_level_enabled(core::LOG_ERROR, is_raw_output_en || is_err_en);
+        core::set_log_level_enabled(core::LOG_VERBOSE, !is_raw_output_en && is_verb_en);
+        core::set_log_level_enabled(core::LOG_DEBUG, !is_raw_output_en && is_verb_en);
+        core::Metrics::global().set_enabled(!metrics_json_path.empty());
         
         std::any result;
     
         try {
-            if (command == "create") {
+            if (command == "create" && stdin_input) {
+                if (archive_file == "-") {
+                    result = core::create_archive_from_stream(std::cin, std::cout, entry_name.empty() ? "stdin" : entry_name, comp_type, comp_level, hash_type, num_threads);
+                } else {
+                    std::ofstream out(archive_file, std::ios::binary);
+                    if (!out) {
+                        err("Error: Cannot create archive file: " + archive_file);
+                        return 1;
+                    }
+                    result = core::create_archive_from_stream(std::cin, out, entry_name.empty() ? "stdin" : entry_name, comp_type, comp_level, hash_type, num_threads);
+                    out.close();
+                    core::write_archive_index(archive_file);
+                }
+            } else if (command == "create") {
                 if (paths.empty()) { print_command_help("create"); return 1; }
-                result = core::create_archive(archive_file, paths, comp_type, comp_level, hash_type, ignore_errors, exclude_patterns, use_full_path, auto_yes, num_threads, is_raw_output_en, use_basic_chars, solid_mode);
+                result = core::create_archive(archive_file, paths, comp_type, comp_level, hash_type, ignore_errors, exclude_patterns, use_full_path, auto_yes, num_threads, is_raw_output_en, use_basic_chars, solid_mode, group_small_files);
             } else if (command == "append") {
                 if (paths.empty()) { print_command_help("append"); return 1; }
-                result = core::append_to_archive(archive_file, paths, comp_type, comp_level, hash_type, ignore_errors, exclude_patterns, use_full_path, auto_yes, num_threads, is_raw_output_en, use_basic_chars, solid_mode);
+                result = core::append_to_archive(archive_file, paths, comp_type, comp_level, hash_type, ignore_errors, exclude_patterns, use_full_path, auto_yes, num_threads, is_raw_output_en, use_basic_chars, solid_mode, group_small_files);
             } else if (command == "list") {
                 core::list_archive(archive_file, false); 
             } else if (command == "prop") {
                 if (paths.empty()) { print_command_help("prop"); return 1; }
                 core::get_properties(archive_file, paths[0], auto_yes);
+            } else if (command == "extract" && to_stdout) {
+                result = core::extract_to_stream(archive_file, paths, std::cout, no_verify);
             } else if (command == "extract") {
                 result = core::extract_archive(archive_file, output_dir, paths, no_overwrite, no_verify, num_threads, is_raw_output_en, use_basic_chars, no_preserve_props);
             } else if (command == "remove") {
                 if (paths.empty()) { print_command_help("remove"); return 1; }
-                core::remove_from_archive(archive_file, paths, ignore_errors, is_raw_output_en, use_basic_chars);
+                core::remove_from_archive(archive_file, paths, ignore_errors, is_raw_output_en, use_basic_chars, num_threads);
             } else if (command == "verify") {
                 core::verify_archive(archive_file, is_raw_output_en, use_basic_chars);
+            } else if (command == "bench") {
+                paths.insert(paths.begin(), archive_file);
+                bench_options.exclude_patterns = exclude_patterns;
+                bench_options.num_threads = num_threads;
+                bench_options.solid = solid_mode;
+                core::CodecBenchmarkResult bench_result = core::benchmark_codecs(paths, bench_options);
+                print_codec_benchmark(bench_result, bench_options);
             } else {
                 err("Error: Unknown command '" + command + "'");
                 print_usage();
@@ -331,7 +454,7 @@ int run_cli(int argc, char* argv[]) {
         auto end_time = std::chrono::steady_clock::now();
         auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
         
-        std::cout << std::endl;
+        if (!stdout_is_data) std::cout << std::endl;
     
         if (is_extra_info_en) {
             print_extra_info(command, num_threads, comp_type, comp_level, hash_type, result);
@@ -339,6 +462,11 @@ int run_cli(int argc, char* argv[]) {
     
         sumar("Total time elapsed: " + std::to_string(duration.count() / 1000) + "." + 
               std::to_string(duration.count() % 1000) + "s");
+
+        if (!metrics_json_path.empty() && !write_metrics_json(metrics_json_path, command, num_threads, duration.count(), result)) {
+            err("Error: Cannot write metrics to '" + metrics_json_path + "'");
+            return 1;
+        }
         
         return 0;
     }
@@ -419,6 +547,147 @@ int run_cli(int argc, char* argv[]) {
         }
     }
     
+    bool write_metrics_json(const std::string& target, const std::string& command, int num_threads, long long elapsed_ms, const std::any& result) {
+        std::ostringstream json;
+        json << "{\"command\":\"" << core::json_escape(command) << "\""
+             << ",\"threads\":" << num_threads
+             << ",\"elapsed_ms\":" << elapsed_ms;
+
+        if (command == "create" || command == "append") {
+            auto create_result = std::any_cast<core::ArchiveCreationResult>(result);
+            json << ",\"result\":{\"files_added\":" << create_result.files_added
+                 << ",\"uncompressed_bytes\":" << create_result.total_uncompressed_size
+                 << ",\"compressed_bytes\":" << create_result.total_compressed_size
+                 << ",\"header_bytes\":" << create_result.total_header_size
+                 << ",\"metadata_bytes\":" << create_result.total_metadata_size
+                 << ",\"file_data_bytes\":" << create_result.total_file_data_size;
+            json << ",\"thread_durations_ms\":[";
+            for (size_t i = 0; i < create_result.thread_durations_ms.size(); ++i) {
+                json << (i ? "," : "") << create_result.thread_durations_ms[i];
+            }
+            json << "]}";
+        } else if (command == "extract") {
+            auto extract_result = std::any_cast<core::ArchiveExtractionResult>(result);
+            json << ",\"result\":{\"files_extracted\":" << extract_result.files_extracted
+                 << ",\"files_skipped\":" << extract_result.files_skipped
+                 << ",\"bytes_extracted\":" << extract_result.bytes_extracted
+                 << ",\"hashes_checked\":" << extract_result.hashes_checked
+                 << ",\"hash_mismatches\":" << extract_result.hash_mismatches;
+            json << ",\"thread_durations_ms\":[";
+            for (size_t i = 0; i < extract_result.thread_durations_ms.size(); ++i) {
+                json << (i ? "," : "") << extract_result.thread_durations_ms[i];
+            }
+            json << "]}";
+        }
+
+        json << ",\"metrics\":" << core::Metrics::global().to_json() << "}";
+
+        if (target == "-") {
+            std::cout << json.str() << std::endl;
+            return true;
+        }
+        std::ofstream out(target);
+        if (!out) {
+            return false;
+        }
+        out << json.str() << std::endl;
+        return static_cast<bool>(out);
+    }
+    
+    bool parse_size_arg(const std::string& text, uint64_t& size) {
+        if (text.empty() || !isdigit((unsigned char)text[0])) return false;
+        size_t pos = 0;
+        uint64_t value = std::stoull(text, &pos);
+        std::string suffix = text.substr(pos);
+        if (suffix == "K" || suffix == "KB") value <<= 10;
+        else if (suffix == "M" || suffix == "MB") value <<= 20;
+        else if (suffix == "G" || suffix == "GB") value <<= 30;
+        else if (!suffix.empty() && suffix != "B") return false;
+        size = value;
+        return true;
+    }
+
+    void print_codec_benchmark(const core::CodecBenchmarkResult& result, const core::CodecBenchmarkOptions& options) {
+        auto setting_name = [](const core::CodecBenchmarkEntry& entry) {
+            return core::COMPRESSION_NAMES.at(entry.codec) + ":" + std::to_string(entry.level);
+        };
+
+        if (is_raw_output_en) {
+            std::cout << "total_files=" << result.total_files << std::endl;
+            std::cout << "total_bytes=" << result.total_bytes << std::endl;
+            std::cout << "sampled_bytes=" << result.sampled_bytes << std::endl;
+            std::cout << "incompressible_sampled_bytes=" << result.incompressible_bytes << std::endl;
+            for (const auto& entry : result.entries) {
+                std::cout << "setting=" << setting_name(entry);
+                if (!entry.error.empty()) {
+                    std::cout << " error=\"" << entry.error << "\"" << std::endl;
+                    continue;
+                }
+                std::cout << std::fixed << std::setprecision(3)
+                          << " ratio=" << entry.ratio
+                          << " estimated_size=" << entry.compressed_bytes
+                          << " compress_mbps=" << entry.compress_mbps
+                          << " decompress_mbps=" << entry.decompress_mbps
+                          << " pareto=" << (entry.pareto ? 1 : 0) << std::endl;
+            }
+            if (result.recommended >= 0) {
+                std::cout << "recommended=" << setting_name(result.entries[result.recommended]) << std::endl;
+            }
+            return;
+        }
+
+        output("Sampled " + core::format_size(result.sampled_bytes) + " in " + std::to_string(result.sampled_chunks) +
+               " chunks from " + std::to_string(result.total_files) + " files (" + core::format_size(result.total_bytes) + ")");
+        if (result.incompressible_bytes > 0) {
+            output("  " + core::format_size(result.incompressible_bytes) + " of the sample is already compressed and would be stored as-is");
+        }
+
+        // The Pareto front by default; every setting with -v.
+        std::vector<const core::CodecBenchmarkEntry*> rows;
+        for (const auto& entry : result.entries) {
+            if (entry.error.empty() && (entry.pareto || is_verb_en)) rows.push_back(&entry);
+        }
+        std::sort(rows.begin(), rows.end(), [](const core::CodecBenchmarkEntry* a, const core::CodecBenchmarkEntry* b) {
+            return a->compress_mbps > b->compress_mbps;
+        });
+
+        std::ostringstream table;
+        table << std::left << std::setw(16) << "  Setting" << std::right
+              << std::setw(9) << "Ratio" << std::setw(12) << "Est. size"
+              << std::setw(13) << "Comp MB/s" << std::setw(15) << "Decomp MB/s";
+        sumar(table.str());
+        for (const auto* entry : rows) {
+            std::ostringstream line;
+            bool recommended = result.recommended >= 0 && entry == &result.entries[result.recommended];
+            line << (entry->pareto ? "* " : "  ") << std::left << std::setw(14) << setting_name(*entry) << std::right
+                 << std::fixed << std::setprecision(2) << std::setw(8) << entry->ratio << "x"
+                 << std::setw(12) << core::format_size(entry->compressed_bytes)
+                 << std::setprecision(1) << std::setw(13) << entry->compress_mbps
+                 << std::setw(15) << entry->decompress_mbps
+                 << (recommended ? "  <- recommended" : "");
+            sumar(line.str());
+        }
+        for (const auto& entry : result.entries) {
+            if (!entry.error.empty()) {
+                verb("  " + setting_name(entry) + " failed: " + entry.error);
+            }
+        }
+
+        if (result.recommended >= 0) {
+            const auto& best = result.entries[result.recommended];
+            bool meets_target = best.compress_mbps * std::max(1, options.num_threads) >= options.target_mbps;
+            std::ostringstream msg;
+            msg << std::fixed << std::setprecision(0) << options.target_mbps;
+            if (meets_target) {
+                success("Recommended: -c " + core::COMPRESSION_NAMES.at(best.codec) + " -l " + std::to_string(best.level) +
+                        " (best ratio at or above " + msg.str() + " MB/s with " + std::to_string(options.num_threads) + " threads)");
+            } else {
+                warn("No setting reaches " + msg.str() + " MB/s with " + std::to_string(options.num_threads) +
+                     " threads; fastest is -c " + core::COMPRESSION_NAMES.at(best.codec) + " -l " + std::to_string(best.level));
+            }
+        }
+    }
+    
     void print_raw_summary(const std::string& msg) {
         
     
@@ -487,6 +756,7 @@ int run_cli(int argc, char* argv[]) {
         std::cout << "  extract    Extract files from archive\n";
         std::cout << "  remove     Remove files from archive\n";
         std::cout << "  verify     Verify archive integrity\n";
+        std::cout << "  bench      Compare codecs and levels on a sample of your data\n";
         std::cout << "  version    Display version information\n\n";
         
         std::cout << "Options:\n";
@@ -497,18 +767,29 @@ int run_cli(int argc, char* argv[]) {
         std::cout << "                 sha3-224, sha3-384, xxhash3, xxhash128, crc32, crc64, blake3\n";
         std::cout << "  -s, --solid    Create a solid archive for better compression.\n";
         std::cout << "                 (This may make extraction slow, especially for individual files)\n";
+        std::cout << "  --no-group     Store every file as its own entry instead of packing small files\n";
+        std::cout << "                 into compressed groups of about 2 MB\n";
+        std::cout << "  --plain-metadata Write solid and group metadata as fixed-width records\n";
+        std::cout << "                 instead of the compact compressed encoding\n";
         std::cout << "  -o <dir>       Output directory for extraction (default: .)\n";
+        std::cout << "  --name <name>  Entry name for data read from stdin with 'create <archive> -'\n";
+        std::cout << "  --to-stdout    Write extracted file contents to stdout instead of files\n";
         std::cout << "  -v             Verbose output\n";
         std::cout << "  -i             Ignore errors (skip files instead of stopping)\n";
         std::cout << "  -y             Auto-yes to all prompts (for automation)\n";
         std::cout << "  --threads <count> Number of threads to use (default: 1)\n";
+        std::cout << "  --memory-limit <size>  Cap on file data held by all threads at once, e.g. 2G;\n";
+        std::cout << "                 larger files wait and are then processed alone\n";
         std::cout << "  --exclude <pattern>  Exclude files/folders matching pattern (supports * and ?)\n";
         std::cout << "  --full         Store full absolute paths in archive\n";
         std::cout << "  --no-color     Disable colored output\n";
         std::cout << "  --extra        Display extra information after operation\n";
         std::cout << "  --raw          Display raw, machine-readable output\n";
+        std::cout << "  --metrics-json <file>  Write per-stage timings and codec throughput as JSON ('-' for stdout)\n";
         std::cout << "  --detailed     Display a more detailed progress bar\n";
-        std::cout << "  --basic-chars  Use basic characters for progress bar\n\n";
+        std::cout << "  --basic-chars  Use basic characters for progress bar\n";
+        std::cout << "  --sample-size <size>  Bytes sampled by bench, e.g. 64M (default: 64M)\n";
+        std::cout << "  --target-mbps <rate>  Compress throughput bench should recommend for (default: 100)\n\n";
         
         
         std::cout << "Examples:\n";
@@ -531,9 +812,16 @@ int run_cli(int argc, char* argv[]) {
         std::cout << "  # Remove files from archive\n";
         std::cout << "  prismzip remove backup.przm file.txt folder/\n\n";
         
+        std::cout << "  # Stream a database dump into an archive on stdout, and back out again\n";
+        std::cout << "  pg_dump db | prismzip create - --name db.sql -c zstd | ssh host 'cat > db.przm'\n";
+        std::cout << "  prismzip extract db.przm db.sql --to-stdout | psql db\n\n";
+        
         std::cout << "  # Verify archive integrity (requires hashing)\n";
         std::cout << "  prismzip verify backup.przm\n\n";
         
+        std::cout << "  # Find the best codec for a dataset at 200 MB/s on 8 threads\n";
+        std::cout << "  prismzip bench data/ -c zstd,lz4,zlib --threads 8 --target-mbps 200\n\n";
+        
         std::cout << "  # Verbose mode with best LZMA compression\n";
         std::cout << "  prismzip create archive.przm data/ -c lzma -l 9 -H sha512 -v\n\n";
     }
@@ -559,11 +847,17 @@ int run_cli(int argc, char* argv[]) {
             std::cout << "  -c <type>       Compression type (default: zlib): none, zlib, bzip2, lzma, gzip, lz4, zstd, brotli, snappy, lzo, lzma2\n";
             std::cout << "  -l <level>      Compression level 0-9 (default: 9)\n";
         std::cout << "  -s, --solid     Create a solid archive for better compression\n";
+            std::cout << "  --no-group      Do not pack small files into shared compressed groups\n";
+            std::cout << "  --plain-metadata Store metadata as fixed-width records (default: compact)\n";
             std::cout << "  -H <type>       Hash algorithm for integrity checking: none, md5, sha1, sha256, sha512, sha384, blake2b, blake2s, sha3-256, sha3-512, ripemd160, whirlpool, sha224, sha3-224, sha3-384, xxhash3, xxhash128, crc32, crc64, blake3\n";
+            std::cout << "  --name <name>   Entry name when reading from stdin (default: stdin)\n";
             std::cout << "  -v              Verbose output\n";
             std::cout << "  -i              Ignore errors\n\n";
+            std::cout << "Use '-' as the only path to store stdin as one entry, and '-' as the\n";
+            std::cout << "archive file to write the archive to stdout.\n\n";
             std::cout << "Example:\n";
-            std::cout << "  prismzip create backup.przm file.txt folder/ -c lzma -H sha256\n\n";
+            std::cout << "  prismzip create backup.przm file.txt folder/ -c lzma -H sha256\n";
+            std::cout << "  pg_dump db | prismzip create - --name db.sql > db.przm\n\n";
         } else if (command == "append") {
             std::cout << "Usage: prismzip append <archive_file> <paths...> [options]\n\n";
             std::cout << "Append files to an existing archive.\n\n";
@@ -574,6 +868,8 @@ int run_cli(int argc, char* argv[]) {
             std::cout << "  -c <type>       Compression type (default: zlib): none, zlib, bzip2, lzma, gzip, lz4, zstd, brotli, snappy, lzo, lzma2\n";
             std::cout << "  -l <level>      Compression level 0-9 (default: 9)\n";
             std::cout << "  -s, --solid     Append as a solid block\n";
+            std::cout << "  --no-group      Do not pack small files into shared compressed groups\n";
+            std::cout << "  --plain-metadata Store metadata as fixed-width records (default: compact)\n";
             std::cout << "  -H <type>       Hash algorithm: none, md5, sha1, sha256, sha512, sha384, blake2b, blake2s, sha3-256, sha3-512, ripemd160, whirlpool, sha224, sha3-224, sha3-384, xxhash3, xxhash128, crc32, crc64, blake3\n";
             std::cout << "  -v              Verbose output\n";
             std::cout << "  -i              Ignore errors (skip duplicates)\n\n";
@@ -589,11 +885,13 @@ int run_cli(int argc, char* argv[]) {
             std::cout << "  -o <dir>        Output directory (default: current directory)\n";
             std::cout << "  -v              Verbose output\n";
             std::cout << "  -n              No verification on extraction\n";
-            std::cout << "  --no-overwrite  Do not overwrite existing files on extraction\n\n";
+            std::cout << "  --no-overwrite  Do not overwrite existing files on extraction\n";
+            std::cout << "  --to-stdout     Write the selected files' contents to stdout\n\n";
             std::cout << "Examples:\n";
             std::cout << "  prismzip extract backup.przm -o output/\n";
             std::cout << "  prismzip extract backup.przm file.txt folder/file2.txt -o restore/\n";
-            std::cout << "  prismzip extract backup.przm -o output/ --no-overwrite -n\n\n";
+            std::cout << "  prismzip extract backup.przm -o output/ --no-overwrite -n\n";
+            std::cout << "  prismzip extract db.przm db.sql --to-stdout | psql db\n\n";
         } else if (command == "remove") {
             std::cout << "Usage: prismzip remove <archive_file> <paths...> [options]\n\n";
             std::cout << "Remove files from an archive.\n\n";
@@ -634,6 +932,22 @@ int run_cli(int argc, char* argv[]) {
             std::cout << "Note: Archive must have been created with hash verification enabled.\n\n";
             std::cout << "Example:\n";
             std::cout << "  prismzip verify backup.przm -v\n\n";
+        } else if (command == "bench") {
+            std::cout << "Usage: prismzip bench <paths...> [options]\n\n";
+            std::cout << "Sample the input and compare compression settings on it.\n\n";
+            std::cout << "Required:\n";
+            std::cout << "  <paths...>             Files and directories to sample\n\n";
+            std::cout << "Options:\n";
+            std::cout << "  -c <list>              Codecs to try, comma separated (default: all)\n";
+            std::cout << "  -l <list>              Levels to try, comma separated (default: 0-9)\n";
+            std::cout << "  -s, --solid            Measure as one solid block instead of per file\n";
+            std::cout << "  --threads <count>      Settings benchmarked in parallel; also scales the target\n";
+            std::cout << "  --sample-size <size>   Bytes to sample (default: 64M)\n";
+            std::cout << "  --target-mbps <rate>   Aggregate compress throughput to recommend for (default: 100)\n";
+            std::cout << "  --exclude <pattern>    Exclude files/folders matching pattern\n";
+            std::cout << "  -v                     Show every setting, not only the Pareto front\n\n";
+            std::cout << "Example:\n";
+            std::cout << "  prismzip bench data/ -c zstd,lz4 -l 1,3,9 --threads 8 --target-mbps 400\n\n";
         }
     }
 
@@ -0,0 +1,43 @@
+#ifndef PRISM_BENCH_CORPUS_H
+#define PRISM_BENCH_CORPUS_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace prism {
+namespace bench {
+
+enum class CorpusKind {
+    TEXT,
+    BINARY,
+    RANDOM,
+    ZEROS,
+    MIXED
+};
+
+// splitmix64; identical output on every platform for a given seed.
+class Rng {
+public:
+    explicit Rng(uint64_t seed) : state(seed) {}
+    uint64_t next();
+    uint64_t below(uint64_t bound) { return bound ? next() % bound : 0; }
+
+private:
+    uint64_t state;
+};
+
+const std::vector<CorpusKind>& all_corpus_kinds();
+const char* corpus_name(CorpusKind kind);
+bool parse_corpus_kind(const std::string& name, CorpusKind& kind);
+
+std::vector<char> generate_corpus(CorpusKind kind, size_t size, uint64_t seed);
+
+// Parses sizes such as "4096", "1K", "64M" or "2G".
+bool parse_size(const std::string& text, uint64_t& size);
+std::vector<std::string> split_list(const std::string& text, char sep = ',');
+
+} 
+} 
+
+#endif 
@@ -0,0 +1,41 @@
+#ifndef PRISM_BENCH_TREE_GEN_H
+#define PRISM_BENCH_TREE_GEN_H
+
+#include <cstdint>
+#include <string>
+
+namespace prism {
+namespace bench {
+
+enum class TreeShape {
+    SMALL_FILES,  // many files around file_size, spread over wide directories
+    LARGE_FILES,  // few files of exactly file_size, written in chunks
+    DEEP,         // files spread across a chain of depth nested directories
+    MEDIA         // mix of incompressible media/archives and compressible documents
+};
+
+struct TreeSpec {
+    TreeShape shape = TreeShape::SMALL_FILES;
+    uint64_t file_count = 1000;
+    uint64_t file_size = 1024;
+    int depth = 32;
+    int files_per_dir = 256;
+    uint64_t seed = 42;
+};
+
+struct TreeStats {
+    uint64_t files = 0;
+    uint64_t bytes = 0;
+    uint64_t directories = 0;
+};
+
+const char* tree_shape_name(TreeShape shape);
+bool parse_tree_shape(const std::string& name, TreeShape& shape);
+
+// Builds the same tree under root for the same spec. root is created if missing.
+TreeStats generate_tree(const std::string& root, const TreeSpec& spec);
+
+} 
+} 
+
+#endif 
@@ -0,0 +1,228 @@
+#include <corpus.h>
+#include <prism/compression.h>
+#include <prism/hashing.h>
+#include <prism/core/metrics.h>
+#include <prism/core/types.h>
+#include <algorithm>
+#include <cstdlib>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+using namespace prism;
+using prism::core::CompressionType;
+using prism::core::HashType;
+
+namespace {
+
+struct Options {
+    std::vector<CompressionType> codecs;
+    std::vector<HashType> hashes;
+    std::vector<int> levels;
+    std::vector<bench::CorpusKind> corpora;
+    std::vector<uint64_t> sizes;
+    double min_time = 0.25;
+    uint64_t seed = 42;
+    std::string output = "-";
+};
+
+// Runs fn until min_time has elapsed (at least once) and returns the fastest iteration in seconds.
+template <class Fn>
+double time_best(double min_time, int& iterations, Fn&& fn) {
+    using clock = std::chrono::steady_clock;
+    double best = 0.0;
+    double elapsed = 0.0;
+    iterations = 0;
+    do {
+        auto start = clock::now();
+        fn();
+        double seconds = std::chrono::duration<double>(clock::now() - start).count();
+        if (iterations == 0 || seconds < best) best = seconds;
+        elapsed += seconds;
+        iterations++;
+    } while (elapsed < min_time && iterations < 1000);
+    return best;
+}
+
+double mb_per_s(uint64_t bytes, double seconds) {
+    return seconds > 0.0 ? (double)bytes / (1024.0 * 1024.0) / seconds : 0.0;
+}
+
+void print_usage() {
+    std::cout << "Usage: prismzip_bench [options]\n\n";
+    std::cout << "Measures codec throughput and ratio and hash throughput over synthetic corpora.\n\n";
+    std::cout << "Options:\n";
+    std::cout << "  --codecs <list>    Comma-separated codecs (default: all); pass \"\" to skip codecs\n";
+    std::cout << "  --hashes <list>    Comma-separated hashes (default: all), or 'none' to skip\n";
+    std::cout << "  --levels <list>    Levels for codecs that take one (default: 0-9)\n";
+    std::cout << "  --corpora <list>   text, binary, random, zeros, mixed (default: all)\n";
+    std::cout << "  --sizes <list>     Buffer sizes, e.g. 1K,64K,1M (default: 1K,64K,1M,16M,256M)\n";
+    std::cout << "  --min-time <sec>   Minimum time spent per measurement (default: 0.25)\n";
+    std::cout << "  --seed <n>         Corpus seed (default: 42)\n";
+    std::cout << "  --output <file>    Write JSON to file instead of stdout\n";
+}
+
+bool parse_args(int argc, char* argv[], Options& opts) {
+    for (const auto& pair : core::COMPRESSION_NAMES) opts.codecs.push_back(pair.first);
+    for (const auto& pair : core::HASH_NAMES) {
+        if (pair.first != HashType::NONE) opts.hashes.push_back(pair.first);
+    }
+    for (int level = 0; level <= 9; ++level) opts.levels.push_back(level);
+    opts.corpora = bench::all_corpus_kinds();
+    opts.sizes = {1ULL << 10, 64ULL << 10, 1ULL << 20, 16ULL << 20, 256ULL << 20};
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "-h" || arg == "--help") {
+            print_usage();
+            exit(0);
+        } else if (arg == "--codecs" && has_value) {
+            opts.codecs.clear();
+            for (const auto& name : bench::split_list(argv[++i])) {
+                if (!core::COMPRESSION_MAP.count(name)) {
+                    std::cerr << "Error: Invalid compression type '" << name << "'" << std::endl;
+                    return false;
+                }
+                opts.codecs.push_back(core::COMPRESSION_MAP.at(name));
+            }
+        } else if (arg == "--hashes" && has_value) {
+            opts.hashes.clear();
+            for (const auto& name : bench::split_list(argv[++i])) {
+                if (name == "none") continue;
+                if (!core::HASH_MAP.count(name)) {
+                    std::cerr << "Error: Invalid hash type '" << name << "'" << std::endl;
+                    return false;
+                }
+                opts.hashes.push_back(core::HASH_MAP.at(name));
+            }
+        } else if (arg == "--levels" && has_value) {
+            opts.levels.clear();
+            for (const auto& item : bench::split_list(argv[++i])) {
+                opts.levels.push_back(std::atoi(item.c_str()));
+            }
+        } else if (arg == "--corpora" && has_value) {
+            opts.corpora.clear();
+            for (const auto& name : bench::split_list(argv[++i])) {
+                bench::CorpusKind kind;
+                if (!bench::parse_corpus_kind(name, kind)) {
+                    std::cerr << "Error: Invalid corpus '" << name << "'" << std::endl;
+                    return false;
+                }
+                opts.corpora.push_back(kind);
+            }
+        } else if (arg == "--sizes" && has_value) {
+            opts.sizes.clear();
+            for (const auto& item : bench::split_list(argv[++i])) {
+                uint64_t size;
+                if (!bench::parse_size(item, size) || size == 0) {
+                    std::cerr << "Error: Invalid size '" << item << "'" << std::endl;
+                    return false;
+                }
+                opts.sizes.push_back(size);
+            }
+        } else if (arg == "--min-time" && has_value) {
+            opts.min_time = std::atof(argv[++i]);
+        } else if (arg == "--seed" && has_value) {
+            opts.seed = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--output" && has_value) {
+            opts.output = argv[++i];
+        } else {
+            std::cerr << "Error: Unknown option '" << arg << "'" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+} // anonymous namespace
+
+int main(int argc, char* argv[]) {
+    Options opts;
+    if (!parse_args(argc, argv, opts)) {
+        print_usage();
+        return 1;
+    }
+
+    std::ostringstream compression_json;
+    std::ostringstream hashing_json;
+    compression_json << std::fixed << std::setprecision(3);
+    hashing_json << std::fixed << std::setprecision(3);
+    bool first_compression = true;
+    bool first_hash = true;
+
+    for (bench::CorpusKind kind : opts.corpora) {
+        for (uint64_t size : opts.sizes) {
+            std::vector<char> corpus = bench::generate_corpus(kind, size, opts.seed);
+            std::cerr << "corpus " << bench::corpus_name(kind) << " " << size << " bytes" << std::endl;
+
+            for (CompressionType codec : opts.codecs) {
+                std::vector<int> levels = compression::codec_uses_level(codec) ? opts.levels : std::vector<int>{0};
+                for (int level : levels) {
+                    std::string codec_name = core::COMPRESSION_NAMES.at(codec);
+                    compression_json << (first_compression ? "" : ",") << "\n    {\"codec\":\"" << codec_name
+                                     << "\",\"level\":" << level
+                                     << ",\"corpus\":\"" << bench::corpus_name(kind)
+                                     << "\",\"size\":" << size;
+                    first_compression = false;
+                    try {
+                        std::vector<char> compressed;
+                        int compress_iterations = 0;
+                        double compress_s = time_best(opts.min_time, compress_iterations, [&] {
+                            compressed = compression::compress_data(corpus, codec, level);
+                        });
+                        std::vector<char> restored;
+                        int decompress_iterations = 0;
+                        double decompress_s = time_best(opts.min_time, decompress_iterations, [&] {
+                            restored = compression::decompress_data(compressed, codec, corpus.size());
+                        });
+                        compression_json << ",\"compressed_size\":" << compressed.size()
+                                         << ",\"ratio\":" << (compressed.empty() ? 0.0 : (double)corpus.size() / compressed.size())
+                                         << ",\"compress_mb_per_s\":" << mb_per_s(size, compress_s)
+                                         << ",\"decompress_mb_per_s\":" << mb_per_s(size, decompress_s)
+                                         << ",\"compress_iterations\":" << compress_iterations
+                                         << ",\"decompress_iterations\":" << decompress_iterations
+                                         << ",\"roundtrip_ok\":" << (restored == corpus ? "true" : "false") << "}";
+                    } catch (const std::exception& e) {
+                        compression_json << ",\"error\":\"" << core::json_escape(e.what()) << "\"}";
+                    }
+                }
+            }
+
+            for (HashType hash : opts.hashes) {
+                int iterations = 0;
+                std::string digest;
+                double seconds = time_best(opts.min_time, iterations, [&] {
+                    digest = hashing::calculate_hash_from_data(corpus, hash);
+                });
+                hashing_json << (first_hash ? "" : ",") << "\n    {\"hash\":\"" << core::HASH_NAMES.at(hash)
+                             << "\",\"corpus\":\"" << bench::corpus_name(kind)
+                             << "\",\"size\":" << size
+                             << ",\"mb_per_s\":" << mb_per_s(size, seconds)
+                             << ",\"iterations\":" << iterations
+                             << ",\"digest\":\"" << core::json_escape(digest) << "\"}";
+                first_hash = false;
+            }
+        }
+    }
+
+    std::ostringstream json;
+    json << "{\n  \"schema\": 1,\n  \"seed\": " << opts.seed
+         << ",\n  \"min_time_s\": " << opts.min_time
+         << ",\n  \"compression\": [" << compression_json.str() << "\n  ],\n  \"hashing\": [" << hashing_json.str() << "\n  ]\n}\n";
+
+    if (opts.output == "-") {
+        std::cout << json.str();
+    } else {
+        std::ofstream out(opts.output);
+        if (!out) {
+            std::cerr << "Error: Cannot write '" << opts.output << "'" << std::endl;
+            return 1;
+        }
+        out << json.str();
+    }
+    return 0;
+}
@@ -0,0 +1,178 @@
+#include <corpus.h>
+#include <algorithm>
+#include <cstring>
+#include <cctype>
+
+namespace prism {
+namespace bench {
+
+namespace {
+
+const char* const WORDS[] = {
+    "the", "of", "and", "to", "in", "a", "is", "that", "for", "it",
+    "archive", "file", "data", "compression", "block", "stream", "header", "offset",
+    "thread", "buffer", "value", "return", "const", "struct", "include", "string",
+    "vector", "error", "result", "path", "size", "level", "hash", "metadata",
+    "directory", "entry", "checksum", "window", "dictionary", "literal", "match"
+};
+const size_t WORD_COUNT = sizeof(WORDS) / sizeof(WORDS[0]);
+
+void fill_text(std::vector<char>& out, size_t size, Rng& rng) {
+    size_t line = 0;
+    while (out.size() < size) {
+        // Squaring the draw skews selection toward the front of the list, roughly Zipf-like.
+        uint64_t r = rng.below(WORD_COUNT * WORD_COUNT);
+        const char* word = WORDS[(r * r) / (WORD_COUNT * WORD_COUNT * WORD_COUNT)];
+        size_t len = strlen(word);
+        out.insert(out.end(), word, word + len);
+        line += len + 1;
+        if (line > 60 + rng.below(20)) {
+            out.push_back('\n');
+            line = 0;
+        } else {
+            out.push_back(' ');
+        }
+    }
+    out.resize(size);
+}
+
+void fill_binary(std::vector<char>& out, size_t size, Rng& rng) {
+    // Fixed-width records with slowly changing fields, like tables or object files.
+    uint32_t id = 0;
+    uint64_t timestamp = 1700000000000ULL;
+    while (out.size() < size) {
+        char record[32];
+        id += 1;
+        timestamp += rng.below(1000);
+        uint32_t category = (uint32_t)rng.below(8);
+        float measure = (float)(rng.below(100000)) / 100.0f;
+        uint64_t flags = rng.below(4) == 0 ? rng.next() : 0;
+        memcpy(record, &id, 4);
+        memcpy(record + 4, &timestamp, 8);
+        memcpy(record + 12, &category, 4);
+        memcpy(record + 16, &measure, 4);
+        memcpy(record + 20, &flags, 8);
+        memset(record + 28, 0, 4);
+        out.insert(out.end(), record, record + sizeof(record));
+    }
+    out.resize(size);
+}
+
+void fill_random(std::vector<char>& out, size_t size, Rng& rng) {
+    out.resize(size);
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t v = rng.next();
+        memcpy(&out[i], &v, 8);
+    }
+    if (i < size) {
+        uint64_t v = rng.next();
+        memcpy(&out[i], &v, size - i);
+    }
+}
+
+} // anonymous namespace
+
+uint64_t Rng::next() {
+    uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+const std::vector<CorpusKind>& all_corpus_kinds() {
+    static const std::vector<CorpusKind> kinds = {
+        CorpusKind::TEXT, CorpusKind::BINARY, CorpusKind::RANDOM, CorpusKind::ZEROS, CorpusKind::MIXED
+    };
+    return kinds;
+}
+
+const char* corpus_name(CorpusKind kind) {
+    switch (kind) {
+        case CorpusKind::TEXT: return "text";
+        case CorpusKind::BINARY: return "binary";
+        case CorpusKind::RANDOM: return "random";
+        case CorpusKind::ZEROS: return "zeros";
+        case CorpusKind::MIXED: return "mixed";
+    }
+    return "unknown";
+}
+
+bool parse_corpus_kind(const std::string& name, CorpusKind& kind) {
+    for (CorpusKind k : all_corpus_kinds()) {
+        if (name == corpus_name(k)) {
+            kind = k;
+            return true;
+        }
+    }
+    return false;
+}
+
+std::vector<char> generate_corpus(CorpusKind kind, size_t size, uint64_t seed) {
+    std::vector<char> out;
+    out.reserve(size + 64);
+    Rng rng(seed ^ (static_cast<uint64_t>(kind) << 56));
+
+    switch (kind) {
+        case CorpusKind::TEXT:
+            fill_text(out, size, rng);
+            break;
+        case CorpusKind::BINARY:
+            fill_binary(out, size, rng);
+            break;
+        case CorpusKind::RANDOM:
+            fill_random(out, size, rng);
+            break;
+        case CorpusKind::ZEROS:
+            out.assign(size, 0);
+            break;
+        case CorpusKind::MIXED: {
+            // 64 KB runs of each kind in turn, the way real directories interleave content.
+            const size_t chunk = 64 * 1024;
+            const CorpusKind parts[] = { CorpusKind::TEXT, CorpusKind::BINARY, CorpusKind::RANDOM, CorpusKind::ZEROS };
+            size_t index = 0;
+            while (out.size() < size) {
+                size_t n = std::min(chunk, size - out.size());
+                std::vector<char> part = generate_corpus(parts[index % 4], n, seed + index);
+                out.insert(out.end(), part.begin(), part.end());
+                index++;
+            }
+            break;
+        }
+    }
+    return out;
+}
+
+bool parse_size(const std::string& text, uint64_t& size) {
+    if (text.empty() || !isdigit((unsigned char)text[0])) return false;
+    size_t pos = 0;
+    uint64_t value = std::stoull(text, &pos);
+    std::string suffix = text.substr(pos);
+    if (suffix.empty() || suffix == "B") {
+    } else if (suffix == "K" || suffix == "KB" || suffix == "k") {
+        value <<= 10;
+    } else if (suffix == "M" || suffix == "MB" || suffix == "m") {
+        value <<= 20;
+    } else if (suffix == "G" || suffix == "GB" || suffix == "g") {
+        value <<= 30;
+    } else {
+        return false;
+    }
+    size = value;
+    return true;
+}
+
+std::vector<std::string> split_list(const std::string& text, char sep) {
+    std::vector<std::string> items;
+    size_t start = 0;
+    while (start <= text.size()) {
+        size_t end = text.find(sep, start);
+        if (end == std::string::npos) end = text.size();
+        if (end > start) items.push_back(text.substr(start, end - start));
+        start = end + 1;
+    }
+    return items;
+}
+
+} 
+} 
@@ -0,0 +1,139 @@
+#include <tree_gen.h>
+#include <corpus.h>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <algorithm>
+#include <cstdio>
+
+namespace fs = std::filesystem;
+
+namespace prism {
+namespace bench {
+
+namespace {
+
+const size_t WRITE_CHUNK = 4 * 1024 * 1024;
+
+void write_file(const fs::path& path, CorpusKind kind, uint64_t size, uint64_t seed, TreeStats& stats) {
+    std::ofstream out(path, std::ios::binary);
+    if (!out) {
+        throw std::runtime_error("Cannot create file: " + path.string());
+    }
+    uint64_t written = 0;
+    uint64_t chunk_index = 0;
+    while (written < size) {
+        size_t n = (size_t)std::min<uint64_t>(WRITE_CHUNK, size - written);
+        std::vector<char> chunk = generate_corpus(kind, n, seed + chunk_index * 0x1000193ULL);
+        out.write(chunk.data(), chunk.size());
+        written += n;
+        chunk_index++;
+    }
+    if (!out) {
+        throw std::runtime_error("Cannot write file: " + path.string());
+    }
+    stats.files++;
+    stats.bytes += size;
+}
+
+fs::path ensure_dir(const fs::path& dir, TreeStats& stats) {
+    if (!fs::exists(dir)) {
+        fs::create_directories(dir);
+        stats.directories++;
+    }
+    return dir;
+}
+
+std::string numbered(const char* prefix, uint64_t n, const char* suffix) {
+    char name[64];
+    snprintf(name, sizeof(name), "%s%06llu%s", prefix, (unsigned long long)n, suffix);
+    return name;
+}
+
+int floor_log2(uint64_t value) {
+    int bits = 0;
+    while (value >>= 1) bits++;
+    return bits;
+}
+
+} // anonymous namespace
+
+const char* tree_shape_name(TreeShape shape) {
+    switch (shape) {
+        case TreeShape::SMALL_FILES: return "small";
+        case TreeShape::LARGE_FILES: return "large";
+        case TreeShape::DEEP: return "deep";
+        case TreeShape::MEDIA: return "media";
+    }
+    return "unknown";
+}
+
+bool parse_tree_shape(const std::string& name, TreeShape& shape) {
+    const TreeShape shapes[] = { TreeShape::SMALL_FILES, TreeShape::LARGE_FILES, TreeShape::DEEP, TreeShape::MEDIA };
+    for (TreeShape s : shapes) {
+        if (name == tree_shape_name(s)) {
+            shape = s;
+            return true;
+        }
+    }
+    return false;
+}
+
+TreeStats generate_tree(const std::string& root, const TreeSpec& spec) {
+    TreeStats stats;
+    Rng rng(spec.seed);
+    fs::path base = ensure_dir(root, stats);
+    uint64_t per_dir = spec.files_per_dir > 0 ? spec.files_per_dir : 1;
+
+    switch (spec.shape) {
+        case TreeShape::SMALL_FILES:
+            for (uint64_t i = 0; i < spec.file_count; ++i) {
+                fs::path dir = ensure_dir(base / numbered("d", i / per_dir, ""), stats);
+                uint64_t size = spec.file_size / 2 + rng.below(spec.file_size + 1);
+                CorpusKind kind = (i % 4 == 3) ? CorpusKind::BINARY : CorpusKind::TEXT;
+                write_file(dir / numbered("f", i, kind == CorpusKind::TEXT ? ".txt" : ".bin"), kind, size, rng.next(), stats);
+            }
+            break;
+        case TreeShape::LARGE_FILES:
+            for (uint64_t i = 0; i < spec.file_count; ++i) {
+                write_file(base / numbered("large", i, ".dat"), CorpusKind::MIXED, spec.file_size, rng.next(), stats);
+            }
+            break;
+        case TreeShape::DEEP: {
+            int depth = spec.depth > 0 ? spec.depth : 1;
+            for (uint64_t i = 0; i < spec.file_count; ++i) {
+                fs::path dir = base;
+                int level = (int)(i % depth);
+                for (int l = 0; l <= level; ++l) {
+                    dir /= numbered("level", l, "");
+                }
+                ensure_dir(dir, stats);
+                uint64_t size = spec.file_size / 2 + rng.below(spec.file_size + 1);
+                write_file(dir / numbered("f", i, ".txt"), CorpusKind::TEXT, size, rng.next(), stats);
+            }
+            break;
+        }
+        case TreeShape::MEDIA: {
+            const char* media_ext[] = { ".jpg", ".png", ".mp4", ".mp3", ".zip", ".gz" };
+            const char* doc_ext[] = { ".txt", ".csv", ".log", ".json" };
+            for (uint64_t i = 0; i < spec.file_count; ++i) {
+                fs::path dir = ensure_dir(base / numbered("album", i / per_dir, ""), stats);
+                // Sizes spread log-uniformly between 1 KB and 4x file_size.
+                uint64_t max_size = std::max<uint64_t>(spec.file_size * 4, 1024);
+                int bits = 10 + (int)rng.below(floor_log2(max_size) - 10 + 1);
+                uint64_t size = std::min<uint64_t>(max_size, (1ULL << bits) + rng.below(1ULL << bits));
+                if (rng.below(10) < 4) {
+                    write_file(dir / numbered("media", i, media_ext[rng.below(6)]), CorpusKind::RANDOM, size, rng.next(), stats);
+                } else {
+                    CorpusKind kind = rng.below(2) ? CorpusKind::TEXT : CorpusKind::BINARY;
+                    write_file(dir / numbered("doc", i, doc_ext[rng.below(4)]), kind, size, rng.next(), stats);
+                }
+            }
+            break;
+        }
+    }
+    return stats;
+}
+
+} 
+} 
@@ -0,0 +1,391 @@
+#include <corpus.h>
+#include <tree_gen.h>
+#include <prism/core/archive_writer.h>
+#include <prism/core/archive_extractor.h>
+#include <prism/core/archive_verifier.h>
+#include <prism/core/archive_remover.h>
+#include <prism/core/metrics.h>
+#include <prism/core/types.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <thread>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+using namespace prism;
+
+namespace {
+
+struct Options {
+    bench::TreeSpec tree;
+    std::vector<int> threads;
+    std::vector<bool> layouts = {false, true};
+    std::vector<std::string> ops = {"create", "verify", "extract", "append", "remove"};
+    core::CompressionType comp_type = core::CompressionType::ZSTD;
+    int level = 3;
+    core::HashType hash_type = core::HashType::XXHASH3;
+    std::string work_dir = "prismzip_workload";
+    std::string output = "-";
+    bool reuse_tree = false;
+    bool keep = false;
+};
+
+struct Measurement {
+    bool ok = false;
+    std::string error;
+    double wall_s = 0.0;
+    double user_s = 0.0;
+    double sys_s = 0.0;
+    long peak_rss_kb = 0;
+};
+
+#ifndef _WIN32
+double timeval_seconds(const timeval& tv) {
+    return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+// Runs op in a forked child so CPU time and peak RSS belong to that operation alone.
+Measurement run_measured(const std::function<void()>& op) {
+    Measurement m;
+    int fds[2];
+    if (pipe(fds) != 0) {
+        m.error = "pipe() failed";
+        return m;
+    }
+    std::cout.flush();
+    auto start = std::chrono::steady_clock::now();
+    pid_t pid = fork();
+    if (pid < 0) {
+        m.error = "fork() failed";
+        close(fds[0]);
+        close(fds[1]);
+        return m;
+    }
+    if (pid == 0) {
+        close(fds[0]);
+        int devnull = open("/dev/null", O_WRONLY);
+        if (devnull >= 0) dup2(devnull, STDOUT_FILENO);
+        int code = 0;
+        try {
+            op();
+        } catch (const std::exception& e) {
+            std::string msg = e.what();
+            ssize_t ignored = write(fds[1], msg.data(), msg.size());
+            (void)ignored;
+            code = 1;
+        }
+        std::cout.flush();
+        _exit(code);
+    }
+    close(fds[1]);
+    std::string error;
+    char buf[512];
+    ssize_t n;
+    while ((n = read(fds[0], buf, sizeof(buf))) > 0) {
+        error.append(buf, n);
+    }
+    close(fds[0]);
+
+    int status = 0;
+    rusage usage{};
+    wait4(pid, &status, 0, &usage);
+    m.wall_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    m.user_s = timeval_seconds(usage.ru_utime);
+    m.sys_s = timeval_seconds(usage.ru_stime);
+    m.peak_rss_kb = usage.ru_maxrss;
+    m.ok = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    if (!m.ok) {
+        m.error = error.empty() ? "operation exited abnormally" : error;
+    }
+    return m;
+}
+#else
+Measurement run_measured(const std::function<void()>& op) {
+    Measurement m;
+    std::clock_t cpu_start = std::clock();
+    auto start = std::chrono::steady_clock::now();
+    try {
+        op();
+        m.ok = true;
+    } catch (const std::exception& e) {
+        m.error = e.what();
+    }
+    m.wall_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    m.user_s = (double)(std::clock() - cpu_start) / CLOCKS_PER_SEC;
+    return m;
+}
+#endif
+
+void print_usage() {
+    std::cout << "Usage: prismzip_workload_bench [options]\n\n";
+    std::cout << "Generates a deterministic file tree and times archive operations on it.\n\n";
+    std::cout << "Tree:\n";
+    std::cout << "  --shape <name>       small, large, deep, media (default: small)\n";
+    std::cout << "  --files <count>      Number of files (default: 1000)\n";
+    std::cout << "  --file-size <size>   Typical file size, e.g. 1K, 10G (default: 1K)\n";
+    std::cout << "  --depth <n>          Directory depth for the deep shape (default: 32)\n";
+    std::cout << "  --seed <n>           Generator seed (default: 42)\n";
+    std::cout << "  --reuse-tree         Keep an existing generated tree in the work directory\n\n";
+    std::cout << "Runs:\n";
+    std::cout << "  --threads <list>     Thread counts (default: 1,2,4.. up to hardware threads)\n";
+    std::cout << "  --layouts <list>     non-solid, solid (default: both)\n";
+    std::cout << "  --ops <list>         create, verify, extract, append, remove (default: all)\n";
+    std::cout << "  -c <type>            Compression (default: zstd)\n";
+    std::cout << "  -l <level>           Compression level (default: 3)\n";
+    std::cout << "  -H <type>            Hash (default: xxhash3)\n";
+    std::cout << "  --work-dir <dir>     Scratch directory (default: prismzip_workload)\n";
+    std::cout << "  --keep               Keep archives and the tree afterwards\n";
+    std::cout << "  --output <file>      Write JSON to file instead of stdout\n";
+}
+
+bool parse_args(int argc, char* argv[], Options& opts) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "-h" || arg == "--help") {
+            print_usage();
+            exit(0);
+        } else if (arg == "--shape" && has_value) {
+            if (!bench::parse_tree_shape(argv[++i], opts.tree.shape)) {
+                std::cerr << "Error: Invalid shape '" << argv[i] << "'" << std::endl;
+                return false;
+            }
+        } else if (arg == "--files" && has_value) {
+            opts.tree.file_count = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--file-size" && has_value) {
+            if (!bench::parse_size(argv[++i], opts.tree.file_size)) {
+                std::cerr << "Error: Invalid size '" << argv[i] << "'" << std::endl;
+                return false;
+            }
+        } else if (arg == "--depth" && has_value) {
+            opts.tree.depth = std::atoi(argv[++i]);
+        } else if (arg == "--seed" && has_value) {
+            opts.tree.seed = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--reuse-tree") {
+            opts.reuse_tree = true;
+        } else if (arg == "--threads" && has_value) {
+            opts.threads.clear();
+            for (const auto& item : bench::split_list(argv[++i])) {
+                int t = std::atoi(item.c_str());
+                if (t < 1) {
+                    std::cerr << "Error: Number of threads must be at least 1" << std::endl;
+                    return false;
+                }
+                opts.threads.push_back(t);
+            }
+        } else if (arg == "--layouts" && has_value) {
+            opts.layouts.clear();
+            for (const auto& item : bench::split_list(argv[++i])) {
+                if (item != "solid" && item != "non-solid") {
+                    std::cerr << "Error: Invalid layout '" << item << "'" << std::endl;
+                    return false;
+                }
+                opts.layouts.push_back(item == "solid");
+            }
+        } else if (arg == "--ops" && has_value) {
+            opts.ops = bench::split_list(argv[++i]);
+        } else if (arg == "-c" && has_value) {
+            std::string name = argv[++i];
+            if (!core::COMPRESSION_MAP.count(name)) {
+                std::cerr << "Error: Invalid compression type '" << name << "'" << std::endl;
+                return false;
+            }
+            opts.comp_type = core::COMPRESSION_MAP.at(name);
+        } else if (arg == "-l" && has_value) {
+            opts.level = std::atoi(argv[++i]);
+        } else if (arg == "-H" && has_value) {
+            std::string name = argv[++i];
+            if (!core::HASH_MAP.count(name)) {
+                std::cerr << "Error: Invalid hash type '" << name << "'" << std::endl;
+                return false;
+            }
+            opts.hash_type = core::HASH_MAP.at(name);
+        } else if (arg == "--work-dir" && has_value) {
+            opts.work_dir = argv[++i];
+        } else if (arg == "--keep") {
+            opts.keep = true;
+        } else if (arg == "--output" && has_value) {
+            opts.output = argv[++i];
+        } else {
+            std::cerr << "Error: Unknown option '" << arg << "'" << std::endl;
+            return false;
+        }
+    }
+    if (opts.threads.empty()) {
+        int hw = std::max(1u, std::thread::hardware_concurrency());
+        for (int t = 1; t < hw; t *= 2) opts.threads.push_back(t);
+        opts.threads.push_back(hw);
+    }
+    std::sort(opts.threads.begin(), opts.threads.end());
+    return true;
+}
+
+bool wants(const Options& opts, const std::string& op) {
+    return std::find(opts.ops.begin(), opts.ops.end(), op) != opts.ops.end();
+}
+
+} // anonymous namespace
+
+int main(int argc, char* argv[]) {
+    Options opts;
+    if (!parse_args(argc, argv, opts)) {
+        print_usage();
+        return 1;
+    }
+
+    fs::path work = fs::absolute(opts.work_dir);
+    fs::path tree_dir = work / "tree";
+    fs::path append_dir = work / "tree_append";
+    fs::create_directories(work);
+
+    bench::TreeStats tree_stats;
+    double generate_s = 0.0;
+    auto gen_start = std::chrono::steady_clock::now();
+    if (!(opts.reuse_tree && fs::exists(tree_dir))) {
+        fs::remove_all(tree_dir);
+        std::cerr << "generating " << bench::tree_shape_name(opts.tree.shape) << " tree in " << tree_dir.string() << std::endl;
+        tree_stats = bench::generate_tree(tree_dir.string(), opts.tree);
+    } else {
+        for (const auto& entry : fs::recursive_directory_iterator(tree_dir)) {
+            if (entry.is_regular_file()) {
+                tree_stats.files++;
+                tree_stats.bytes += entry.file_size();
+            } else if (entry.is_directory()) {
+                tree_stats.directories++;
+            }
+        }
+    }
+    generate_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - gen_start).count();
+
+    bench::TreeSpec append_spec;
+    append_spec.shape = bench::TreeShape::SMALL_FILES;
+    append_spec.file_count = std::max<uint64_t>(1, opts.tree.file_count / 100);
+    append_spec.file_size = std::min<uint64_t>(opts.tree.file_size, 64 * 1024);
+    append_spec.seed = opts.tree.seed + 1;
+    fs::remove_all(append_dir);
+    bench::TreeStats append_stats = bench::generate_tree(append_dir.string(), append_spec);
+
+    // Archive paths are relative to the parent of the directory argument.
+    std::vector<std::string> appended_paths;
+    for (const auto& entry : fs::recursive_directory_iterator(append_dir)) {
+        if (entry.is_regular_file()) {
+            appended_paths.push_back(fs::relative(entry.path(), work).generic_string());
+        }
+    }
+
+    std::ostringstream runs;
+    runs << std::fixed << std::setprecision(4);
+    bool first = true;
+    // (layout, op) -> wall time at the smallest thread count, for scaling efficiency.
+    std::map<std::pair<bool, std::string>, std::pair<int, double>> baseline;
+
+    for (bool solid : opts.layouts) {
+        for (int threads : opts.threads) {
+            fs::path archive = work / ("bench_" + std::string(solid ? "solid" : "non-solid") + "_" + std::to_string(threads) + ".przm");
+            fs::path extract_dir = work / "extract";
+            fs::remove(archive);
+
+            std::vector<std::pair<std::string, std::function<void()>>> steps;
+            steps.emplace_back("create", [&] {
+                core::create_archive(archive.string(), {tree_dir.string()}, opts.comp_type, opts.level, opts.hash_type,
+                                     false, {}, false, true, threads, true, true, solid);
+            });
+            steps.emplace_back("verify", [&] {
+                core::verify_archive(archive.string(), true, true);
+            });
+            steps.emplace_back("extract", [&] {
+                core::extract_archive(archive.string(), extract_dir.string(), {}, false, false, threads, true, true, false);
+            });
+            steps.emplace_back("append", [&] {
+                core::append_to_archive(archive.string(), {append_dir.string()}, opts.comp_type, opts.level, opts.hash_type,
+                                        false, {}, false, true, threads, true, true, solid);
+            });
+            steps.emplace_back("remove", [&] {
+                core::remove_from_archive(archive.string(), appended_paths, true, true, true);
+            });
+
+            for (const auto& step : steps) {
+                const std::string& op = step.first;
+                if (op != "create" && !wants(opts, op)) continue;
+                if (op == "remove" && !wants(opts, "append")) continue;
+
+                std::cerr << (solid ? "solid" : "non-solid") << " threads=" << threads << " " << op << std::endl;
+                Measurement m = run_measured(step.second);
+                if (op == "extract") fs::remove_all(extract_dir);
+
+                uint64_t bytes = op == "append" ? append_stats.bytes : (op == "remove" ? 0 : tree_stats.bytes);
+                auto key = std::make_pair(solid, op);
+                if (!baseline.count(key) && m.ok) baseline[key] = {threads, m.wall_s};
+
+                double efficiency = 0.0;
+                if (m.ok && baseline.count(key) && m.wall_s > 0.0) {
+                    auto base = baseline[key];
+                    efficiency = (base.second * base.first) / (m.wall_s * threads);
+                }
+
+                if (!wants(opts, op)) continue;
+                runs << (first ? "" : ",") << "\n    {\"layout\":\"" << (solid ? "solid" : "non-solid")
+                     << "\",\"threads\":" << threads
+                     << ",\"op\":\"" << op << "\""
+                     << ",\"ok\":" << (m.ok ? "true" : "false")
+                     << ",\"wall_s\":" << m.wall_s
+                     << ",\"user_s\":" << m.user_s
+                     << ",\"sys_s\":" << m.sys_s
+                     << ",\"cpu_s\":" << (m.user_s + m.sys_s)
+                     << ",\"peak_rss_kb\":" << m.peak_rss_kb
+                     << ",\"mb_per_s\":" << (m.wall_s > 0.0 ? bytes / (1024.0 * 1024.0) / m.wall_s : 0.0)
+                     << ",\"scaling_efficiency\":" << efficiency;
+                if (!m.ok) runs << ",\"error\":\"" << core::json_escape(m.error) << "\"";
+                runs << "}";
+                first = false;
+            }
+
+            if (!opts.keep) fs::remove(archive);
+        }
+    }
+
+    if (!opts.keep) {
+        fs::remove_all(tree_dir);
+        fs::remove_all(append_dir);
+    }
+
+    std::ostringstream json;
+    json << std::fixed << std::setprecision(4);
+    json << "{\n  \"schema\": 1,\n  \"tree\": {\"shape\":\"" << bench::tree_shape_name(opts.tree.shape)
+         << "\",\"seed\":" << opts.tree.seed
+         << ",\"files\":" << tree_stats.files
+         << ",\"bytes\":" << tree_stats.bytes
+         << ",\"directories\":" << tree_stats.directories
+         << ",\"generate_s\":" << generate_s << "},\n"
+         << "  \"config\": {\"compression\":\"" << core::COMPRESSION_NAMES.at(opts.comp_type)
+         << "\",\"level\":" << opts.level
+         << ",\"hash\":\"" << core::HASH_NAMES.at(opts.hash_type) << "\"},\n"
+         << "  \"runs\": [" << runs.str() << "\n  ]\n}\n";
+
+    if (opts.output == "-") {
+        std::cout << json.str();
+    } else {
+        std::ofstream out(opts.output);
+        if (!out) {
+            std::cerr << "Error: Cannot write '" << opts.output << "'" << std::endl;
+            return 1;
+        }
+        out << json.str();
+    }
+    return 0;
+}
@@ -0,0 +1,95 @@
+#ifndef PRISM_CORE_ARCHIVE_CATALOG_H
+#define PRISM_CORE_ARCHIVE_CATALOG_H
+
+#include <prism/core/types.h>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <cstdint>
+
+namespace prism {
+namespace core {
+
+class ArchiveCatalog;
+
+// A row of an ArchiveCatalog. Cheap to copy; valid while the catalog lives
+// and is not modified.
+class EntryView {
+public:
+    EntryView(const ArchiveCatalog& catalog, size_t row) : catalog(&catalog), row(row) {}
+
+    std::string_view path() const;
+    std::string file_hash() const;
+    uint64_t file_size() const;
+    uint64_t compressed_size() const;
+    uint64_t header_start_offset() const;
+    uint64_t data_start_offset() const;
+    uint64_t creation_time() const;
+    uint64_t modification_time() const;
+    uint32_t permissions() const;
+    uint32_t uid() const;
+    uint32_t gid() const;
+    CompressionType compression_type() const;
+    uint8_t level() const;
+    HashType hash_type() const;
+    bool is_solid() const;
+    bool is_sparse() const;
+    bool is_framed() const;
+    // Uncompressed size of the solid block or group holding this entry, 0 otherwise.
+    uint64_t block_size() const;
+    size_t index() const { return row; }
+
+    // A standalone copy, for the few calls that still take FileMetadata.
+    FileMetadata to_metadata() const;
+
+private:
+    const ArchiveCatalog* catalog;
+    size_t row;
+};
+
+// Every item of an archive, one row each. Paths share one arena, hashes are
+// kept packed to bytes, and the numeric fields sit in parallel arrays, so a
+// catalog of millions of entries is a handful of allocations.
+class ArchiveCatalog {
+public:
+    size_t size() const { return file_sizes.size(); }
+    bool empty() const { return file_sizes.empty(); }
+    EntryView operator[](size_t row) const { return EntryView(*this, row); }
+
+    void reserve(size_t rows);
+    // Adds item; solid block sizes are summed over the rows added.
+    void add(const FileMetadata& item);
+    // Adds item from a partial listing, taking its block size as given.
+    void add(const FileMetadata& item, uint64_t block_size);
+    // Reorders rows into archive order: by header offset, then data offset.
+    void sort_by_position();
+
+private:
+    friend class EntryView;
+    enum : uint8_t { ROW_SOLID = 0x01, ROW_SPARSE = 0x02, ROW_FRAMED = 0x04 };
+
+    std::string paths;
+    std::vector<uint64_t> path_ends;
+    std::vector<char> hashes;
+    std::vector<uint64_t> hash_starts;
+    std::vector<uint64_t> file_sizes;
+    std::vector<uint64_t> compressed_sizes;
+    std::vector<uint64_t> header_offsets;
+    std::vector<uint64_t> data_offsets;
+    std::vector<uint64_t> creation_times;
+    std::vector<uint64_t> modification_times;
+    std::vector<uint32_t> permission_bits;
+    std::vector<uint32_t> uids;
+    std::vector<uint32_t> gids;
+    std::vector<uint8_t> compression_types;
+    std::vector<uint8_t> levels;
+    std::vector<uint8_t> hash_types;
+    std::vector<uint8_t> flags;
+    std::unordered_map<uint64_t, uint64_t> block_sizes; // by header offset
+};
+
+}
+}
+
+#endif
@@ -5,10 +5,18 @@
 #include <vector>
 #include <atomic> 
 #include <mutex> 
+#include <ostream>
+#include <memory>
+#include <unordered_map>
+#include <string_view>
 #include <prism/core/types.h> 
+#include <prism/core/archive_catalog.h>
+#include <prism/core/archive_io.h>
+#include <prism/core/file_utils.h>
 #include <prism/core/result_types.h>
 #include <prism/core/logging.h> 
 #include <prism/core/ui_utils.h> 
+#include <prism/core/thread_pool.h>
 
 namespace prism {
 namespace core {
@@ -16,9 +24,50 @@ namespace core {
 ArchiveExtractionResult extract_archive(const std::string& archive_file, const std::string& output_dir, 
                      const std::vector<std::string>& files_to_extract, bool no_overwrite, bool no_verify, int num_threads, bool raw_output, bool use_basic_chars, bool no_preserve_props);
 
-void extract_non_solid_file(const std::string& archive_file, const FileMetadata& item, const std::string& output_dir, bool no_overwrite, bool no_verify, std::atomic<int>& files_extracted, std::atomic<int>& files_skipped, std::atomic<uint64_t>& bytes_extracted, std::atomic<int>& hash_mismatches, std::atomic<int>& hashes_checked, std::atomic<int>& progress_counter, size_t total_items_to_process, std::mutex& cout_mutex, bool raw_output, bool use_basic_chars, bool no_preserve_props, std::chrono::steady_clock::time_point start_time);
+// Writes the contents of the selected entries (all of them when
+// files_to_extract is empty) to out back to back, in archive order. Solid
+// blocks are decoded frame by frame, so memory stays bounded for any size.
+ArchiveExtractionResult extract_to_stream(const std::string& archive_file, const std::vector<std::string>& files_to_extract,
+                                          std::ostream& out, bool no_verify);
 
-void extract_solid_block(const std::string& archive_file, const std::vector<FileMetadata>& block_items, const std::string& output_dir, bool no_overwrite, bool no_verify, std::atomic<int>& files_extracted, std::atomic<int>& files_skipped, std::atomic<uint64_t>& bytes_extracted, std::atomic<int>& hash_mismatches, std::atomic<int>& hashes_checked, std::atomic<int>& progress_counter, size_t total_items_to_process, std::mutex& cout_mutex, bool raw_output, bool use_basic_chars, bool no_preserve_props, std::chrono::steady_clock::time_point start_time);
+// Keeps an archive open for many reads. The catalog and a path lookup are
+// built once, when the extractor opens, and every extraction shares one
+// pool, so a call costs only the entries it touches. Entries appended to the
+// archive after opening are not seen.
+class ArchiveExtractor {
+public:
+    // Opens archive_file and reads its catalog, from the path index when there is one.
+    explicit ArchiveExtractor(const std::string& archive_file, int num_threads = 1);
+    // Reads from source instead, such as an archive held in memory.
+    explicit ArchiveExtractor(std::shared_ptr<const ArchiveSource> source, int num_threads = 1);
+
+    ArchiveExtractor(const ArchiveExtractor&) = delete;
+    ArchiveExtractor& operator=(const ArchiveExtractor&) = delete;
+
+    const ArchiveCatalog& catalog() const { return items; }
+    bool contains(const std::string& path) const { return rows.count(path) != 0; }
+    // Returns the contents of one entry, checked against its hash unless
+    // no_verify. Throws if the entry is missing or does not verify.
+    std::vector<char> read_entry(const std::string& path, bool no_verify = false);
+    // extract_archive on the open archive, without progress output.
+    ArchiveExtractionResult extract(const std::vector<std::string>& files_to_extract, const std::string& output_dir,
+                                    bool no_overwrite, bool no_verify, bool no_preserve_props);
+
+private:
+    std::shared_ptr<const ArchiveSource> source;
+    ArchiveCatalog items;
+    std::unordered_map<std::string_view, size_t> rows; // views into items
+    ThreadPool pool;
+};
+
+void extract_non_solid_file(const ArchiveSource& source, const EntryView& item, const std::string& output_dir, bool no_overwrite, bool no_verify, std::atomic<int>& files_extracted, std::atomic<int>& files_skipped, std::atomic<uint64_t>& bytes_extracted, std::atomic<int>& hash_mismatches, std::atomic<int>& hashes_checked, ProgressReporter& progress, std::mutex& cout_mutex, bool no_preserve_props, DirectoryCache& directories);
+
+// Extracts a batch of non-solid entries in one task: payloads that lie close
+// together are read at once and the files are written as one batch.
+void extract_non_solid_files(const ArchiveSource& source, const std::vector<EntryView>& batch, const std::string& output_dir, bool no_overwrite, bool no_verify, std::atomic<int>& files_extracted, std::atomic<int>& files_skipped, std::atomic<uint64_t>& bytes_extracted, std::atomic<int>& hash_mismatches, std::atomic<int>& hashes_checked, ProgressReporter& progress, std::mutex& cout_mutex, bool no_preserve_props, DirectoryCache& directories);
+
+// block_items may be a subset of the block; block_size is the uncompressed size of the whole block.
+void extract_solid_block(const ArchiveSource& source, const std::vector<EntryView>& block_items, uint64_t block_size, const std::string& output_dir, bool no_overwrite, bool no_verify, std::atomic<int>& files_extracted, std::atomic<int>& files_skipped, std::atomic<uint64_t>& bytes_extracted, std::atomic<int>& hash_mismatches, std::atomic<int>& hashes_checked, ProgressReporter& progress, std::mutex& cout_mutex, bool no_preserve_props, DirectoryCache& directories);
 
 } 
 } 
@@ -0,0 +1,80 @@
+#ifndef PRISM_CORE_ARCHIVE_INDEX_H
+#define PRISM_CORE_ARCHIVE_INDEX_H
+
+#include <prism/core/types.h>
+#include <prism/core/archive_catalog.h>
+#include <prism/core/archive_io.h>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+namespace prism {
+namespace core {
+
+// The index sits at the end of the archive:
+//   "PIDX", u8 comp, u8 level, u64 count, u64 chunk_count,
+//   u64 chunk_offsets[chunk_count], chunks, then a trailer of u64 index_offset
+//   and "PIDX".
+// Each chunk holds up to INDEX_CHUNK_RECORDS records sorted by path: u32
+// first_path_len, first_path, u64 raw_size, u64 stored_size, then the records
+// front-coded and varint encoded (metadata_codec.h), compressed with comp.
+// Records carry everything extraction needs, so a lookup never touches the
+// entries themselves. Chunk offsets are relative to the index start.
+
+const uint64_t INDEX_CHUNK_RECORDS = 64;
+
+struct IndexedItem {
+    FileMetadata item;
+    uint64_t block_size = 0; // uncompressed size of the solid block or group, 0 otherwise
+};
+
+// Binary searches the chunk first paths on disk, then decodes one chunk.
+class ArchiveIndex {
+public:
+    // False when the archive carries no index.
+    bool open(const std::string& archive_file);
+    bool open(std::shared_ptr<const ArchiveSource> source);
+
+    uint64_t size() const { return count; }
+    bool find(const std::string& path, IndexedItem& found);
+    // Every item whose path starts with prefix, in path order.
+    std::vector<IndexedItem> find_prefix(const std::string& prefix);
+    // Adds every item to catalog, in path order.
+    void read_all(ArchiveCatalog& catalog);
+
+private:
+    uint64_t lower_bound(const std::string& path);
+    const IndexedItem& item_at(uint64_t position);
+    const std::vector<IndexedItem>& load_chunk(uint64_t chunk);
+    std::string first_path(uint64_t chunk);
+    uint64_t chunk_offset(uint64_t chunk);
+
+    std::shared_ptr<const ArchiveSource> source;
+    SourceStream in;
+    uint64_t index_offset = 0;
+    uint64_t index_end = 0;
+    uint64_t count = 0;
+    uint64_t chunk_count = 0;
+    CompressionType comp_type = CompressionType::NONE;
+    uint64_t loaded_chunk = UINT64_MAX;
+    std::vector<IndexedItem> loaded_items;
+};
+
+// Rebuilds the index of archive_file from its entries and appends it,
+// replacing any index already there.
+void write_archive_index(const std::string& archive_file);
+// Writes an index of catalog to sink, for writers that already hold every
+// entry of the archive; sink must be at the end of the entries.
+void write_archive_index(ArchiveSink& sink, const ArchiveCatalog& catalog);
+// Truncates the index off archive_file so entries can be appended after the
+// last block. Returns false if there was none.
+bool remove_archive_index(const std::string& archive_file);
+// Sets the header version of archive_file to ARCHIVE_VERSION, before records
+// or an index of this version are added to an older archive.
+void update_archive_version(const std::string& archive_file);
+
+}
+}
+
+#endif
@@ -0,0 +1,156 @@
+#ifndef PRISM_CORE_ARCHIVE_IO_H
+#define PRISM_CORE_ARCHIVE_IO_H
+
+#include <functional>
+#include <istream>
+#include <memory>
+#include <mutex>
+#include <fstream>
+#include <streambuf>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+namespace prism {
+namespace core {
+
+// Where archive bytes are read from. read_at is positional and may be called
+// from several threads at once.
+class ArchiveSource {
+public:
+    virtual ~ArchiveSource() = default;
+    virtual uint64_t size() const = 0;
+    // Copies up to size bytes at offset into data and returns how many; fewer only at the end.
+    virtual size_t read_at(uint64_t offset, char* data, size_t size) const = 0;
+};
+
+// Where a new archive is written. Bytes are only ever appended.
+class ArchiveSink {
+public:
+    virtual ~ArchiveSink() = default;
+    // Throws if the bytes cannot be written.
+    virtual void write(const char* data, size_t size) = 0;
+    // Size of the archive written so far, which is the offset of the next byte.
+    virtual uint64_t position() const = 0;
+    virtual void flush() {}
+};
+
+class FileSource : public ArchiveSource {
+public:
+    // Throws if path cannot be opened.
+    explicit FileSource(const std::string& path);
+    ~FileSource() override;
+
+    uint64_t size() const override { return file_size; }
+    size_t read_at(uint64_t offset, char* data, size_t size) const override;
+
+private:
+    std::string path;
+    uint64_t file_size = 0;
+#ifdef _WIN32
+    mutable std::mutex mutex;
+    mutable std::ifstream in;
+#else
+    int fd = -1;
+#endif
+};
+
+class MemorySource : public ArchiveSource {
+public:
+    explicit MemorySource(std::vector<char> data) : bytes(std::move(data)) {}
+
+    uint64_t size() const override { return bytes.size(); }
+    size_t read_at(uint64_t offset, char* data, size_t size) const override;
+    const std::vector<char>& data() const { return bytes; }
+
+private:
+    std::vector<char> bytes;
+};
+
+// Reads through read(offset, data, size), which follows read_at.
+class CallbackSource : public ArchiveSource {
+public:
+    using ReadFn = std::function<size_t(uint64_t, char*, size_t)>;
+    CallbackSource(uint64_t size, ReadFn read) : total_size(size), read(std::move(read)) {}
+
+    uint64_t size() const override { return total_size; }
+    size_t read_at(uint64_t offset, char* data, size_t size) const override { return read(offset, data, size); }
+
+private:
+    uint64_t total_size;
+    ReadFn read;
+};
+
+class FileSink : public ArchiveSink {
+public:
+    // Truncates path, or appends to it when append is set.
+    explicit FileSink(const std::string& path, bool append = false);
+
+    void write(const char* data, size_t size) override;
+    uint64_t position() const override { return written; }
+    void flush() override;
+
+private:
+    std::string path;
+    std::ofstream out;
+    uint64_t written = 0;
+};
+
+class MemorySink : public ArchiveSink {
+public:
+    void write(const char* data, size_t size) override { bytes.insert(bytes.end(), data, data + size); }
+    uint64_t position() const override { return bytes.size(); }
+    const std::vector<char>& data() const { return bytes; }
+    // Hands over the archive written so far and starts empty.
+    std::vector<char> take() { return std::move(bytes); }
+
+private:
+    std::vector<char> bytes;
+};
+
+// Passes every write to write(data, size), which throws on failure.
+class CallbackSink : public ArchiveSink {
+public:
+    using WriteFn = std::function<void(const char*, size_t)>;
+    explicit CallbackSink(WriteFn write) : write_fn(std::move(write)) {}
+
+    void write(const char* data, size_t size) override;
+    uint64_t position() const override { return written; }
+
+private:
+    WriteFn write_fn;
+    uint64_t written = 0;
+};
+
+// A buffered, seekable std::istream over a source, for the parsers that read
+// archives as streams. Each stream has its own position, so threads sharing a
+// source each use their own. The source must outlive the stream.
+class SourceStream : public std::istream {
+public:
+    SourceStream();
+    explicit SourceStream(const ArchiveSource& source);
+    void open(const ArchiveSource& source);
+
+private:
+    class Buffer : public std::streambuf {
+    public:
+        void reset(const ArchiveSource& new_source);
+
+    protected:
+        int_type underflow() override;
+        std::streamsize xsgetn(char* data, std::streamsize size) override;
+        pos_type seekoff(off_type offset, std::ios_base::seekdir dir, std::ios_base::openmode which) override;
+        pos_type seekpos(pos_type position, std::ios_base::openmode which) override;
+
+    private:
+        const ArchiveSource* source = nullptr;
+        uint64_t buffer_start = 0; // source offset of eback()
+        std::vector<char> buffer;
+    };
+    Buffer buf;
+};
+
+}
+}
+
+#endif
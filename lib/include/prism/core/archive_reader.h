@@ -2,18 +2,86 @@
 #define PRISM_CORE_ARCHIVE_READER_H
 
 #include <prism/core/types.h>
+#include <prism/core/archive_catalog.h>
+#include <prism/core/archive_io.h>
 #include <string>
+#include <istream>
+#include <memory>
 #include <vector>
 
 namespace prism {
 namespace core {
 
+// The decoded file records of one solid block or small-file group, with
+// what every entry of it shares.
+struct SolidRecords {
+    std::vector<char> records;
+    CompressionType comp_type = CompressionType::NONE;
+    uint8_t level = 0;
+    uint64_t data_start = 0;
+    uint64_t compressed_size = 0;
+    bool framed = false;
+};
+
+// Walks the entries of an archive in archive order, parsing headers only as
+// they are asked for, so work on the first entries can start before the
+// rest are read. A solid block or group is held as its decoded records and
+// parsed one entry per call.
+class ArchiveReader {
+public:
+    // Opens archive_file and checks its header; throws if it is not an archive.
+    explicit ArchiveReader(const std::string& archive_file);
+    explicit ArchiveReader(std::shared_ptr<const ArchiveSource> source);
+
+    // Fills item with the next entry and returns true, or returns false at the end.
+    bool next(FileMetadata& item);
+    // Uncompressed size of the solid block or group of the last entry, 0 otherwise.
+    uint64_t block_size() const { return pending_block_size; }
+
+private:
+    enum class Section { FIRST_BLOCK, ENTRIES, BLOCKS, DONE };
+    void read_more();
+    bool has_entry() const;
+    void take_entry(FileMetadata item);
+    void take_block(SolidRecords records);
+
+    std::shared_ptr<const ArchiveSource> source;
+    SourceStream f;
+    uint8_t flags = 0;
+    Section section = Section::FIRST_BLOCK;
+    uint64_t current_file_offset = 0;
+    FileMetadata entry;
+    bool pending_entry = false;
+    SolidRecords block;
+    size_t block_pos = 0;
+    uint64_t block_offset = 0;
+    uint64_t block_total = 0;
+    uint64_t pending_block_size = 0;
+};
+
+// Opens archive_file for the readers below; logs and throws if it is missing.
+std::shared_ptr<const ArchiveSource> open_archive_source(const std::string& archive_file);
+
+// Reads the metadata of every item in archive order, from the path index
+// when the archive has one.
+ArchiveCatalog read_archive_catalog(const std::string& archive_file);
+ArchiveCatalog read_archive_catalog(std::shared_ptr<const ArchiveSource> source);
 std::vector<FileMetadata> read_archive_metadata(const std::string& archive_file);
 
+// Reads the archive header from the start of f and returns its flags; logs
+// and throws on a bad magic, an unknown version or unknown flags.
+uint8_t read_archive_header(std::istream& f);
 bool is_solid_archive(const std::string& archive_file);
 
-FileMetadata read_non_solid_file_metadata(std::ifstream& f, uint64_t& current_offset);
-std::vector<FileMetadata> read_solid_block_metadata(std::ifstream& f, uint64_t& uncompressed_offset_counter, CompressionType& block_comp_type, uint8_t& block_level);
+FileMetadata read_non_solid_file_metadata(std::istream& f, uint64_t& current_offset);
+std::vector<FileMetadata> read_solid_block_metadata(std::istream& f, uint64_t& uncompressed_offset_counter, CompressionType& block_comp_type, uint8_t& block_level, uint64_t& compressed_block_size);
+// Reads a framed (SOLID_STREAM_FLAG) block; f is positioned at its compression byte.
+std::vector<FileMetadata> read_framed_block_metadata(std::istream& f);
+// Reads a small-file group of a non-solid archive; f is positioned just after its magic.
+std::vector<FileMetadata> read_solid_group_metadata(std::istream& f);
+// Adds the entries of block to catalog as a reader would list them, so a
+// writer can index what it wrote without reading it back.
+void add_solid_entries(ArchiveCatalog& catalog, const SolidRecords& block);
 
 } 
 } 
@@ -7,7 +7,7 @@
 namespace prism {
 namespace core {
 
-void remove_from_archive(const std::string& archive_file, const std::vector<std::string>& files_to_remove, bool ignore_errors, bool raw_output = false, bool use_basic_chars = false);
+void remove_from_archive(const std::string& archive_file, const std::vector<std::string>& files_to_remove, bool ignore_errors, bool raw_output = false, bool use_basic_chars = false, int num_threads = 1);
 
 } 
 } 
@@ -6,6 +6,8 @@
 #include <atomic> 
 #include <mutex> 
 #include <prism/core/types.h> 
+#include <prism/core/archive_catalog.h>
+#include <prism/core/archive_io.h>
 #include <prism/core/thread_pool.h> 
 #include <prism/core/ui_utils.h> 
 
@@ -14,9 +16,11 @@ namespace core {
 
 void verify_archive(const std::string& archive_file, bool raw_output = false, bool use_basic_chars = false, bool no_verify = false);
 
-void verify_non_solid_file(const std::string& archive_file, const FileMetadata& item, const std::string& temp_dir, std::atomic<int>& mismatches, std::atomic<int>& checked_files, std::atomic<int>& progress_counter, size_t total_items_to_process, bool raw_output, bool use_basic_chars, std::chrono::steady_clock::time_point start_time);
+// Checks a batch of non-solid entries in one task, hashing the decoded bytes
+// in memory. Payloads that lie close together are read at once.
+void verify_non_solid_files(const ArchiveSource& source, const std::vector<EntryView>& batch, std::atomic<int>& mismatches, std::atomic<int>& checked_files, ProgressReporter& progress, bool no_verify);
 
-void verify_solid_block(const std::string& archive_file, const std::vector<FileMetadata>& block_items, const std::string& temp_dir, std::atomic<int>& mismatches, std::atomic<int>& checked_files, std::atomic<int>& progress_counter, size_t total_items_to_process, bool raw_output, bool use_basic_chars, std::chrono::steady_clock::time_point start_time);
+void verify_solid_block(const ArchiveSource& source, const std::vector<EntryView>& block_items, std::atomic<int>& mismatches, std::atomic<int>& checked_files, ProgressReporter& progress, bool no_verify);
 
 } 
 } 
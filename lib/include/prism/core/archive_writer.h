@@ -3,8 +3,17 @@
 
 #include <prism/core/types.h>
 #include <prism/core/result_types.h>
+#include <prism/core/file_utils.h>
 #include <prism/core/logging.h> 
+#include <prism/core/archive_catalog.h>
+#include <prism/core/archive_io.h>
+#include <prism/core/thread_pool.h>
 #include <cstring> 
+#include <memory>
+#include <istream>
+#include <mutex>
+#include <set>
+#include <ostream>
 #include <string>
 #include <vector>
 #include <cstdint>
@@ -16,8 +25,8 @@ inline std::vector<char> create_archive_header(const std::string& archive_path,
                                    uint8_t level, HashType hash_type, const std::string& file_hash,
                                    uint64_t file_size, uint64_t compressed_size,
                                    uint64_t creation_time, uint64_t modification_time,
-                                   uint32_t permissions, uint32_t uid, uint32_t gid) {
-    log("Creating header for '" + archive_path + "'...", LOG_VERBOSE);
+                                   uint32_t permissions, uint32_t uid, uint32_t gid, bool sparse = false) {
+    PRISM_LOG(LOG_VERBOSE, "Creating header for '" + archive_path + "'...");
     
     std::vector<char> header;
     
@@ -27,7 +36,7 @@ inline std::vector<char> create_archive_header(const std::string& archive_path,
     }
     header.insert(header.end(), archive_path.begin(), archive_path.end());
     
-    header.push_back(static_cast<uint8_t>(compression_type));
+    header.push_back(static_cast<uint8_t>(compression_type) | (sparse ? SPARSE_ENTRY_FLAG : 0));
     header.push_back(level);
     header.push_back(static_cast<uint8_t>(hash_type));
     
@@ -60,17 +69,112 @@ inline std::vector<char> create_archive_header(const std::string& archive_path,
         header.push_back((gid >> (i * 8)) & 0xFF);
     }
     
-    log("Header creation complete.", LOG_VERBOSE);
+    PRISM_LOG(LOG_VERBOSE, "Header creation complete.");
     return header;
 }
 
+// Per-file record inside a solid block or small-file group.
+inline std::vector<char> create_solid_file_metadata(const std::string& archive_path, HashType hash_type, const std::string& file_hash, uint64_t file_size,
+                                                    uint64_t creation_time, uint64_t modification_time,
+                                                    uint32_t permissions, uint32_t uid, uint32_t gid) {
+
+    std::vector<char> metadata;
+
+    uint32_t path_len = archive_path.size();
+    metadata.resize(metadata.size() + 4);
+    memcpy(&metadata[metadata.size() - 4], &path_len, 4);
+    metadata.insert(metadata.end(), archive_path.begin(), archive_path.end());
+    
+    metadata.push_back(static_cast<uint8_t>(hash_type));
+    
+    uint16_t hash_len = file_hash.size();
+    metadata.resize(metadata.size() + 2);
+    memcpy(&metadata[metadata.size() - 2], &hash_len, 2);
+    metadata.insert(metadata.end(), file_hash.begin(), file_hash.end());
+    
+    metadata.resize(metadata.size() + 8);
+    memcpy(&metadata[metadata.size() - 8], &file_size, 8);
+
+    metadata.resize(metadata.size() + 8);
+    memcpy(&metadata[metadata.size() - 8], &creation_time, 8);
+    metadata.resize(metadata.size() + 8);
+    memcpy(&metadata[metadata.size() - 8], &modification_time, 8);
+    metadata.resize(metadata.size() + 4);
+    memcpy(&metadata[metadata.size() - 4], &permissions, 4);
+    metadata.resize(metadata.size() + 4);
+    memcpy(&metadata[metadata.size() - 4], &uid, 4);
+    metadata.resize(metadata.size() + 4);
+    memcpy(&metadata[metadata.size() - 4], &gid, 4);
+    
+    return metadata;
+}
+
 ArchiveCreationResult create_archive(const std::string& archive_file, const std::vector<std::string>& paths,
                    CompressionType comp_type, int level, HashType hash_type, 
-                   bool ignore_errors, const std::vector<std::string>& exclude_patterns, bool use_full_path, bool auto_yes = false, int num_threads = 1, bool raw_output = false, bool use_basic_chars = false, bool solid_mode = false);
+                   bool ignore_errors, const std::vector<std::string>& exclude_patterns, bool use_full_path, bool auto_yes = false, int num_threads = 1, bool raw_output = false, bool use_basic_chars = false, bool solid_mode = false, bool group_small_files = true);
+
+// Writes a streamed solid archive holding a single entry named entry_name
+// whose contents are read from input until EOF. The output is never seeked,
+// so out may be a pipe.
+ArchiveCreationResult create_archive_from_stream(std::istream& input, std::ostream& out, const std::string& entry_name,
+                                                 CompressionType comp_type, int level, HashType hash_type, int num_threads = 1);
 
 ArchiveCreationResult append_to_archive(const std::string& archive_file, const std::vector<std::string>& paths,
                       CompressionType comp_type, int level, HashType hash_type, 
-                      bool ignore_errors, const std::vector<std::string>& exclude_patterns, bool use_full_path, bool auto_yes = false, int num_threads = 1, bool raw_output = false, bool use_basic_chars = false, bool solid_mode = false);
+                      bool ignore_errors, const std::vector<std::string>& exclude_patterns, bool use_full_path, bool auto_yes = false, int num_threads = 1, bool raw_output = false, bool use_basic_chars = false, bool solid_mode = false, bool group_small_files = true);
+
+// Keeps a non-solid archive open for many small appends. The existing
+// entries are read once, when the writer opens; after that each add costs
+// only its own entry. Entries compress on the writer's pool and are written
+// as they finish, so their order in the archive follows completion. Adds
+// block while the pool has a few entries per thread waiting. The
+// path index is rewritten by close(); until then readers walk the entries.
+class ArchiveWriter {
+public:
+    // Opens archive_file, creating it if it does not exist. Throws for a solid archive.
+    ArchiveWriter(const std::string& archive_file, CompressionType comp_type, int level, HashType hash_type, int num_threads = 1);
+    // Writes a new archive to sink, which must be empty, such as a MemorySink.
+    ArchiveWriter(std::shared_ptr<ArchiveSink> sink, CompressionType comp_type, int level, HashType hash_type, int num_threads = 1);
+    // Closes the archive; errors are logged rather than thrown.
+    ~ArchiveWriter();
+
+    ArchiveWriter(const ArchiveWriter&) = delete;
+    ArchiveWriter& operator=(const ArchiveWriter&) = delete;
+
+    // Queues file_path to be stored as archive_path. Throws if archive_path is taken.
+    void add_file(const std::string& file_path, const std::string& archive_path);
+    // Queues data to be stored as archive_path, stamped with the current time.
+    void add_buffer(const std::string& archive_path, std::vector<char> data);
+    // Waits for every queued entry and flushes them to disk, rethrowing the first failure.
+    void flush();
+    // Flushes, writes the path index and lets go of the sink, then rethrows the
+    // first failure of a queued entry. Further adds throw.
+    void close();
+
+    size_t size() const { return entries.size(); }
+
+private:
+    void write_archive_start();
+    void reserve_path(const std::string& archive_path);
+    void write_entry(const std::string& archive_path, const std::vector<char>& data, const std::vector<FileExtent>& extents,
+                     uint64_t file_size, bool sparse, CompressionType entry_comp, const FileMetadata& props);
+
+    std::string archive_file; // empty when writing to a caller's sink
+    CompressionType comp_type;
+    int level;
+    HashType hash_type;
+    std::shared_ptr<ArchiveSink> sink;
+    std::mutex out_mutex;
+    ArchiveCatalog entries; // every entry of the archive, for the index
+    std::set<std::string> paths;
+    TaskGroup tasks;
+    bool closed = false;
+    ThreadPool pool; // last, so workers stop before the members they use go away
+};
+
+// Trial-compresses a sample of the compressible inputs; already-compressed
+// formats are counted at their full size since they are stored as-is.
+uint64_t estimate_archive_size(const std::vector<ManifestEntry>& manifest, CompressionType comp_type, int level, HashType hash_type, int num_threads = 1);
 
 } 
 } 
@@ -0,0 +1,37 @@
+#ifndef PRISM_CORE_BATCH_IO_H
+#define PRISM_CORE_BATCH_IO_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+namespace prism {
+namespace core {
+
+struct FileReadRequest {
+    std::string path;
+    uint64_t size_hint = 0;  // expected size; the file is still read to EOF
+    std::vector<char> data;
+    int error = 0;           // errno on failure
+};
+
+struct FileWriteRequest {
+    std::string path;
+    const char* data = nullptr;
+    uint64_t size = 0;
+    int error = 0;
+};
+
+// Reads or writes many whole files at once. With io_uring (PRISM_HAVE_IO_URING
+// and a kernel that allows it) opens, transfers and closes for a batch are
+// submitted together; otherwise each file is handled in turn. Failures are
+// reported per request and never throw.
+void read_files(std::vector<FileReadRequest>& requests);
+void write_files(std::vector<FileWriteRequest>& requests);
+
+bool batch_io_uses_io_uring();
+
+} 
+} 
+
+#endif 
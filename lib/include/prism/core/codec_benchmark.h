@@ -0,0 +1,29 @@
+#ifndef PRISM_CORE_CODEC_BENCHMARK_H
+#define PRISM_CORE_CODEC_BENCHMARK_H
+
+#include <prism/core/types.h>
+#include <prism/core/result_types.h>
+#include <string>
+#include <vector>
+
+namespace prism {
+namespace core {
+
+struct CodecBenchmarkOptions {
+    std::vector<CompressionType> codecs;  // empty: every codec
+    std::vector<int> levels;              // empty: 0-9; codecs without levels run once
+    std::vector<std::string> exclude_patterns;
+    uint64_t sample_bytes = 64ULL * 1024 * 1024;
+    int num_threads = 1;
+    bool solid = false;
+    double target_mbps = 100.0;           // aggregate compress throughput across num_threads
+};
+
+// Samples the input, compresses it with every requested codec/level in a
+// thread pool and marks the Pareto-optimal settings.
+CodecBenchmarkResult benchmark_codecs(const std::vector<std::string>& paths, const CodecBenchmarkOptions& options);
+
+} 
+} 
+
+#endif 
@@ -4,6 +4,9 @@
 #include <string>
 #include <vector>
 #include <cstdint>
+#include <iosfwd>
+#include <shared_mutex>
+#include <unordered_set>
 #include <prism/core/types.h>
 
 namespace prism {
@@ -17,13 +20,70 @@ std::string get_absolute_path(const std::string& path);
 
 uint64_t get_free_disk_space(const std::string& path);
 
-void list_files_recursive(const std::string& dir_path, std::vector<std::string>& files, const std::vector<std::string>& exclude_patterns);
+// One input file as seen by the directory walk.
+struct ManifestEntry {
+    std::string path;
+    uint64_t size;
+};
+
+// Exclude patterns compiled once. A pattern matches anywhere in the path;
+// '*' matches any run of characters and '?' matches a single character.
+class ExcludeMatcher {
+public:
+    ExcludeMatcher() = default;
+    explicit ExcludeMatcher(const std::vector<std::string>& patterns);
+
+    bool empty() const { return patterns.empty(); }
+    bool matches(const std::string& path) const;
+    // True when every path below dir_path is excluded, so the walker can skip it.
+    bool matches_directory(const std::string& dir_path) const;
+
+private:
+    struct Segment {
+        std::string text;
+        bool has_any_char;
+    };
+    struct CompiledPattern {
+        std::string source;
+        std::vector<Segment> segments;
+    };
+
+    static bool match_compiled(const CompiledPattern& pattern, const std::string& path);
+
+    std::vector<CompiledPattern> patterns;
+};
+
+void list_files_recursive(const std::string& dir_path, std::vector<std::string>& files, const ExcludeMatcher& excludes);
+void list_files_recursive(const std::string& dir_path, std::vector<ManifestEntry>& files, const ExcludeMatcher& excludes);
 bool match_pattern(const std::string& path, const std::string& pattern);
 bool should_exclude(const std::string& path, const std::vector<std::string>& exclude_patterns);
 bool should_compress(const std::string& file_path, CompressionType compression_type);
 
+// Reads a whole file into data with a buffer sized from the file size.
+// Returns false (errno set on POSIX) if the file cannot be opened or read.
+bool read_file_contents(const std::string& path, std::vector<char>& data);
+
+// Writes size bytes to path, preallocating large files up front so they are
+// laid out contiguously, and issuing the data in large writes.
+bool write_file_contents(const std::string& path, const char* data, uint64_t size);
+
+// Opens path in out, emptied and preallocated to size like write_file_contents,
+// for files written piece by piece. Failure is left in out's stream state.
+void open_preallocated(const std::string& path, uint64_t size, std::ofstream& out);
+
+// Directories known to exist, shared by extraction workers so each output
+// directory is created (and its components stat'ed) only once.
+class DirectoryCache {
+public:
+    void ensure(const std::string& dir_path);
+
+private:
+    std::shared_mutex mutex;
+    std::unordered_set<std::string> created;
+};
+
 bool get_file_properties(const std::string& path, FileMetadata& metadata);
-bool set_file_properties(const std::string& path, const FileMetadata& metadata);
+bool set_file_properties(const std::string& path, uint64_t modification_time, uint32_t permissions, uint32_t uid, uint32_t gid);
 
 } 
 } 
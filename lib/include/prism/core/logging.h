@@ -3,6 +3,7 @@
 
 #include <string>
 #include <functional>
+#include <atomic>
 
 namespace prism {
 namespace core {
@@ -19,8 +20,20 @@ enum LogLevel {
     LOG_SUCCESS
 };
 
+namespace detail {
+// Bit n is set when LogLevel n is enabled and a handler is installed.
+extern std::atomic<unsigned> g_active_log_levels;
+}
+
 void set_log_handler(LogHandler handler);
 
+// All levels are enabled by default; callers narrow this to the levels they display.
+void set_log_level_enabled(LogLevel level, bool enabled);
+
+inline bool log_enabled(LogLevel level) {
+    return (detail::g_active_log_levels.load(std::memory_order_relaxed) & (1u << level)) != 0;
+}
+
 void log(const std::string& msg, LogLevel level = LOG_INFO);
 
 void set_progress_bar_detailed(bool detailed);
@@ -28,4 +41,12 @@ void set_progress_bar_detailed(bool detailed);
 } 
 } 
 
-#endif
\ No newline at end of file
+// Evaluates msg only when the level is enabled, so disabled levels cost no formatting.
+#define PRISM_LOG(level, msg) \
+    do { \
+        if (::prism::core::log_enabled(level)) { \
+            ::prism::core::log((msg), (level)); \
+        } \
+    } while (0)
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef PRISM_CORE_MEMORY_BUDGET_H
+#define PRISM_CORE_MEMORY_BUDGET_H
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <cstdint>
+
+namespace prism {
+namespace core {
+
+// Bytes of file data that workers may hold at once, shared by every pool in
+// the process. Unlimited until set_limit is called; then acquire() is served
+// in arrival order, so a large request is never starved by smaller ones.
+class MemoryBudget {
+public:
+    static MemoryBudget& global();
+
+    // 0 removes the limit. Set it before any work starts.
+    void set_limit(uint64_t bytes);
+    uint64_t limit() const { return limit_bytes.load(std::memory_order_relaxed); }
+    // Most bytes held at once since the limit was set.
+    uint64_t peak() const;
+
+    // Blocks until bytes fit and returns the amount held. A request larger
+    // than the limit waits for every other holder and then takes the whole budget.
+    uint64_t acquire(uint64_t bytes);
+    void release(uint64_t bytes);
+
+private:
+    std::atomic<uint64_t> limit_bytes{0};
+    mutable std::mutex mutex;
+    std::condition_variable changed;
+    uint64_t in_use = 0;
+    uint64_t peak_bytes = 0;
+    uint64_t next_ticket = 0;
+    uint64_t serving = 0;
+};
+
+// Holds bytes of the global budget until destroyed. A task takes one
+// reservation covering everything it buffers; taking a second while holding
+// one could wait forever.
+class MemoryReservation {
+public:
+    explicit MemoryReservation(uint64_t bytes) : held(MemoryBudget::global().acquire(bytes)) {}
+    ~MemoryReservation() { MemoryBudget::global().release(held); }
+
+    MemoryReservation(const MemoryReservation&) = delete;
+    MemoryReservation& operator=(const MemoryReservation&) = delete;
+
+private:
+    uint64_t held;
+};
+
+}
+}
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef PRISM_CORE_METADATA_CODEC_H
+#define PRISM_CORE_METADATA_CODEC_H
+
+#include <prism/core/types.h>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+namespace prism {
+namespace core {
+
+// Set in a metadata_size field when the block that follows is compact:
+// varint raw size, then the compressed compact records. The low bits hold
+// the stored size either way.
+const uint64_t COMPACT_METADATA_FLAG = 1ULL << 63;
+
+// Compact metadata is written unless turned off (--plain-metadata).
+void set_compact_metadata(bool enabled);
+bool compact_metadata_enabled();
+
+void put_varint(std::vector<char>& out, uint64_t value);
+uint64_t get_varint(const std::vector<char>& in, size_t& pos);
+
+// Appends path front-coded against previous: shared prefix length, then the rest.
+void put_front_coded(std::vector<char>& out, std::string_view previous, std::string_view path);
+std::string get_front_coded(const std::vector<char>& in, size_t& pos, const std::string& previous);
+
+// Hex digests are packed to bytes; anything else is kept as is.
+void put_hash(std::vector<char>& out, const std::string& hash);
+std::string get_hash(const std::vector<char>& in, size_t& pos);
+
+// Converts a block of solid file records (create_solid_file_metadata) to the
+// stored form and returns the metadata_size field to write in front of it.
+std::vector<char> encode_metadata_block(const std::vector<char>& records, CompressionType comp_type, int level, uint64_t& size_field);
+// Returns the plain solid file records of a stored block.
+std::vector<char> decode_metadata_block(const std::vector<char>& stored, uint64_t size_field, CompressionType comp_type);
+
+}
+}
+
+#endif
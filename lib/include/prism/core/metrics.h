@@ -0,0 +1,120 @@
+#ifndef PRISM_CORE_METRICS_H
+#define PRISM_CORE_METRICS_H
+
+#include <prism/core/types.h>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+namespace prism {
+namespace core {
+
+enum class Stage : uint8_t {
+    WALK,
+    READ,
+    HASH,
+    COMPRESS,
+    WRITE,
+    DECOMPRESS,
+    SET_PROPERTIES,
+    COUNT
+};
+
+const char* stage_name(Stage stage);
+
+// Latencies bucketed by powers of two nanoseconds; bucket i holds [2^i, 2^(i+1)).
+class LatencyHistogram {
+public:
+    static constexpr size_t BUCKETS = 48;
+
+    void record(uint64_t ns);
+    void reset();
+    uint64_t count() const;
+    // Upper bound of the bucket holding the given quantile (0..1), in nanoseconds.
+    uint64_t quantile_ns(double q) const;
+    std::string to_json() const;
+
+private:
+    std::array<std::atomic<uint64_t>, BUCKETS> buckets{};
+};
+
+struct StageMetrics {
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> total_ns{0};
+    std::atomic<uint64_t> max_ns{0};
+    std::atomic<uint64_t> bytes{0};
+    LatencyHistogram latency;
+};
+
+struct CodecMetrics {
+    std::atomic<uint64_t> compress_calls{0};
+    std::atomic<uint64_t> compress_bytes_in{0};
+    std::atomic<uint64_t> compress_bytes_out{0};
+    std::atomic<uint64_t> compress_ns{0};
+    std::atomic<uint64_t> decompress_calls{0};
+    std::atomic<uint64_t> decompress_bytes_in{0};
+    std::atomic<uint64_t> decompress_bytes_out{0};
+    std::atomic<uint64_t> decompress_ns{0};
+};
+
+// Process-wide counters, disabled by default. When disabled every record
+// call returns after one relaxed load and timers never read the clock.
+class Metrics {
+public:
+    static Metrics& global();
+
+    void set_enabled(bool enabled);
+    bool enabled() const { return is_enabled.load(std::memory_order_relaxed); }
+    void reset();
+
+    void record_stage(Stage stage, uint64_t ns, uint64_t bytes);
+    void record_codec(CompressionType type, bool compress, uint64_t bytes_in, uint64_t bytes_out, uint64_t ns);
+    void record_task(uint64_t queue_wait_ns, uint64_t run_ns);
+
+    std::string to_json() const;
+
+private:
+    static constexpr size_t CODEC_SLOTS = 16;
+
+    std::atomic<bool> is_enabled{false};
+    std::array<StageMetrics, static_cast<size_t>(Stage::COUNT)> stages;
+    std::array<CodecMetrics, CODEC_SLOTS> codecs;
+    std::atomic<uint64_t> tasks{0};
+    LatencyHistogram queue_wait;
+    LatencyHistogram task_run;
+    std::atomic<uint64_t> queue_wait_total_ns{0};
+    std::atomic<uint64_t> task_run_total_ns{0};
+};
+
+// Times one stage from construction until stop() or destruction.
+class StageTimer {
+public:
+    explicit StageTimer(Stage stage) : stage(stage), active(Metrics::global().enabled()) {
+        if (active) start = std::chrono::steady_clock::now();
+    }
+    ~StageTimer() { stop(0); }
+
+    StageTimer(const StageTimer&) = delete;
+    StageTimer& operator=(const StageTimer&) = delete;
+
+    void stop(uint64_t bytes) {
+        if (!active) return;
+        active = false;
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+        Metrics::global().record_stage(stage, ns, bytes);
+    }
+
+private:
+    Stage stage;
+    bool active;
+    std::chrono::steady_clock::time_point start;
+};
+
+std::string json_escape(const std::string& text);
+
+} 
+} 
+
+#endif 
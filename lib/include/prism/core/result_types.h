@@ -2,7 +2,9 @@
 #define PRISM_CORE_RESULT_TYPES_H
 
 #include <cstdint>
+#include <string>
 #include <vector>
+#include <prism/core/types.h>
 
 namespace prism {
 namespace core {
@@ -26,6 +28,28 @@ struct ArchiveExtractionResult {
     std::vector<long long> thread_durations_ms;
 };
 
+struct CodecBenchmarkEntry {
+    CompressionType codec;
+    int level;
+    uint64_t input_bytes;      // whole input, not just the sample
+    uint64_t compressed_bytes; // estimated for the whole input
+    double ratio;              // input / output
+    double compress_mbps;      // per thread, over compressible sample bytes
+    double decompress_mbps;
+    bool pareto;
+    std::string error;
+};
+
+struct CodecBenchmarkResult {
+    uint64_t total_files;
+    uint64_t total_bytes;
+    uint64_t sampled_chunks;
+    uint64_t sampled_bytes;
+    uint64_t incompressible_bytes; // sampled bytes in already-compressed formats, stored as-is
+    std::vector<CodecBenchmarkEntry> entries;
+    int recommended;               // index into entries, -1 if nothing qualifies
+};
+
 } 
 } 
 
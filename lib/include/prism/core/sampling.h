@@ -0,0 +1,36 @@
+#ifndef PRISM_CORE_SAMPLING_H
+#define PRISM_CORE_SAMPLING_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <prism/core/file_utils.h>
+
+namespace prism {
+namespace core {
+
+// A byte range read from one input file. weight is the number of input bytes
+// the range stands for, so sum(weight) equals the manifest's total size.
+struct SampleChunk {
+    std::string path;
+    uint64_t offset;
+    uint64_t length;
+    double weight;
+    bool compressible;
+    std::vector<char> data;
+};
+
+// Picks chunks at evenly spaced byte positions across the manifest
+// (probability proportional to size), so large files are not drowned out
+// by many small ones and vice versa. Deterministic for a given manifest.
+std::vector<SampleChunk> select_sample(const std::vector<ManifestEntry>& manifest, uint64_t budget_bytes,
+                                       uint64_t max_chunk_bytes = 1024 * 1024);
+
+// Reads data for every chunk; chunks that cannot be read are dropped and their
+// weight is spread over the rest.
+void load_sample(std::vector<SampleChunk>& chunks);
+
+} 
+} 
+
+#endif 
@@ -0,0 +1,90 @@
+#ifndef PRISM_CORE_SOLID_STREAM_H
+#define PRISM_CORE_SOLID_STREAM_H
+
+#include <prism/core/types.h>
+#include <prism/core/archive_catalog.h>
+#include <prism/core/thread_pool.h>
+#include <prism/core/archive_io.h>
+#include <deque>
+#include <functional>
+#include <future>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+namespace prism {
+namespace core {
+
+// Framed solid data is a run of [u32 raw_size][u32 compressed_size][bytes]
+// frames closed by a frame whose raw_size is 0. Each frame is compressed on
+// its own, so neither side has to hold the whole block in memory.
+const uint32_t SOLID_FRAME_SIZE = 16 * 1024 * 1024;
+
+// Cuts the bytes it is given into frames, compresses up to max_in_flight
+// frames at once on pool, and writes them to out in order.
+class SolidFrameWriter {
+public:
+    SolidFrameWriter(std::ostream& out, CompressionType comp_type, int level, ThreadPool& pool, size_t max_in_flight);
+
+    void write(const char* data, size_t size);
+    // Writes the remaining frames and the end marker; returns the framed size.
+    uint64_t finish();
+
+private:
+    struct EncodedFrame {
+        uint32_t raw_size;
+        std::vector<char> data;
+    };
+
+    void submit_frame();
+    void drain(size_t keep);
+
+    std::ostream& out;
+    CompressionType comp_type;
+    int level;
+    ThreadPool& pool;
+    size_t max_in_flight;
+    std::vector<char> current;
+    std::deque<std::future<EncodedFrame>> pending;
+    uint64_t bytes_written = 0;
+};
+
+// Frames a SolidFrameWriter may keep in flight: one per worker and one more,
+// or fewer if the memory limit cannot also cover other_bytes. A frame is held
+// with its compressed copy.
+size_t solid_frames_in_flight(int num_threads, uint64_t other_bytes);
+
+// Bytes held while decoding the block holding item: a framed block keeps
+// about three frames and a compressed one at a time, older blocks are read whole.
+uint64_t solid_block_memory(const EntryView& item, uint64_t block_size);
+
+// Walks the frame headers from the current position to the end marker and
+// leaves in just past it. Returns the framed size.
+uint64_t skip_solid_frames(std::istream& in);
+
+// Reads and decodes the framed block starting at offset.
+std::vector<char> read_solid_frames(std::istream& in, uint64_t offset, CompressionType comp_type, uint64_t expected_size);
+
+// Decodes the solid block or group that item belongs to piece by piece and
+// hands each piece to consume with its offset in the block. Framed blocks go
+// one frame at a time, the next frame decoding while consume runs, and frames
+// for which wanted(begin, end) is false are skipped without decoding. Unframed
+// blocks are decoded whole and passed as a single piece.
+void decode_solid_block(const std::string& archive_file, const FileMetadata& item, uint64_t block_size,
+                        const std::function<bool(uint64_t, uint64_t)>& wanted,
+                        const std::function<void(uint64_t, const char*, size_t)>& consume);
+void decode_solid_block(const ArchiveSource& source, const FileMetadata& item, uint64_t block_size,
+                        const std::function<bool(uint64_t, uint64_t)>& wanted,
+                        const std::function<void(uint64_t, const char*, size_t)>& consume);
+
+// Reads and decodes the whole solid block or small-file group that item
+// belongs to, framed or not. block_size is the block's uncompressed size.
+std::vector<char> read_solid_block(const std::string& archive_file, const FileMetadata& item, uint64_t block_size);
+std::vector<char> read_solid_block(const ArchiveSource& source, const FileMetadata& item, uint64_t block_size);
+
+} 
+} 
+
+#endif 
@@ -0,0 +1,38 @@
+#ifndef PRISM_CORE_SPARSE_H
+#define PRISM_CORE_SPARSE_H
+
+#include <prism/core/types.h>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+namespace prism {
+namespace core {
+
+// Files smaller than this are never treated as sparse.
+const uint64_t SPARSE_MIN_FILE_SIZE = 64 * 1024;
+
+// Fills extents with the data regions of path and returns true only if the
+// file has holes (found via SEEK_DATA/SEEK_HOLE where the platform has them).
+bool get_data_extents(const std::string& path, std::vector<FileExtent>& extents, uint64_t& file_size);
+
+// Reads just the given extents, concatenated, into data.
+bool read_extents(const std::string& path, const std::vector<FileExtent>& extents, std::vector<char>& data);
+
+// Creates path with the given apparent size, writing only the data extents.
+bool write_sparse_file(const std::string& path, uint64_t file_size, const std::vector<FileExtent>& extents, const char* data);
+
+// Hashes the file the extents describe, holes included, so the result matches
+// a hash of the whole file.
+std::string hash_sparse_contents(const std::vector<FileExtent>& extents, const char* data, uint64_t file_size, HashType hash_type);
+
+// A sparse entry's payload is an extent table followed by the compressed
+// concatenation of the data extents.
+std::vector<char> encode_sparse_payload(const std::vector<FileExtent>& extents, const std::vector<char>& compressed_data);
+std::vector<char> decode_sparse_payload(const std::vector<char>& payload, CompressionType compression_type,
+                                        uint64_t file_size, std::vector<FileExtent>& extents);
+
+} 
+} 
+
+#endif 
@@ -9,39 +9,140 @@
 #include <functional>
 #include <future>
 #include <atomic>
+#include <chrono>
+#include <exception>
+#include <cstdint>
+#include <prism/core/metrics.h>
 
 namespace prism {
 namespace core {
 
+// Queue depth per worker for bounded pools: deep enough to keep every worker
+// busy, shallow enough that queued work stays small.
+const size_t QUEUED_TASKS_PER_THREAD = 4;
+
+// Small items go to a pool in batches of up to TASK_BATCH_ITEMS items and
+// about TASK_BATCH_BYTES, so the fixed cost of a task is paid per batch.
+const size_t TASK_BATCH_ITEMS = 64;
+const uint64_t TASK_BATCH_BYTES = 1024 * 1024;
+
+// Splits items, in order, into task batches by count and size_of(item).
+// An item of TASK_BATCH_BYTES or more gets a batch to itself. Items are
+// moved into the batches.
+template<class T, class SizeOf>
+std::vector<std::vector<T>> make_task_batches(std::vector<T> items, SizeOf size_of) {
+    std::vector<std::vector<T>> batches;
+    std::vector<T> current;
+    uint64_t current_bytes = 0;
+    for (auto& item : items) {
+        uint64_t size = size_of(item);
+        if (!current.empty() && (current.size() >= TASK_BATCH_ITEMS || current_bytes + size > TASK_BATCH_BYTES)) {
+            batches.push_back(std::move(current));
+            current.clear();
+            current_bytes = 0;
+        }
+        current.push_back(std::move(item));
+        current_bytes += size;
+    }
+    if (!current.empty()) batches.push_back(std::move(current));
+    return batches;
+}
+
+// Counts the tasks handed to ThreadPool::submit so they can be waited for
+// without a future each. The first exception a task throws is kept and
+// rethrown by wait().
+class TaskGroup {
+public:
+    // Blocks until every submitted task has finished, then rethrows the first failure.
+    void wait();
+    // True once a task has thrown; producers can stop submitting early.
+    bool failed() const { return has_error.load(std::memory_order_relaxed); }
+
+private:
+    friend class ThreadPool;
+    void add();
+    void finish(std::exception_ptr task_error);
+
+    std::mutex mutex;
+    std::condition_variable all_done;
+    size_t outstanding = 0;
+    std::exception_ptr error;
+    std::atomic<bool> has_error{false};
+};
+
 class ThreadPool {
 public:
-    ThreadPool(size_t threads);
+    // With max_queued set, enqueue and submit block while that many tasks
+    // wait to start, so a producer cannot run far ahead of the workers. A
+    // task must not submit to its own bounded pool.
+    ThreadPool(size_t threads, size_t max_queued = 0);
     ~ThreadPool();
 
     template<class F, class... Args>
     auto enqueue(F&& f, Args&&... args) 
         -> std::future<typename std::result_of<F(Args...)>::type>;
 
+    // Runs f on the pool as part of group, with no future to keep.
+    template<class F>
+    void submit(TaskGroup& group, F&& f);
+
     std::vector<long long> get_thread_durations();
 
 private:
+    struct QueuedTask {
+        std::function<void()> fn;
+        std::chrono::steady_clock::time_point enqueued_at;
+    };
+
+    void push(std::function<void()> fn);
+
     std::vector<std::thread> workers;
-    std::queue<std::function<void()>> tasks;
+    std::queue<QueuedTask> tasks;
+    size_t max_queued;
 
     std::mutex queue_mutex;
     std::condition_variable condition;
+    std::condition_variable space;
     bool stop;
 
+    // Busy time per worker in nanoseconds; reported in milliseconds.
     std::vector<std::atomic<long long>> thread_durations;
 };
 
 
-inline ThreadPool::ThreadPool(size_t threads) : stop(false), thread_durations(threads) {
+inline void TaskGroup::add() {
+    std::lock_guard<std::mutex> lock(mutex);
+    outstanding++;
+}
+
+inline void TaskGroup::finish(std::exception_ptr task_error) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (task_error && !error) {
+        error = task_error;
+        has_error = true;
+    }
+    if (--outstanding == 0) all_done.notify_all();
+}
+
+inline void TaskGroup::wait() {
+    std::unique_lock<std::mutex> lock(mutex);
+    all_done.wait(lock, [this] { return outstanding == 0; });
+    if (error) {
+        // The group can be reused once its failure has been reported.
+        std::exception_ptr first = error;
+        error = nullptr;
+        has_error = false;
+        std::rethrow_exception(first);
+    }
+}
+
+
+inline ThreadPool::ThreadPool(size_t threads, size_t max_queued) : max_queued(max_queued), stop(false), thread_durations(threads) {
     for(size_t i = 0; i < threads; ++i) {
         thread_durations[i] = 0;
         workers.emplace_back([this, i] {
             for(;;) {
-                std::function<void()> task;
+                QueuedTask task;
                 {
                     std::unique_lock<std::mutex> lock(this->queue_mutex);
                     this->condition.wait(lock, [this]{ return this->stop || !this->tasks.empty(); });
@@ -50,12 +151,17 @@ inline ThreadPool::ThreadPool(size_t threads) : stop(false), thread_durations(th
                     task = std::move(this->tasks.front());
                     this->tasks.pop();
                 }
+                this->space.notify_one();
                 auto start_time = std::chrono::steady_clock::now();
-                task();
+                task.fn();
                 auto end_time = std::chrono::steady_clock::now();
                 
-                auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
-                this->thread_durations[i] += duration.count();
+                auto run_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end_time - start_time).count();
+                this->thread_durations[i] += run_ns;
+                if (Metrics::global().enabled()) {
+                    auto wait_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(start_time - task.enqueued_at).count();
+                    Metrics::global().record_task(wait_ns, run_ns);
+                }
             }
         });
     }
@@ -72,16 +178,42 @@ auto ThreadPool::enqueue(F&& f, Args&&... args)
     );
         
     std::future<return_type> res = task->get_future();
+    push([task](){ (*task)(); });
+    return res;
+}
+
+template<class F>
+void ThreadPool::submit(TaskGroup& group, F&& f) {
+    group.add();
+    try {
+        push([&group, fn = std::forward<F>(f)]() mutable {
+            std::exception_ptr error;
+            try {
+                fn();
+            } catch (...) {
+                error = std::current_exception();
+            }
+            group.finish(error);
+        });
+    } catch (...) {
+        group.finish(nullptr);
+        throw;
+    }
+}
+
+inline void ThreadPool::push(std::function<void()> fn) {
     {
         std::unique_lock<std::mutex> lock(queue_mutex);
+        if (max_queued > 0) {
+            space.wait(lock, [this] { return stop || tasks.size() < max_queued; });
+        }
 
         if(stop)
             throw std::runtime_error("enqueue on stopped ThreadPool");
 
-        tasks.emplace([task](){ (*task)(); });
+        tasks.push(QueuedTask{std::move(fn), std::chrono::steady_clock::now()});
     }
     condition.notify_one();
-    return res;
 }
 
 
@@ -91,6 +223,7 @@ inline ThreadPool::~ThreadPool() {
         stop = true;
     }
     condition.notify_all();
+    space.notify_all();
     for(std::thread &worker: workers)
         worker.join();
 }
@@ -98,7 +231,7 @@ inline ThreadPool::~ThreadPool() {
 inline std::vector<long long> ThreadPool::get_thread_durations() {
     std::vector<long long> durations;
     for(size_t i = 0; i < thread_durations.size(); ++i) {
-        durations.push_back(thread_durations[i].load());
+        durations.push_back(thread_durations[i].load() / 1000000);
     }
     return durations;
 }
@@ -47,8 +47,32 @@ enum class HashType : uint8_t {
     BLAKE3 = 19
 };
 
+// Format version in the archive header. Version 3 adds small-file groups,
+// framed solid blocks, sparse entries, compact metadata and the path index.
+const uint16_t ARCHIVE_VERSION = 3;
+// Oldest version still read. Its records are a subset of version 3, so an
+// archive is moved up to ARCHIVE_VERSION when anything is added to it.
+const uint16_t MIN_ARCHIVE_VERSION = 2;
+
 const uint8_t SOLID_ARCHIVE_FLAG = 0x01;
+// Solid data is stored as compressed frames with the file records after it.
+const uint8_t SOLID_STREAM_FLAG = 0x02;
+// Header flags this version understands; archives with any other bit set are refused.
+const uint8_t KNOWN_ARCHIVE_FLAGS = SOLID_ARCHIVE_FLAG | SOLID_STREAM_FLAG;
+// Set in a non-solid entry's compression byte when its payload starts with an extent table.
+const uint8_t SPARSE_ENTRY_FLAG = 0x80;
 extern const char* SOLID_BLOCK_MAGIC;
+// Small files packed into one compressed group inside a non-solid archive.
+extern const char* SOLID_GROUP_MAGIC;
+// Appended solid block in the framed layout of SOLID_STREAM_FLAG.
+extern const char* SOLID_STREAM_MAGIC;
+// Sorted path index at the end of the archive; see archive_index.h.
+extern const char* ARCHIVE_INDEX_MAGIC;
+
+struct FileExtent {
+    uint64_t offset;
+    uint64_t length;
+};
 
 struct FileMetadata {
     std::string path;
@@ -66,6 +90,8 @@ struct FileMetadata {
     uint32_t uid;               
     uint32_t gid;               
     bool is_solid;
+    bool is_sparse = false;
+    bool is_framed = false;     // solid data is split into SOLID_STREAM_FLAG frames
 };
 
 extern const std::map<std::string, CompressionType> COMPRESSION_MAP;
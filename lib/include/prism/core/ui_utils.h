@@ -4,11 +4,58 @@
 #include <string>
 #include <cstdint>
 #include <chrono>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
 
 namespace prism {
 namespace core {
 
-void show_progress_bar(int current, int total, const std::string& file_path, uint64_t file_size, uint64_t compressed_size, std::chrono::steady_clock::time_point start_time, bool raw_output = false, bool use_basic_chars = false);
+// Collects progress in atomics and renders it from its own thread at a fixed
+// rate, so workers never wait on the terminal. total_bytes may be 0 when the
+// input size is unknown; the ETA then falls back to file counts.
+class ProgressReporter {
+public:
+    ProgressReporter(size_t total_files, uint64_t total_bytes, bool raw_output, bool use_basic_chars,
+                     std::mutex* output_mutex = nullptr, int refresh_hz = 10);
+    ~ProgressReporter();
+
+    ProgressReporter(const ProgressReporter&) = delete;
+    ProgressReporter& operator=(const ProgressReporter&) = delete;
+
+    void file_done(const std::string& file_path, uint64_t bytes_in, uint64_t bytes_out);
+    void add_total(size_t files, uint64_t bytes);
+    // Renders the final state and joins the reporter thread.
+    void stop();
+
+    size_t completed_files() const { return files_done.load(std::memory_order_relaxed); }
+
+private:
+    void run();
+    void render();
+
+    std::atomic<size_t> total_files;
+    std::atomic<uint64_t> total_bytes;
+    std::atomic<size_t> files_done{0};
+    std::atomic<uint64_t> bytes_in{0};
+    std::atomic<uint64_t> bytes_out{0};
+
+    bool raw_output;
+    bool use_basic_chars;
+    std::mutex* output_mutex;
+    std::chrono::milliseconds interval;
+    std::chrono::steady_clock::time_point start_time;
+
+    std::mutex current_file_mutex;
+    std::string current_file;
+
+    std::mutex wake_mutex;
+    std::condition_variable wake;
+    bool stopping = false;
+    std::thread thread;
+};
+
 void set_progress_bar_detailed(bool detailed);
 bool confirm_action(const std::string& message, bool auto_yes);
 
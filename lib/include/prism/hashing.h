@@ -1,6 +1,7 @@
 #ifndef PRISM_HASHING_H
 #define PRISM_HASHING_H
 
+#include <memory>
 #include <string>
 #include <vector>
 #include <prism/core/types.h>
@@ -12,6 +13,23 @@ namespace hashing {
 std::string calculate_hash(const std::string& file_path, prism::core::HashType hash_type);
 std::string calculate_hash_from_data(const std::vector<char>& data, prism::core::HashType hash_type);
 
+// Incremental form of calculate_hash_from_data for data that arrives in
+// pieces; finish() returns the same digest as hashing the whole buffer.
+class StreamHasher {
+public:
+    explicit StreamHasher(prism::core::HashType hash_type);
+    ~StreamHasher();
+    StreamHasher(const StreamHasher&) = delete;
+    StreamHasher& operator=(const StreamHasher&) = delete;
+
+    void update(const char* data, size_t size);
+    std::string finish();
+
+private:
+    struct State;
+    std::unique_ptr<State> state_;
+};
+
 } 
 } 
 
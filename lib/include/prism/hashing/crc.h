@@ -10,6 +10,7 @@ namespace hashing {
 
 std::string calculate_crc32_hash(const std::vector<char>& data);
 std::string calculate_crc64_hash(const std::vector<char>& data);
+uint64_t crc64_ecma_update(uint64_t crc, const unsigned char *buf, size_t len);
 
 } 
 } 
@@ -1,5 +1,6 @@
 #include <prism/compression.h>
 #include <prism/core/logging.h>
+#include <prism/core/metrics.h>
 #include "zlib.h"
 #include "bzip2.h"
 #include "lzma.h"
@@ -10,11 +11,12 @@
 #include "snappy.h" 
 #include "lzo.h"    
 #include <stdexcept> 
+#include <chrono>
 
 namespace prism {
 namespace compression {
 
-std::vector<char> compress_data(const std::vector<char>& data, prism::core::CompressionType comp_type, int level) {
+static std::vector<char> compress_dispatch(const std::vector<char>& data, prism::core::CompressionType comp_type, int level) {
     switch (comp_type) {
         case prism::core::CompressionType::NONE:
             return data;
@@ -43,7 +45,7 @@ std::vector<char> compress_data(const std::vector<char>& data, prism::core::Comp
     }
 }
 
-std::vector<char> decompress_data(const std::vector<char>& data, prism::core::CompressionType comp_type, size_t original_size) {
+static std::vector<char> decompress_dispatch(const std::vector<char>& data, prism::core::CompressionType comp_type, size_t original_size) {
     switch (comp_type) {
         case prism::core::CompressionType::NONE:
             return data;
@@ -72,5 +74,40 @@ std::vector<char> decompress_data(const std::vector<char>& data, prism::core::Co
     }
 }
 
+std::vector<char> compress_data(const std::vector<char>& data, prism::core::CompressionType comp_type, int level) {
+    prism::core::Metrics& metrics = prism::core::Metrics::global();
+    if (!metrics.enabled()) {
+        return compress_dispatch(data, comp_type, level);
+    }
+    auto start = std::chrono::steady_clock::now();
+    std::vector<char> result = compress_dispatch(data, comp_type, level);
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    metrics.record_codec(comp_type, true, data.size(), result.size(), ns);
+    return result;
+}
+
+std::vector<char> decompress_data(const std::vector<char>& data, prism::core::CompressionType comp_type, size_t original_size) {
+    prism::core::Metrics& metrics = prism::core::Metrics::global();
+    if (!metrics.enabled()) {
+        return decompress_dispatch(data, comp_type, original_size);
+    }
+    auto start = std::chrono::steady_clock::now();
+    std::vector<char> result = decompress_dispatch(data, comp_type, original_size);
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    metrics.record_codec(comp_type, false, data.size(), result.size(), ns);
+    return result;
+}
+
+bool codec_uses_level(prism::core::CompressionType comp_type) {
+    switch (comp_type) {
+        case prism::core::CompressionType::NONE:
+        case prism::core::CompressionType::SNAPPY:
+        case prism::core::CompressionType::LZO:
+            return false;
+        default:
+            return true;
+    }
+}
+
 } 
 } 
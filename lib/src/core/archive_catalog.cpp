@@ -0,0 +1,161 @@
+#include <prism/core/archive_catalog.h>
+#include <prism/core/metadata_codec.h>
+#include <algorithm>
+#include <numeric>
+
+namespace prism {
+namespace core {
+
+std::string_view EntryView::path() const {
+    uint64_t start = row == 0 ? 0 : catalog->path_ends[row - 1];
+    return std::string_view(catalog->paths).substr(start, catalog->path_ends[row] - start);
+}
+
+std::string EntryView::file_hash() const {
+    size_t pos = catalog->hash_starts[row];
+    return get_hash(catalog->hashes, pos);
+}
+
+uint64_t EntryView::file_size() const { return catalog->file_sizes[row]; }
+uint64_t EntryView::compressed_size() const { return catalog->compressed_sizes[row]; }
+uint64_t EntryView::header_start_offset() const { return catalog->header_offsets[row]; }
+uint64_t EntryView::data_start_offset() const { return catalog->data_offsets[row]; }
+uint64_t EntryView::creation_time() const { return catalog->creation_times[row]; }
+uint64_t EntryView::modification_time() const { return catalog->modification_times[row]; }
+uint32_t EntryView::permissions() const { return catalog->permission_bits[row]; }
+uint32_t EntryView::uid() const { return catalog->uids[row]; }
+uint32_t EntryView::gid() const { return catalog->gids[row]; }
+CompressionType EntryView::compression_type() const { return static_cast<CompressionType>(catalog->compression_types[row]); }
+uint8_t EntryView::level() const { return catalog->levels[row]; }
+HashType EntryView::hash_type() const { return static_cast<HashType>(catalog->hash_types[row]); }
+bool EntryView::is_solid() const { return (catalog->flags[row] & ArchiveCatalog::ROW_SOLID) != 0; }
+bool EntryView::is_sparse() const { return (catalog->flags[row] & ArchiveCatalog::ROW_SPARSE) != 0; }
+bool EntryView::is_framed() const { return (catalog->flags[row] & ArchiveCatalog::ROW_FRAMED) != 0; }
+
+uint64_t EntryView::block_size() const {
+    if (!is_solid()) return 0;
+    auto it = catalog->block_sizes.find(header_start_offset());
+    return it == catalog->block_sizes.end() ? 0 : it->second;
+}
+
+FileMetadata EntryView::to_metadata() const {
+    FileMetadata item;
+    item.path = std::string(path());
+    item.header_start_offset = header_start_offset();
+    item.data_start_offset = data_start_offset();
+    item.compression_type = compression_type();
+    item.level = level();
+    item.hash_type = hash_type();
+    item.file_hash = file_hash();
+    item.file_size = file_size();
+    item.compressed_size = compressed_size();
+    item.creation_time = creation_time();
+    item.modification_time = modification_time();
+    item.permissions = permissions();
+    item.uid = uid();
+    item.gid = gid();
+    item.is_solid = is_solid();
+    item.is_sparse = is_sparse();
+    item.is_framed = is_framed();
+    return item;
+}
+
+void ArchiveCatalog::reserve(size_t rows) {
+    path_ends.reserve(rows);
+    hash_starts.reserve(rows);
+    file_sizes.reserve(rows);
+    compressed_sizes.reserve(rows);
+    header_offsets.reserve(rows);
+    data_offsets.reserve(rows);
+    creation_times.reserve(rows);
+    modification_times.reserve(rows);
+    permission_bits.reserve(rows);
+    uids.reserve(rows);
+    gids.reserve(rows);
+    compression_types.reserve(rows);
+    levels.reserve(rows);
+    hash_types.reserve(rows);
+    flags.reserve(rows);
+}
+
+void ArchiveCatalog::add(const FileMetadata& item) {
+    add(item, 0);
+    if (item.is_solid) block_sizes[item.header_start_offset] += item.file_size;
+}
+
+void ArchiveCatalog::add(const FileMetadata& item, uint64_t block_size) {
+    paths += item.path;
+    path_ends.push_back(paths.size());
+    hash_starts.push_back(hashes.size());
+    put_hash(hashes, item.file_hash);
+    file_sizes.push_back(item.file_size);
+    compressed_sizes.push_back(item.compressed_size);
+    header_offsets.push_back(item.header_start_offset);
+    data_offsets.push_back(item.data_start_offset);
+    creation_times.push_back(item.creation_time);
+    modification_times.push_back(item.modification_time);
+    permission_bits.push_back(item.permissions);
+    uids.push_back(item.uid);
+    gids.push_back(item.gid);
+    compression_types.push_back(static_cast<uint8_t>(item.compression_type));
+    levels.push_back(item.level);
+    hash_types.push_back(static_cast<uint8_t>(item.hash_type));
+    flags.push_back((item.is_solid ? ROW_SOLID : 0) | (item.is_sparse ? ROW_SPARSE : 0) | (item.is_framed ? ROW_FRAMED : 0));
+    if (item.is_solid && block_size != 0) block_sizes[item.header_start_offset] = block_size;
+}
+
+namespace {
+template <typename T>
+void permute(std::vector<T>& values, const std::vector<size_t>& order) {
+    std::vector<T> sorted;
+    sorted.reserve(values.size());
+    for (size_t row : order) sorted.push_back(values[row]);
+    values.swap(sorted);
+}
+} // anonymous namespace
+
+void ArchiveCatalog::sort_by_position() {
+    std::vector<size_t> order(size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [this](size_t a, size_t b) {
+        if (header_offsets[a] != header_offsets[b]) return header_offsets[a] < header_offsets[b];
+        return data_offsets[a] < data_offsets[b];
+    });
+
+    std::string sorted_paths;
+    sorted_paths.reserve(paths.size());
+    std::vector<uint64_t> sorted_path_ends;
+    sorted_path_ends.reserve(size());
+    std::vector<char> sorted_hashes;
+    sorted_hashes.reserve(hashes.size());
+    std::vector<uint64_t> sorted_hash_starts;
+    sorted_hash_starts.reserve(size());
+    for (size_t row : order) {
+        sorted_paths += (*this)[row].path();
+        sorted_path_ends.push_back(sorted_paths.size());
+        uint64_t hash_end = row + 1 < size() ? hash_starts[row + 1] : hashes.size();
+        sorted_hash_starts.push_back(sorted_hashes.size());
+        sorted_hashes.insert(sorted_hashes.end(), hashes.begin() + hash_starts[row], hashes.begin() + hash_end);
+    }
+    paths.swap(sorted_paths);
+    path_ends.swap(sorted_path_ends);
+    hashes.swap(sorted_hashes);
+    hash_starts.swap(sorted_hash_starts);
+
+    permute(file_sizes, order);
+    permute(compressed_sizes, order);
+    permute(header_offsets, order);
+    permute(data_offsets, order);
+    permute(creation_times, order);
+    permute(modification_times, order);
+    permute(permission_bits, order);
+    permute(uids, order);
+    permute(gids, order);
+    permute(compression_types, order);
+    permute(levels, order);
+    permute(hash_types, order);
+    permute(flags, order);
+}
+
+} // namespace core
+} // namespace prism
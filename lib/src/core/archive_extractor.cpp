@@ -1,228 +1,550 @@
 #include <prism/core/archive_extractor.h>
 #include <prism/core/archive_reader.h>
+#include <prism/core/archive_index.h>
 #include <prism/core/file_utils.h>
 #include <prism/core/logging.h>
 #include <prism/compression.h>
 #include <prism/hashing.h>
 #include <prism/core/thread_pool.h>
+#include <prism/core/memory_budget.h>
 #include <prism/core/ui_utils.h>
+#include <prism/core/metrics.h>
+#include <prism/core/batch_io.h>
+#include <prism/core/sparse.h>
+#include <prism/core/solid_stream.h>
 #include <fstream>
 #include <iostream>
 #include <set>
+#include <map>
 #include <filesystem>
 #include <thread>
 #include <mutex>
 #include <atomic>
 #include <future>
+#include <memory>
+#include <functional>
+#include <algorithm>
 #include <stdexcept>
+#include <exception>
+#include <cstring>
 
 namespace fs = std::filesystem;
 
 namespace prism {
 namespace core {
 
-void extract_non_solid_file(const std::string& archive_file, const FileMetadata& item, const std::string& output_dir, bool no_overwrite, bool no_verify, std::atomic<int>& files_extracted, std::atomic<int>& files_skipped, std::atomic<uint64_t>& bytes_extracted, std::atomic<int>& hash_mismatches, std::atomic<int>& hashes_checked, std::atomic<int>& progress_counter, size_t total_items_to_process, std::mutex& cout_mutex, bool raw_output, bool use_basic_chars, bool no_preserve_props, std::chrono::steady_clock::time_point start_time) {
-    fs::path out_path = fs::path(output_dir) / item.path;
+namespace {
+// Rows named in files_to_extract, or every row when it is empty. Entries
+// ending in a slash select everything under that directory.
+std::vector<EntryView> match_items(const ArchiveCatalog& items, const std::vector<std::string>& files_to_extract) {
+    std::vector<EntryView> selected;
+    if (files_to_extract.empty()) {
+        selected.reserve(items.size());
+        for (size_t i = 0; i < items.size(); ++i) selected.push_back(items[i]);
+        return selected;
+    }
+
+    std::set<std::string_view> requested_files;
+    std::vector<std::string_view> requested_dirs;
+    for (const auto& path : files_to_extract) {
+        if (path.back() == '/' || path.back() == '\\') {
+            requested_dirs.push_back(path);
+        } else {
+            requested_files.insert(path);
+        }
+    }
+
+    for (size_t i = 0; i < items.size(); ++i) {
+        EntryView item = items[i];
+        std::string_view path = item.path();
+        if (requested_files.count(path)) {
+            selected.push_back(item);
+            continue;
+        }
+        for (const auto& dir : requested_dirs) {
+            if (path.substr(0, dir.size()) == dir) {
+                selected.push_back(item);
+                break; 
+            }
+        }
+    }
+    return selected;
+}
+
+// Selects the requested items in archive order. Named files are looked up in
+// the archive's path index when it has one, so the entries themselves are
+// never scanned and catalog only holds what was asked for.
+std::vector<EntryView> select_items(std::shared_ptr<const ArchiveSource> source, const std::vector<std::string>& files_to_extract,
+                                    ArchiveCatalog& catalog) {
+    ArchiveIndex index;
+    if (files_to_extract.empty() || !index.open(source)) {
+        catalog = read_archive_catalog(source);
+        return match_items(catalog, files_to_extract);
+    }
+
+    std::map<std::pair<uint64_t, uint64_t>, IndexedItem> selected;
+    auto add = [&](IndexedItem indexed) {
+        std::pair<uint64_t, uint64_t> position(indexed.item.header_start_offset, indexed.item.data_start_offset);
+        selected.emplace(position, std::move(indexed));
+    };
+    for (const auto& path : files_to_extract) {
+        if (path.back() == '/' || path.back() == '\\') {
+            for (auto& indexed : index.find_prefix(path)) add(std::move(indexed));
+        } else {
+            IndexedItem indexed;
+            if (index.find(path, indexed)) add(std::move(indexed));
+        }
+    }
+
+    catalog.reserve(selected.size());
+    for (const auto& entry : selected) {
+        catalog.add(entry.second.item, entry.second.block_size);
+    }
+    return match_items(catalog, {});
+}
+
+const size_t EXTRACT_BATCH_ROWS = 4096;
+// Largest gap between two payloads of a task batch that is still read through.
+const uint64_t BATCH_READ_GAP = 4096;
+
+// Reads the entries of source into catalogs of about EXTRACT_BATCH_ROWS
+// rows and hands each to handle as soon as it is parsed, so work can start
+// before the last header is read. A solid block never spans two batches.
+void read_in_batches(std::shared_ptr<const ArchiveSource> source, const std::function<void(std::shared_ptr<const ArchiveCatalog>)>& handle) {
+    ArchiveReader reader(source);
+    auto batch = std::make_shared<ArchiveCatalog>();
+    uint64_t last_block = UINT64_MAX;
+    FileMetadata item;
+    while (reader.next(item)) {
+        bool same_block = item.is_solid && item.header_start_offset == last_block;
+        if (!same_block && batch->size() >= EXTRACT_BATCH_ROWS) {
+            handle(batch);
+            batch = std::make_shared<ArchiveCatalog>();
+        }
+        batch->add(item, reader.block_size());
+        last_block = item.is_solid ? item.header_start_offset : UINT64_MAX;
+    }
+    if (!batch->empty()) handle(batch);
+}
+} // anonymous namespace
+
+void extract_non_solid_file(const ArchiveSource& source, const EntryView& item, const std::string& output_dir, bool no_overwrite, bool no_verify, std::atomic<int>& files_extracted, std::atomic<int>& files_skipped, std::atomic<uint64_t>& bytes_extracted, std::atomic<int>& hash_mismatches, std::atomic<int>& hashes_checked, ProgressReporter& progress, std::mutex& cout_mutex, bool no_preserve_props, DirectoryCache& directories) {
+    fs::path out_path = fs::path(output_dir) / item.path();
 
     if (no_overwrite && file_exists(out_path.string())) {
-        {
+        if (log_enabled(LOG_VERBOSE)) {
             std::lock_guard<std::mutex> lock(cout_mutex);
-            log("Skipping existing file: '" + item.path + "'", LOG_VERBOSE);
+            log("Skipping existing file: '" + std::string(item.path()) + "'", LOG_VERBOSE);
         }
         files_skipped++;
+        progress.file_done(std::string(item.path()), item.file_size(), 0);
         return;
     }
     
     if (out_path.has_parent_path()) {
-        fs::create_directories(out_path.parent_path());
+        directories.ensure(out_path.parent_path().string());
     }
     
-    std::vector<char> compressed(item.compressed_size);
+    MemoryReservation reservation(item.compressed_size() + item.file_size());
+    std::vector<char> compressed(item.compressed_size());
     {
-        std::ifstream in(archive_file, std::ios::binary);
-        if (!in) {
-            throw std::runtime_error("Cannot open archive: " + archive_file);
-        }
-        in.seekg(item.data_start_offset);
-        in.read(compressed.data(), item.compressed_size);
+        StageTimer read_timer(Stage::READ);
+        compressed.resize(source.read_at(item.data_start_offset(), compressed.data(), item.compressed_size()));
+        read_timer.stop(item.compressed_size());
     }
     
-    std::vector<char> decompressed = compression::decompress_data(compressed, 
-                                                                  item.compression_type,
-                                                                  item.file_size);
+    StageTimer decompress_timer(Stage::DECOMPRESS);
+    std::vector<FileExtent> extents;
+    std::vector<char> decompressed = item.is_sparse()
+        ? decode_sparse_payload(compressed, item.compression_type(), item.file_size(), extents)
+        : compression::decompress_data(compressed, item.compression_type(), item.file_size());
+    decompress_timer.stop(decompressed.size());
     
-    std::ofstream out_file(out_path, std::ios::binary);
-    if (!out_file) {
+    StageTimer write_timer(Stage::WRITE);
+    bool written;
+    if (item.is_sparse()) {
+        written = write_sparse_file(out_path.string(), item.file_size(), extents, decompressed.data());
+    } else {
+        written = write_file_contents(out_path.string(), decompressed.data(), decompressed.size());
+    }
+    write_timer.stop(decompressed.size());
+
+    if (!written) {
         {
             std::lock_guard<std::mutex> lock(cout_mutex);
             log("Warning: Cannot create file: '" + out_path.string() + "'", LOG_WARN);
         }
         return;
     }
-    
-    out_file.write(decompressed.data(), decompressed.size());
-    out_file.close();
 
     if (!no_preserve_props) {
-        set_file_properties(out_path.string(), item);
+        StageTimer props_timer(Stage::SET_PROPERTIES);
+        set_file_properties(out_path.string(), item.modification_time(), item.permissions(), item.uid(), item.gid());
     }
     
     files_extracted++;
-    bytes_extracted += item.file_size;
+    bytes_extracted += item.file_size();
     
-    if (!no_verify && item.hash_type != HashType::NONE) {
+    if (!no_verify && item.hash_type() != HashType::NONE) {
         hashes_checked++;
-        std::string calculated_hash = hashing::calculate_hash(out_path.string(), item.hash_type);
-        if (calculated_hash != item.file_hash) {
+        StageTimer hash_timer(Stage::HASH);
+        std::string calculated_hash;
+        if (item.is_sparse()) {
+            // Read back only the data extents; the holes hash as zeros.
+            std::vector<char> written_data;
+            read_extents(out_path.string(), extents, written_data);
+            calculated_hash = hash_sparse_contents(extents, written_data.data(), item.file_size(), item.hash_type());
+        } else {
+            calculated_hash = hashing::calculate_hash(out_path.string(), item.hash_type());
+        }
+        hash_timer.stop(decompressed.size());
+        if (calculated_hash != item.file_hash()) {
             hash_mismatches++;
             {
                 std::lock_guard<std::mutex> lock(cout_mutex);
-                log("Hash mismatch for '" + item.path + "'. Data may be corrupted.", LOG_WARN);
+                log("Hash mismatch for '" + std::string(item.path()) + "'. Data may be corrupted.", LOG_WARN);
             }
-        } else {
+        } else if (log_enabled(LOG_VERBOSE)) {
             std::lock_guard<std::mutex> lock(cout_mutex);
-            log("Hash verified for '" + item.path + "'", LOG_VERBOSE);
+            log("Hash verified for '" + std::string(item.path()) + "'", LOG_VERBOSE);
         }
     }
     
-    {
-        std::lock_guard<std::mutex> lock(cout_mutex);
-        int current_progress = ++progress_counter;
-        show_progress_bar(current_progress, total_items_to_process, item.path, item.file_size, item.compressed_size, start_time, raw_output, use_basic_chars);
-    }
+    progress.file_done(std::string(item.path()), item.file_size(), item.compressed_size());
 }
 
-void extract_solid_block(const std::string& archive_file, const std::vector<FileMetadata>& block_items, const std::string& output_dir, bool no_overwrite, bool no_verify, std::atomic<int>& files_extracted, std::atomic<int>& files_skipped, std::atomic<uint64_t>& bytes_extracted, std::atomic<int>& hash_mismatches, std::atomic<int>& hashes_checked, std::atomic<int>& progress_counter, size_t total_items_to_process, std::mutex& cout_mutex, bool raw_output, bool use_basic_chars, bool no_preserve_props, std::chrono::steady_clock::time_point start_time) {
-    if (block_items.empty()) return;
+void extract_non_solid_files(const ArchiveSource& source, const std::vector<EntryView>& batch, const std::string& output_dir, bool no_overwrite, bool no_verify, std::atomic<int>& files_extracted, std::atomic<int>& files_skipped, std::atomic<uint64_t>& bytes_extracted, std::atomic<int>& hash_mismatches, std::atomic<int>& hashes_checked, ProgressReporter& progress, std::mutex& cout_mutex, bool no_preserve_props, DirectoryCache& directories) {
+    if (batch.size() == 1) {
+        extract_non_solid_file(source, batch[0], output_dir, no_overwrite, no_verify, files_extracted, files_skipped, bytes_extracted, hash_mismatches, hashes_checked, progress, cout_mutex, no_preserve_props, directories);
+        return;
+    }
+
+    // Sparse entries write their holes as they go, so they are extracted one by one.
+    std::vector<EntryView> items;
+    for (const auto& item : batch) {
+        if (item.is_sparse()) {
+            extract_non_solid_file(source, item, output_dir, no_overwrite, no_verify, files_extracted, files_skipped, bytes_extracted, hash_mismatches, hashes_checked, progress, cout_mutex, no_preserve_props, directories);
+        } else {
+            items.push_back(item);
+        }
+    }
+    if (items.empty()) return;
+    std::sort(items.begin(), items.end(), [](const EntryView& a, const EntryView& b) {
+        return a.data_start_offset() < b.data_start_offset();
+    });
+
+    // Payloads separated by little more than their headers are read together.
+    uint64_t span_begin = items.front().data_start_offset();
+    uint64_t span_end = span_begin;
+    uint64_t compressed_total = 0;
+    uint64_t file_total = 0;
+    for (const auto& item : items) {
+        span_end = std::max(span_end, item.data_start_offset() + item.compressed_size());
+        compressed_total += item.compressed_size();
+        file_total += item.file_size();
+    }
+    bool one_read = span_end - span_begin <= compressed_total + items.size() * BATCH_READ_GAP;
+    MemoryReservation reservation((one_read ? span_end - span_begin : compressed_total) + file_total);
+    std::vector<char> span;
+    if (one_read) {
+        StageTimer read_timer(Stage::READ);
+        span.resize(span_end - span_begin);
+        span.resize(source.read_at(span_begin, span.data(), span.size()));
+        read_timer.stop(span.size());
+    }
+
+    struct Decoded {
+        EntryView item;
+        std::string out_path;
+        std::vector<char> data;
+    };
+    std::vector<Decoded> decoded;
+    decoded.reserve(items.size());
+    for (const auto& item : items) {
+        fs::path out_path = fs::path(output_dir) / item.path();
+        if (no_overwrite && file_exists(out_path.string())) {
+            if (log_enabled(LOG_VERBOSE)) {
+                std::lock_guard<std::mutex> lock(cout_mutex);
+                log("Skipping existing file: '" + std::string(item.path()) + "'", LOG_VERBOSE);
+            }
+            files_skipped++;
+            progress.file_done(std::string(item.path()), item.file_size(), 0);
+            continue;
+        }
+        if (out_path.has_parent_path()) {
+            directories.ensure(out_path.parent_path().string());
+        }
 
-    const FileMetadata& first_item = block_items[0];
+        std::vector<char> compressed;
+        if (one_read) {
+            uint64_t from = std::min<uint64_t>(item.data_start_offset() - span_begin, span.size());
+            uint64_t to = std::min<uint64_t>(from + item.compressed_size(), span.size());
+            compressed.assign(span.begin() + from, span.begin() + to);
+        } else {
+            StageTimer read_timer(Stage::READ);
+            compressed.resize(item.compressed_size());
+            compressed.resize(source.read_at(item.data_start_offset(), compressed.data(), item.compressed_size()));
+            read_timer.stop(compressed.size());
+        }
 
-    log("Debug: first_item.compressed_size = " + std::to_string(first_item.compressed_size), LOG_DEBUG);
+        StageTimer decompress_timer(Stage::DECOMPRESS);
+        std::vector<char> data = compression::decompress_data(compressed, item.compression_type(), item.file_size());
+        decompress_timer.stop(data.size());
+        decoded.push_back({item, out_path.string(), std::move(data)});
+    }
 
-    std::vector<char> compressed_block(first_item.compressed_size);
+    std::vector<FileWriteRequest> writes;
+    writes.reserve(decoded.size());
+    for (const auto& file : decoded) {
+        writes.push_back({file.out_path, file.data.data(), file.data.size(), 0});
+    }
     {
-        std::ifstream in(archive_file, std::ios::binary);
-        if (!in) {
-            throw std::runtime_error("Cannot open archive: " + archive_file);
-        }
-        in.seekg(first_item.header_start_offset);
-        in.read(compressed_block.data(), first_item.compressed_size);
+        StageTimer write_timer(Stage::WRITE);
+        write_files(writes);
+        uint64_t bytes_written = 0;
+        for (const auto& write : writes) bytes_written += write.size;
+        write_timer.stop(bytes_written);
     }
 
-    uint64_t total_uncompressed_size_in_block = 0;
-    for (const auto& item : block_items) {
-        total_uncompressed_size_in_block += item.file_size;
+    for (size_t i = 0; i < decoded.size(); ++i) {
+        const EntryView& item = decoded[i].item;
+        if (writes[i].error != 0) {
+            std::lock_guard<std::mutex> lock(cout_mutex);
+            log("Warning: Cannot create file: '" + decoded[i].out_path + "'", LOG_WARN);
+            continue;
+        }
+
+        if (!no_preserve_props) {
+            StageTimer props_timer(Stage::SET_PROPERTIES);
+            set_file_properties(decoded[i].out_path, item.modification_time(), item.permissions(), item.uid(), item.gid());
+        }
+
+        files_extracted++;
+        bytes_extracted += item.file_size();
+
+        // Small files are checked from the bytes just written rather than read back.
+        if (!no_verify && item.hash_type() != HashType::NONE) {
+            hashes_checked++;
+            StageTimer hash_timer(Stage::HASH);
+            std::string calculated_hash = hashing::calculate_hash_from_data(decoded[i].data, item.hash_type());
+            hash_timer.stop(decoded[i].data.size());
+            if (calculated_hash != item.file_hash()) {
+                hash_mismatches++;
+                std::lock_guard<std::mutex> lock(cout_mutex);
+                log("Hash mismatch for '" + std::string(item.path()) + "'. Data may be corrupted.", LOG_WARN);
+            } else if (log_enabled(LOG_VERBOSE)) {
+                std::lock_guard<std::mutex> lock(cout_mutex);
+                log("Hash verified for '" + std::string(item.path()) + "'", LOG_VERBOSE);
+            }
+        }
+
+        progress.file_done(std::string(item.path()), item.file_size(), item.compressed_size());
     }
-    log("Debug: total_uncompressed_size_in_block = " + std::to_string(total_uncompressed_size_in_block), LOG_DEBUG);
-    log("Debug: compressed_block.size() = " + std::to_string(compressed_block.size()), LOG_DEBUG);
+}
 
-    std::vector<char> decompressed_block = compression::decompress_data(compressed_block,
-                                                                      first_item.compression_type,
-                                                                      total_uncompressed_size_in_block);
-    log("Debug: decompressed_block.size() = " + std::to_string(decompressed_block.size()), LOG_DEBUG);
+void extract_solid_block(const ArchiveSource& source, const std::vector<EntryView>& block_items, uint64_t block_size, const std::string& output_dir, bool no_overwrite, bool no_verify, std::atomic<int>& files_extracted, std::atomic<int>& files_skipped, std::atomic<uint64_t>& bytes_extracted, std::atomic<int>& hash_mismatches, std::atomic<int>& hashes_checked, ProgressReporter& progress, std::mutex& cout_mutex, bool no_preserve_props, DirectoryCache& directories) {
+    if (block_items.empty()) return;
+
+    FileMetadata first_item = block_items[0].to_metadata();
 
+    PRISM_LOG(LOG_DEBUG, "Debug: first_item.compressed_size = " + std::to_string(first_item.compressed_size));
+    PRISM_LOG(LOG_DEBUG, "Debug: total_uncompressed_size_in_block = " + std::to_string(block_size));
+
+    struct Target {
+        EntryView item;
+        std::string out_path;
+    };
+    std::vector<Target> targets;
+    std::vector<FileWriteRequest> empty_writes;
+    std::vector<Target> empty_targets;
     for (const auto& item : block_items) {
-        fs::path out_path = fs::path(output_dir) / item.path;
+        fs::path out_path = fs::path(output_dir) / item.path();
 
         if (no_overwrite && file_exists(out_path.string())) {
-            {
+            if (log_enabled(LOG_VERBOSE)) {
                 std::lock_guard<std::mutex> lock(cout_mutex);
-                log("Skipping existing file: '" + item.path + "'", LOG_VERBOSE);
+                log("Skipping existing file: '" + std::string(item.path()) + "'", LOG_VERBOSE);
             }
             files_skipped++;
+            progress.file_done(std::string(item.path()), item.file_size(), 0);
             continue;
         }
 
         if (out_path.has_parent_path()) {
-            fs::create_directories(out_path.parent_path());
+            directories.ensure(out_path.parent_path().string());
         }
 
-        std::vector<char> file_data(decompressed_block.begin() + item.data_start_offset,
-                                    decompressed_block.begin() + item.data_start_offset + item.file_size);
-
-        std::ofstream out_file(out_path, std::ios::binary);
-        if (!out_file) {
+        if (item.file_size() == 0) {
+            empty_targets.push_back({item, out_path.string()});
+            empty_writes.push_back({out_path.string(), nullptr, 0, 0});
+        } else {
+            targets.push_back({item, out_path.string()});
+        }
+    }
+    std::sort(targets.begin(), targets.end(), [](const Target& a, const Target& b) {
+        return a.item.data_start_offset() < b.item.data_start_offset();
+    });
+
+    // Hashes are taken over the decoded bytes as they are written, so large
+    // files are never read back whole for verification.
+    auto finish_file = [&](const Target& target, bool written, const std::string& calculated_hash) {
+        const EntryView& item = target.item;
+        if (!written) {
             {
                 std::lock_guard<std::mutex> lock(cout_mutex);
-                log("Warning: Cannot create file: '" + out_path.string() + "'", LOG_WARN);
+                log("Warning: Cannot create file: '" + target.out_path + "'", LOG_WARN);
             }
-            continue;
+            return;
         }
 
-        out_file.write(file_data.data(), file_data.size());
-        out_file.close();
-
         if (!no_preserve_props) {
-            set_file_properties(out_path.string(), item);
+            StageTimer props_timer(Stage::SET_PROPERTIES);
+            set_file_properties(target.out_path, item.modification_time(), item.permissions(), item.uid(), item.gid());
         }
 
         files_extracted++;
-        bytes_extracted += item.file_size;
+        bytes_extracted += item.file_size();
 
-        if (!no_verify && item.hash_type != HashType::NONE) {
+        if (!no_verify && item.hash_type() != HashType::NONE) {
             hashes_checked++;
-            std::string calculated_hash = hashing::calculate_hash(out_path.string(), item.hash_type);
-            if (calculated_hash != item.file_hash) {
+            if (calculated_hash != item.file_hash()) {
                 hash_mismatches++;
                 {
                     std::lock_guard<std::mutex> lock(cout_mutex);
-                    log("Hash mismatch for '" + item.path + "'. Data may be corrupted.", LOG_WARN);
+                    log("Hash mismatch for '" + std::string(item.path()) + "'. Data may be corrupted.", LOG_WARN);
                 }
-            } else {
+            } else if (log_enabled(LOG_VERBOSE)) {
                 std::lock_guard<std::mutex> lock(cout_mutex);
-                log("Hash verified for '" + item.path + "'", LOG_VERBOSE);
+                log("Hash verified for '" + std::string(item.path()) + "'", LOG_VERBOSE);
             }
         }
 
-        {
-            std::lock_guard<std::mutex> lock(cout_mutex);
-            int current_progress = ++progress_counter;
-            show_progress_bar(current_progress, total_items_to_process, item.path, item.file_size, item.compressed_size, start_time, raw_output, use_basic_chars);
+        progress.file_done(std::string(item.path()), item.file_size(), 0);
+    };
+    auto hash_bytes = [&](const EntryView& item, const char* data, size_t size) {
+        if (no_verify || item.hash_type() == HashType::NONE) return std::string();
+        StageTimer hash_timer(Stage::HASH);
+        hashing::StreamHasher hasher(item.hash_type());
+        hasher.update(data, size);
+        hash_timer.stop(size);
+        return hasher.finish();
+    };
+
+    if (!empty_writes.empty()) {
+        write_files(empty_writes);
+        for (size_t i = 0; i < empty_writes.size(); ++i) {
+            finish_file(empty_targets[i], empty_writes[i].error == 0, hash_bytes(empty_targets[i].item, nullptr, 0));
         }
     }
-}
-
-ArchiveExtractionResult extract_archive(const std::string& archive_file, const std::string& output_dir, 
-                     const std::vector<std::string>& files_to_extract, bool no_overwrite, bool no_verify, int num_threads, bool raw_output, bool use_basic_chars, bool no_preserve_props) {
-    auto start_time = std::chrono::steady_clock::now();
-    std::vector<FileMetadata> items = read_archive_metadata(archive_file);
-    
-    std::vector<FileMetadata> items_to_process;
-    if (!files_to_extract.empty()) {
-        std::set<std::string> requested_files;
-        std::vector<std::string> requested_dirs;
-
-        for (const auto& path : files_to_extract) {
-            if (path.back() == '/' || path.back() == '\\') {
-                requested_dirs.push_back(path);
-            } else {
-                requested_files.insert(path);
-            }
+    if (targets.empty()) return;
+
+    // A file that runs past the end of the piece being written stays open
+    // until the piece holding its last byte arrives.
+    struct OpenFile {
+        size_t target;
+        std::ofstream out;
+        std::unique_ptr<hashing::StreamHasher> hasher;
+        uint64_t remaining;
+    };
+    std::unique_ptr<OpenFile> open_file;
+    size_t next_target = 0;
+
+    auto append_to_open_file = [&](const char* data, size_t size) {
+        StageTimer write_timer(Stage::WRITE);
+        open_file->out.write(data, size);
+        write_timer.stop(size);
+        if (open_file->hasher) {
+            StageTimer hash_timer(Stage::HASH);
+            open_file->hasher->update(data, size);
+            hash_timer.stop(size);
+        }
+        open_file->remaining -= size;
+        if (open_file->remaining == 0) {
+            open_file->out.close();
+            bool written = static_cast<bool>(open_file->out);
+            std::string calculated_hash = open_file->hasher ? open_file->hasher->finish() : std::string();
+            const Target& target = targets[open_file->target];
+            open_file.reset();
+            finish_file(target, written, calculated_hash);
+        }
+    };
+
+    auto wanted = [&](uint64_t begin, uint64_t end) {
+        // First target not wholly before this piece; ends are ordered like starts.
+        auto it = std::lower_bound(targets.begin(), targets.end(), begin, [](const Target& target, uint64_t offset) {
+            return target.item.data_start_offset() + target.item.file_size() <= offset;
+        });
+        return it != targets.end() && it->item.data_start_offset() < end;
+    };
+
+    auto consume = [&](uint64_t piece_offset, const char* piece, size_t piece_size) {
+        uint64_t piece_end = piece_offset + piece_size;
+        if (open_file) {
+            size_t take = std::min<uint64_t>(open_file->remaining, piece_size);
+            append_to_open_file(piece, take);
         }
 
-        for (const auto& item : items) {
-            if (requested_files.count(item.path)) {
-                items_to_process.push_back(item);
+        // Files that lie wholly inside this piece are written as one batch
+        // straight from the decoded buffer.
+        std::vector<FileWriteRequest> writes;
+        std::vector<size_t> written_targets;
+        while (!open_file && next_target < targets.size()) {
+            const Target& target = targets[next_target];
+            uint64_t start = target.item.data_start_offset();
+            uint64_t end = start + target.item.file_size();
+            if (start >= piece_end) break;
+            if (start < piece_offset) {
+                throw std::runtime_error("Corrupted solid block: file data out of order for '" + std::string(target.item.path()) + "'.");
+            }
+            const char* data = piece + (start - piece_offset);
+            if (end <= piece_end) {
+                writes.push_back({target.out_path, data, target.item.file_size(), 0});
+                written_targets.push_back(next_target++);
                 continue;
             }
-            for (const auto& dir : requested_dirs) {
-                if (item.path.rfind(dir, 0) == 0) {
-                    items_to_process.push_back(item);
-                    break; 
-                }
-                if (item.path.size() > dir.size() && item.path.rfind(dir, 0) == 0 && item.path[dir.size()] == '/') {
-                    items_to_process.push_back(item);
-                    break;
-                }
+
+            open_file.reset(new OpenFile{next_target++, std::ofstream(), nullptr, target.item.file_size()});
+            open_preallocated(target.out_path, target.item.file_size(), open_file->out);
+            if (!no_verify && target.item.hash_type() != HashType::NONE) {
+                open_file->hasher.reset(new hashing::StreamHasher(target.item.hash_type()));
             }
+            append_to_open_file(data, piece_end - start);
         }
-        
-        if (items_to_process.empty()) {
+
+        {
+            StageTimer write_timer(Stage::WRITE);
+            write_files(writes);
+            uint64_t bytes_written = 0;
+            for (const auto& write : writes) bytes_written += write.size;
+            write_timer.stop(bytes_written);
+        }
+        for (size_t i = 0; i < writes.size(); ++i) {
+            const Target& target = targets[written_targets[i]];
+            finish_file(target, writes[i].error == 0, hash_bytes(target.item, writes[i].data, writes[i].size));
+        }
+    };
+
+    MemoryReservation reservation(solid_block_memory(block_items[0], block_size));
+    decode_solid_block(source, first_item, block_size, wanted, consume);
+
+    if (open_file || next_target < targets.size()) {
+        throw std::runtime_error("Corrupted solid block: data ended before all files were written.");
+    }
+}
+
+ArchiveExtractionResult extract_archive(const std::string& archive_file, const std::string& output_dir, 
+                     const std::vector<std::string>& files_to_extract, bool no_overwrite, bool no_verify, int num_threads, bool raw_output, bool use_basic_chars, bool no_preserve_props) {
+    std::shared_ptr<const ArchiveSource> source = open_archive_source(archive_file);
+    // Named files are selected up front; a full extraction is fed to the
+    // workers batch by batch while the reader is still parsing headers.
+    auto selection = std::make_shared<ArchiveCatalog>();
+    std::vector<EntryView> selected;
+    if (!files_to_extract.empty()) {
+        selected = select_items(source, files_to_extract, *selection);
+        if (selected.empty()) {
             log("Warning: No matching files found in archive for the given paths", LOG_WARN);
             return {0, 0, 0, 0, 0, {}};
         }
-    } else {
-        items_to_process = items;
     }
     
     std::atomic<int> files_extracted = 0;
@@ -230,45 +552,68 @@ ArchiveExtractionResult extract_archive(const std::string& archive_file, const s
     std::atomic<uint64_t> bytes_extracted = 0;
     std::atomic<int> hash_mismatches = 0;
     std::atomic<int> hashes_checked = 0;
-    std::atomic<int> progress_counter = 0;
     
     std::mutex cout_mutex;
+    DirectoryCache directories;
     std::vector<long long> durations_ms;
+    size_t items_to_process = 0;
 
-    std::map<uint64_t, std::vector<FileMetadata>> solid_blocks;
-    std::vector<FileMetadata> non_solid_files;
-
-    for (const auto& item : items_to_process) {
-        if (!item.is_solid) {
-            non_solid_files.push_back(item);
-        } else {
-            solid_blocks[item.header_start_offset].push_back(item);
-        }
-    }
+    ProgressReporter progress(0, 0, raw_output, use_basic_chars, &cout_mutex);
 
     {
-        ThreadPool pool(num_threads);
-        std::vector<std::future<void>> results;
+        // The group outlives the pool, whose workers still finish queued tasks if reading fails.
+        // The pool's short queue holds the reader back while the workers catch up.
+        TaskGroup tasks;
+        ThreadPool pool(num_threads, num_threads * QUEUED_TASKS_PER_THREAD);
+
+        // Tasks carry views into their batch and keep the batch alive; no item is copied.
+        auto dispatch = [&](std::shared_ptr<const ArchiveCatalog> batch, const std::vector<EntryView>& items) {
+            // A failed task ends the extraction before more is queued.
+            if (tasks.failed()) tasks.wait();
+
+            uint64_t batch_bytes = 0;
+            std::map<uint64_t, std::vector<EntryView>> solid_blocks;
+            for (const auto& item : items) {
+                batch_bytes += item.file_size();
+                if (item.is_solid()) {
+                    solid_blocks[item.header_start_offset()].push_back(item);
+                }
+            }
+            items_to_process += items.size();
+            progress.add_total(items.size(), batch_bytes);
 
-        for (const auto& item : non_solid_files) {
-            results.emplace_back(pool.enqueue([&, item] {
-                extract_non_solid_file(archive_file, item, output_dir, no_overwrite, no_verify, files_extracted, files_skipped, bytes_extracted, hash_mismatches, hashes_checked, progress_counter, items_to_process.size(), cout_mutex, raw_output, use_basic_chars, no_preserve_props, start_time);
-            }));
-        }
+            std::vector<EntryView> non_solid;
+            for (const auto& item : items) {
+                if (!item.is_solid()) non_solid.push_back(item);
+            }
+            for (auto& files : make_task_batches(std::move(non_solid), [](const EntryView& item) { return item.file_size(); })) {
+                pool.submit(tasks, [&, batch, files = std::move(files)] {
+                    extract_non_solid_files(*source, files, output_dir, no_overwrite, no_verify, files_extracted, files_skipped, bytes_extracted, hash_mismatches, hashes_checked, progress, cout_mutex, no_preserve_props, directories);
+                });
+            }
+
+            for (auto& pair : solid_blocks) {
+                pool.submit(tasks, [&, batch, block_items = std::move(pair.second)] {
+                    extract_solid_block(*source, block_items, block_items[0].block_size(), output_dir, no_overwrite, no_verify, files_extracted, files_skipped, bytes_extracted, hash_mismatches, hashes_checked, progress, cout_mutex, no_preserve_props, directories);
+                });
+            }
+        };
 
-        for (const auto& pair : solid_blocks) {
-            results.emplace_back(pool.enqueue([&, pair] {
-                extract_solid_block(archive_file, pair.second, output_dir, no_overwrite, no_verify, files_extracted, files_skipped, bytes_extracted, hash_mismatches, hashes_checked, progress_counter, items_to_process.size(), cout_mutex, raw_output, use_basic_chars, no_preserve_props, start_time);
-            }));
+        if (files_to_extract.empty()) {
+            read_in_batches(source, [&](std::shared_ptr<const ArchiveCatalog> batch) {
+                dispatch(batch, match_items(*batch, {}));
+            });
+        } else {
+            dispatch(selection, selected);
         }
 
-        for(auto && result : results)
-            result.get();
+        tasks.wait();
         
         durations_ms = pool.get_thread_durations();
     }
-    
-    if (items_to_process.size() > 0 && !raw_output) std::cout << std::endl;
+
+    progress.stop();
+    if (items_to_process > 0 && !raw_output) std::cout << std::endl;
     
     log("Successfully extracted from archive '" + archive_file + "'", LOG_SUCCESS);
     log("Files extracted: " + std::to_string(files_extracted.load()), LOG_SUM);
@@ -292,5 +637,301 @@ ArchiveExtractionResult extract_archive(const std::string& archive_file, const s
     return {files_extracted.load(), files_skipped.load(), bytes_extracted.load(), hashes_checked.load(), hash_mismatches.load(), durations_ms};
 }
 
+
+ArchiveExtractor::ArchiveExtractor(const std::string& archive_file, int num_threads)
+    : ArchiveExtractor(open_archive_source(archive_file), num_threads) {}
+
+ArchiveExtractor::ArchiveExtractor(std::shared_ptr<const ArchiveSource> archive, int num_threads)
+    : source(std::move(archive)), items(read_archive_catalog(source)),
+      pool(num_threads, num_threads * QUEUED_TASKS_PER_THREAD) {
+    rows.reserve(items.size());
+    for (size_t i = 0; i < items.size(); ++i) {
+        rows.emplace(items[i].path(), i);
+    }
+}
+
+std::vector<char> ArchiveExtractor::read_entry(const std::string& path, bool no_verify) {
+    auto found = rows.find(path);
+    if (found == rows.end()) {
+        throw std::runtime_error("File not found in archive: " + path);
+    }
+    EntryView item = items[found->second];
+
+    std::vector<char> contents;
+    std::string calculated_hash;
+    bool verify = !no_verify && item.hash_type() != HashType::NONE;
+    if (!item.is_solid()) {
+        MemoryReservation reservation(item.compressed_size() + item.file_size());
+        std::vector<char> compressed(item.compressed_size());
+        {
+            StageTimer read_timer(Stage::READ);
+            if (source->read_at(item.data_start_offset(), compressed.data(), item.compressed_size()) < item.compressed_size()) {
+                throw std::runtime_error("Unexpected EOF while reading '" + path + "' from archive.");
+            }
+            read_timer.stop(item.compressed_size());
+        }
+
+        StageTimer decompress_timer(Stage::DECOMPRESS);
+        if (item.is_sparse()) {
+            // Sparse entries hold only the data extents; the holes read back as zeros.
+            std::vector<FileExtent> extents;
+            std::vector<char> data = decode_sparse_payload(compressed, item.compression_type(), item.file_size(), extents);
+            contents.assign(item.file_size(), 0);
+            size_t pos = 0;
+            for (const auto& extent : extents) {
+                memcpy(contents.data() + extent.offset, data.data() + pos, extent.length);
+                pos += extent.length;
+            }
+        } else {
+            contents = compression::decompress_data(compressed, item.compression_type(), item.file_size());
+        }
+        decompress_timer.stop(contents.size());
+        if (verify) calculated_hash = hashing::calculate_hash_from_data(contents, item.hash_type());
+    } else {
+        uint64_t begin = item.data_start_offset();
+        uint64_t end = begin + item.file_size();
+        contents.resize(item.file_size());
+        auto wanted = [&](uint64_t piece_begin, uint64_t piece_end) { return piece_begin < end && piece_end > begin; };
+        auto consume = [&](uint64_t offset, const char* data, size_t size) {
+            uint64_t from = std::max(offset, begin);
+            uint64_t to = std::min(offset + size, end);
+            if (from < to) memcpy(contents.data() + (from - begin), data + (from - offset), to - from);
+        };
+        if (item.file_size() > 0) {
+            MemoryReservation reservation(solid_block_memory(item, item.block_size()));
+            decode_solid_block(*source, item.to_metadata(), item.block_size(), wanted, consume);
+        }
+        if (verify) calculated_hash = hashing::calculate_hash_from_data(contents, item.hash_type());
+    }
+
+    if (verify && calculated_hash != item.file_hash()) {
+        throw std::runtime_error("Hash mismatch for '" + path + "'. Data may be corrupted.");
+    }
+    return contents;
+}
+
+ArchiveExtractionResult ArchiveExtractor::extract(const std::vector<std::string>& files_to_extract, const std::string& output_dir,
+                                                  bool no_overwrite, bool no_verify, bool no_preserve_props) {
+    std::vector<EntryView> selected = match_items(items, files_to_extract);
+    if (!files_to_extract.empty() && selected.empty()) {
+        log("Warning: No matching files found in archive for the given paths", LOG_WARN);
+        return {0, 0, 0, 0, 0, {}};
+    }
+
+    std::atomic<int> files_extracted = 0;
+    std::atomic<int> files_skipped = 0;
+    std::atomic<uint64_t> bytes_extracted = 0;
+    std::atomic<int> hash_mismatches = 0;
+    std::atomic<int> hashes_checked = 0;
+    std::mutex cout_mutex;
+    DirectoryCache directories;
+    // No totals are given, so the reporter never draws.
+    ProgressReporter progress(0, 0, true, true, &cout_mutex);
+
+    std::map<uint64_t, std::vector<EntryView>> solid_blocks;
+    std::vector<EntryView> non_solid;
+    TaskGroup tasks;
+    for (const auto& item : selected) {
+        if (item.is_solid()) {
+            solid_blocks[item.header_start_offset()].push_back(item);
+        } else {
+            non_solid.push_back(item);
+        }
+    }
+    for (auto& files : make_task_batches(std::move(non_solid), [](const EntryView& item) { return item.file_size(); })) {
+        pool.submit(tasks, [&, files = std::move(files)] {
+            extract_non_solid_files(*source, files, output_dir, no_overwrite, no_verify, files_extracted, files_skipped, bytes_extracted, hash_mismatches, hashes_checked, progress, cout_mutex, no_preserve_props, directories);
+        });
+    }
+    for (auto& pair : solid_blocks) {
+        pool.submit(tasks, [&, &block_items = pair.second] {
+            extract_solid_block(*source, block_items, block_items[0].block_size(), output_dir, no_overwrite, no_verify, files_extracted, files_skipped, bytes_extracted, hash_mismatches, hashes_checked, progress, cout_mutex, no_preserve_props, directories);
+        });
+    }
+
+    // Every task is waited for before the first failure is rethrown, since they all refer to this frame.
+    std::exception_ptr failure;
+    try {
+        tasks.wait();
+    } catch (...) {
+        failure = std::current_exception();
+    }
+    progress.stop();
+    if (failure) std::rethrow_exception(failure);
+
+    if (hash_mismatches > 0) {
+        log("Integrity Check: " + std::to_string(hash_mismatches.load()) + " hash mismatches found.", LOG_WARN);
+    }
+    return {files_extracted.load(), files_skipped.load(), bytes_extracted.load(), hashes_checked.load(), hash_mismatches.load(), pool.get_thread_durations()};
+}
+
+ArchiveExtractionResult extract_to_stream(const std::string& archive_file, const std::vector<std::string>& files_to_extract,
+                                          std::ostream& out, bool no_verify) {
+    std::shared_ptr<const ArchiveSource> source = open_archive_source(archive_file);
+    ArchiveCatalog selection;
+    std::vector<EntryView> selected;
+    if (!files_to_extract.empty()) {
+        selected = select_items(source, files_to_extract, selection);
+        if (selected.empty()) {
+            log("Warning: No matching files found in archive for the given paths", LOG_WARN);
+            return {0, 0, 0, 0, 0, {}};
+        }
+    }
+
+    long files_extracted = 0;
+    uint64_t bytes_extracted = 0;
+    int hashes_checked = 0;
+    int hash_mismatches = 0;
+
+    auto emit = [&](const char* data, size_t size) {
+        StageTimer write_timer(Stage::WRITE);
+        out.write(data, size);
+        write_timer.stop(size);
+        if (!out) {
+            throw std::runtime_error("Failed writing to output stream");
+        }
+    };
+    auto check_hash = [&](const EntryView& item, const std::string& calculated_hash) {
+        files_extracted++;
+        bytes_extracted += item.file_size();
+        if (no_verify || item.hash_type() == HashType::NONE) return;
+        hashes_checked++;
+        if (calculated_hash != item.file_hash()) {
+            hash_mismatches++;
+            log("Hash mismatch for '" + std::string(item.path()) + "'. Data may be corrupted.", LOG_WARN);
+        }
+    };
+
+    // Entries go out in archive order; runs of selected items from the same
+    // solid block share one pass over the block.
+    auto write_items = [&](const std::vector<EntryView>& items) {
+        for (size_t i = 0; i < items.size();) {
+            const EntryView& item = items[i];
+            if (!item.is_solid()) {
+                std::vector<char> compressed(item.compressed_size());
+                {
+                    StageTimer read_timer(Stage::READ);
+                    compressed.resize(source->read_at(item.data_start_offset(), compressed.data(), item.compressed_size()));
+                    read_timer.stop(item.compressed_size());
+                }
+
+                StageTimer decompress_timer(Stage::DECOMPRESS);
+                std::vector<FileExtent> extents;
+                std::vector<char> data = item.is_sparse()
+                    ? decode_sparse_payload(compressed, item.compression_type(), item.file_size(), extents)
+                    : compression::decompress_data(compressed, item.compression_type(), item.file_size());
+                decompress_timer.stop(data.size());
+
+                if (item.is_sparse()) {
+                    // Holes are written out as zeros; a pipe has nowhere to keep them.
+                    std::vector<char> zeros(std::min<uint64_t>(item.file_size(), 1024 * 1024), 0);
+                    uint64_t position = 0;
+                    const char* packed = data.data();
+                    auto fill_to = [&](uint64_t offset) {
+                        while (position < offset) {
+                            size_t take = std::min<uint64_t>(offset - position, zeros.size());
+                            emit(zeros.data(), take);
+                            position += take;
+                        }
+                    };
+                    for (const auto& extent : extents) {
+                        fill_to(extent.offset);
+                        emit(packed, extent.length);
+                        packed += extent.length;
+                        position += extent.length;
+                    }
+                    fill_to(item.file_size());
+                } else {
+                    emit(data.data(), data.size());
+                }
+
+                std::string calculated_hash;
+                if (!no_verify && item.hash_type() != HashType::NONE) {
+                    StageTimer hash_timer(Stage::HASH);
+                    calculated_hash = item.is_sparse()
+                        ? hash_sparse_contents(extents, data.data(), item.file_size(), item.hash_type())
+                        : hashing::calculate_hash_from_data(data, item.hash_type());
+                    hash_timer.stop(item.file_size());
+                }
+                check_hash(item, calculated_hash);
+                i++;
+                continue;
+            }
+
+            size_t run_end = i;
+            while (run_end < items.size() && items[run_end].is_solid() &&
+                   items[run_end].header_start_offset() == item.header_start_offset()) {
+                run_end++;
+            }
+            std::vector<EntryView> run;
+            for (size_t j = i; j < run_end; ++j) {
+                if (items[j].file_size() == 0) {
+                    check_hash(items[j], hashing::StreamHasher(items[j].hash_type()).finish());
+                } else {
+                    run.push_back(items[j]);
+                }
+            }
+            std::sort(run.begin(), run.end(), [](const EntryView& a, const EntryView& b) {
+                return a.data_start_offset() < b.data_start_offset();
+            });
+
+            size_t next = 0;
+            std::unique_ptr<hashing::StreamHasher> hasher;
+            auto wanted = [&](uint64_t begin, uint64_t end) {
+                auto it = std::lower_bound(run.begin(), run.end(), begin, [](const EntryView& entry, uint64_t offset) {
+                    return entry.data_start_offset() + entry.file_size() <= offset;
+                });
+                return it != run.end() && it->data_start_offset() < end;
+            };
+            auto consume = [&](uint64_t piece_offset, const char* piece, size_t piece_size) {
+                uint64_t piece_end = piece_offset + piece_size;
+                while (next < run.size()) {
+                    const EntryView& entry = run[next];
+                    uint64_t start = std::max(entry.data_start_offset(), piece_offset);
+                    uint64_t end = std::min(entry.data_start_offset() + entry.file_size(), piece_end);
+                    if (start >= piece_end) break;
+                    if (!hasher) {
+                        if (entry.data_start_offset() < piece_offset) {
+                            throw std::runtime_error("Corrupted solid block: file data out of order for '" + std::string(entry.path()) + "'.");
+                        }
+                        hasher.reset(new hashing::StreamHasher(no_verify ? HashType::NONE : entry.hash_type()));
+                    }
+                    emit(piece + (start - piece_offset), end - start);
+                    {
+                        StageTimer hash_timer(Stage::HASH);
+                        hasher->update(piece + (start - piece_offset), end - start);
+                        hash_timer.stop(end - start);
+                    }
+                    if (end < entry.data_start_offset() + entry.file_size()) break;
+                    check_hash(entry, hasher->finish());
+                    hasher.reset();
+                    next++;
+                }
+            };
+            if (!run.empty()) {
+                decode_solid_block(*source, run[0].to_metadata(), run[0].block_size(), wanted, consume);
+            }
+            if (next < run.size()) {
+                throw std::runtime_error("Corrupted solid block: data ended before all files were written.");
+            }
+            i = run_end;
+        }
+    };
+
+    if (files_to_extract.empty()) {
+        read_in_batches(source, [&](std::shared_ptr<const ArchiveCatalog> batch) {
+            write_items(match_items(*batch, {}));
+        });
+    } else {
+        write_items(selected);
+    }
+    out.flush();
+
+    if (hash_mismatches > 0) {
+        log("Integrity Check: " + std::to_string(hash_mismatches) + " hash mismatches found.", LOG_WARN);
+    }
+    return {files_extracted, 0, bytes_extracted, hashes_checked, hash_mismatches, {}};
+}
+
 } // namespace core
 } // namespace prism
\ No newline at end of file
@@ -0,0 +1,310 @@
+#include <prism/core/archive_index.h>
+#include <prism/core/archive_reader.h>
+#include <prism/core/logging.h>
+#include <prism/core/file_utils.h>
+#include <prism/core/metadata_codec.h>
+#include <prism/compression.h>
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <numeric>
+#include <stdexcept>
+
+namespace fs = std::filesystem;
+
+namespace prism {
+namespace core {
+
+namespace {
+const uint8_t INDEX_SOLID = 0x01;
+const uint8_t INDEX_SPARSE = 0x02;
+const uint8_t INDEX_FRAMED = 0x04;
+const uint64_t INDEX_HEADER_SIZE = 22; // magic + comp + level + count + chunk_count
+const uint64_t INDEX_TRAILER_SIZE = 12;
+
+void encode_record(std::vector<char>& out, std::string_view previous_path, const EntryView& item) {
+    put_front_coded(out, previous_path, item.path());
+    uint8_t flags = (item.is_solid() ? INDEX_SOLID : 0) | (item.is_sparse() ? INDEX_SPARSE : 0) | (item.is_framed() ? INDEX_FRAMED : 0);
+    out.push_back(static_cast<char>(flags));
+    out.push_back(static_cast<char>(item.compression_type()));
+    out.push_back(static_cast<char>(item.level()));
+    out.push_back(static_cast<char>(item.hash_type()));
+    put_hash(out, item.file_hash());
+    put_varint(out, item.file_size());
+    put_varint(out, item.compressed_size());
+    put_varint(out, item.header_start_offset());
+    put_varint(out, item.data_start_offset());
+    put_varint(out, item.block_size());
+    put_varint(out, item.creation_time());
+    put_varint(out, item.modification_time());
+    put_varint(out, item.permissions());
+    put_varint(out, item.uid());
+    put_varint(out, item.gid());
+}
+
+uint8_t get_byte(const std::vector<char>& in, size_t& at) {
+    if (at >= in.size()) throw std::runtime_error("Corrupted archive index record.");
+    return static_cast<uint8_t>(in[at++]);
+}
+
+IndexedItem decode_record(const std::vector<char>& in, size_t& at, const std::string& previous_path) {
+    IndexedItem indexed;
+    FileMetadata& item = indexed.item;
+    item.path = get_front_coded(in, at, previous_path);
+    uint8_t flags = get_byte(in, at);
+    item.is_solid = (flags & INDEX_SOLID) != 0;
+    item.is_sparse = (flags & INDEX_SPARSE) != 0;
+    item.is_framed = (flags & INDEX_FRAMED) != 0;
+    item.compression_type = static_cast<CompressionType>(get_byte(in, at));
+    item.level = get_byte(in, at);
+    item.hash_type = static_cast<HashType>(get_byte(in, at));
+    item.file_hash = get_hash(in, at);
+    item.file_size = get_varint(in, at);
+    item.compressed_size = get_varint(in, at);
+    item.header_start_offset = get_varint(in, at);
+    item.data_start_offset = get_varint(in, at);
+    indexed.block_size = get_varint(in, at);
+    item.creation_time = get_varint(in, at);
+    item.modification_time = get_varint(in, at);
+    item.permissions = (uint32_t)get_varint(in, at);
+    item.uid = (uint32_t)get_varint(in, at);
+    item.gid = (uint32_t)get_varint(in, at);
+    return indexed;
+}
+
+// Offset of the index if archive_file ends with a valid trailer, else 0.
+uint64_t find_index_offset(std::istream& in) {
+    in.seekg(0, std::ios::end);
+    uint64_t file_size = in.tellg();
+    if (file_size < 7 + INDEX_TRAILER_SIZE) return 0;
+
+    char trailer[INDEX_TRAILER_SIZE];
+    in.seekg(file_size - INDEX_TRAILER_SIZE);
+    in.read(trailer, INDEX_TRAILER_SIZE);
+    if (in.gcount() < (std::streamsize)INDEX_TRAILER_SIZE || strncmp(trailer + 8, ARCHIVE_INDEX_MAGIC, 4) != 0) return 0;
+    uint64_t index_offset;
+    memcpy(&index_offset, trailer, 8);
+    if (index_offset < 7 || index_offset + INDEX_HEADER_SIZE > file_size - INDEX_TRAILER_SIZE) return 0;
+
+    char magic[4];
+    in.seekg(index_offset);
+    in.read(magic, 4);
+    if (in.gcount() < 4 || strncmp(magic, ARCHIVE_INDEX_MAGIC, 4) != 0) return 0;
+    return index_offset;
+}
+} // anonymous namespace
+
+bool ArchiveIndex::open(const std::string& archive_file) {
+    if (!file_exists(archive_file)) return false;
+    return open(std::make_shared<FileSource>(archive_file));
+}
+
+bool ArchiveIndex::open(std::shared_ptr<const ArchiveSource> archive) {
+    source = std::move(archive);
+    in.open(*source);
+    // Lookups skip the entries, so the header is checked here instead.
+    read_archive_header(in);
+    index_offset = find_index_offset(in);
+    if (index_offset == 0) {
+        return false;
+    }
+    in.clear();
+    in.seekg(0, std::ios::end);
+    index_end = (uint64_t)in.tellg() - INDEX_TRAILER_SIZE;
+    in.seekg(index_offset + 4);
+    uint8_t comp_byte, level_byte;
+    in.read((char*)&comp_byte, 1);
+    in.read((char*)&level_byte, 1);
+    in.read((char*)&count, 8);
+    in.read((char*)&chunk_count, 8);
+    comp_type = static_cast<CompressionType>(comp_byte);
+    return static_cast<bool>(in) && chunk_count == (count + INDEX_CHUNK_RECORDS - 1) / INDEX_CHUNK_RECORDS;
+}
+
+uint64_t ArchiveIndex::chunk_offset(uint64_t chunk) {
+    uint64_t offset;
+    in.seekg(index_offset + INDEX_HEADER_SIZE + chunk * 8);
+    in.read((char*)&offset, 8);
+    if (!in) throw std::runtime_error("Corrupted archive index.");
+    return index_offset + offset;
+}
+
+std::string ArchiveIndex::first_path(uint64_t chunk) {
+    in.seekg(chunk_offset(chunk));
+    uint32_t path_len;
+    in.read((char*)&path_len, 4);
+    std::string path(path_len, '\0');
+    in.read(&path[0], path_len);
+    if (!in) throw std::runtime_error("Corrupted archive index.");
+    return path;
+}
+
+const std::vector<IndexedItem>& ArchiveIndex::load_chunk(uint64_t chunk) {
+    if (chunk == loaded_chunk) return loaded_items;
+
+    in.seekg(chunk_offset(chunk));
+    uint32_t path_len;
+    in.read((char*)&path_len, 4);
+    in.seekg(path_len, std::ios::cur);
+    uint64_t raw_size, stored_size;
+    in.read((char*)&raw_size, 8);
+    in.read((char*)&stored_size, 8);
+    if (!in || stored_size > index_end - (uint64_t)in.tellg()) throw std::runtime_error("Corrupted archive index.");
+    std::vector<char> stored(stored_size);
+    in.read(stored.data(), stored_size);
+    if (!in) throw std::runtime_error("Corrupted archive index.");
+    std::vector<char> records = compression::decompress_data(stored, comp_type, raw_size);
+
+    uint64_t records_in_chunk = std::min(INDEX_CHUNK_RECORDS, count - chunk * INDEX_CHUNK_RECORDS);
+    loaded_items.clear();
+    loaded_items.reserve(records_in_chunk);
+    size_t at = 0;
+    std::string previous_path;
+    for (uint64_t i = 0; i < records_in_chunk; ++i) {
+        loaded_items.push_back(decode_record(records, at, previous_path));
+        previous_path = loaded_items.back().item.path;
+    }
+    loaded_chunk = chunk;
+    return loaded_items;
+}
+
+const IndexedItem& ArchiveIndex::item_at(uint64_t position) {
+    return load_chunk(position / INDEX_CHUNK_RECORDS)[position % INDEX_CHUNK_RECORDS];
+}
+
+uint64_t ArchiveIndex::lower_bound(const std::string& path) {
+    // Last chunk whose first path sorts before path; the answer lies in it or
+    // starts the next one.
+    uint64_t low = 0;
+    uint64_t high = chunk_count;
+    while (low < high) {
+        uint64_t mid = low + (high - low) / 2;
+        if (first_path(mid) < path) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    if (low == 0) return 0;
+
+    uint64_t chunk = low - 1;
+    const std::vector<IndexedItem>& items = load_chunk(chunk);
+    auto it = std::lower_bound(items.begin(), items.end(), path,
+                               [](const IndexedItem& indexed, const std::string& key) { return indexed.item.path < key; });
+    return chunk * INDEX_CHUNK_RECORDS + (it - items.begin());
+}
+
+bool ArchiveIndex::find(const std::string& path, IndexedItem& found) {
+    uint64_t position = lower_bound(path);
+    if (position == count || item_at(position).item.path != path) return false;
+    found = item_at(position);
+    return true;
+}
+
+std::vector<IndexedItem> ArchiveIndex::find_prefix(const std::string& prefix) {
+    std::vector<IndexedItem> items;
+    for (uint64_t position = lower_bound(prefix); position < count; ++position) {
+        const IndexedItem& indexed = item_at(position);
+        if (indexed.item.path.compare(0, prefix.size(), prefix) != 0) break;
+        items.push_back(indexed);
+    }
+    return items;
+}
+
+void ArchiveIndex::read_all(ArchiveCatalog& catalog) {
+    catalog.reserve(count);
+    for (uint64_t chunk = 0; chunk < chunk_count; ++chunk) {
+        for (const auto& indexed : load_chunk(chunk)) {
+            catalog.add(indexed.item, indexed.block_size);
+        }
+    }
+}
+
+void write_archive_index(const std::string& archive_file) {
+    remove_archive_index(archive_file);
+    update_archive_version(archive_file);
+    ArchiveCatalog catalog = read_archive_catalog(archive_file);
+    FileSink sink(archive_file, true);
+    write_archive_index(sink, catalog);
+    sink.flush();
+}
+
+void write_archive_index(ArchiveSink& sink, const ArchiveCatalog& catalog) {
+    std::vector<size_t> order(catalog.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return catalog[a].path() < catalog[b].path(); });
+
+    // The index is compressed with the codec most of the archive already uses.
+    CompressionType comp_type = catalog.empty() ? CompressionType::NONE : catalog[0].compression_type();
+    uint8_t level = catalog.empty() ? 0 : catalog[0].level();
+
+    uint64_t count = catalog.size();
+    uint64_t chunk_count = (count + INDEX_CHUNK_RECORDS - 1) / INDEX_CHUNK_RECORDS;
+    std::vector<char> chunks;
+    std::vector<uint64_t> offsets;
+    offsets.reserve(chunk_count);
+    uint64_t table_end = INDEX_HEADER_SIZE + chunk_count * 8;
+    for (uint64_t first = 0; first < count; first += INDEX_CHUNK_RECORDS) {
+        std::vector<char> records;
+        std::string_view previous_path;
+        for (uint64_t i = first; i < std::min(count, first + INDEX_CHUNK_RECORDS); ++i) {
+            EntryView item = catalog[order[i]];
+            encode_record(records, previous_path, item);
+            previous_path = item.path();
+        }
+        std::vector<char> stored = compression::compress_data(records, comp_type, level);
+
+        std::string_view first_path = catalog[order[first]].path();
+        uint32_t path_len = first_path.size();
+        uint64_t raw_size = records.size();
+        uint64_t stored_size = stored.size();
+        offsets.push_back(table_end + chunks.size());
+        chunks.insert(chunks.end(), (char*)&path_len, (char*)&path_len + 4);
+        chunks.insert(chunks.end(), first_path.begin(), first_path.end());
+        chunks.insert(chunks.end(), (char*)&raw_size, (char*)&raw_size + 8);
+        chunks.insert(chunks.end(), (char*)&stored_size, (char*)&stored_size + 8);
+        chunks.insert(chunks.end(), stored.begin(), stored.end());
+    }
+
+    uint64_t index_offset = sink.position();
+    uint8_t comp_byte = static_cast<uint8_t>(comp_type);
+    std::vector<char> index;
+    index.reserve(INDEX_HEADER_SIZE + offsets.size() * 8 + chunks.size() + INDEX_TRAILER_SIZE);
+    index.insert(index.end(), ARCHIVE_INDEX_MAGIC, ARCHIVE_INDEX_MAGIC + 4);
+    index.push_back(static_cast<char>(comp_byte));
+    index.push_back(static_cast<char>(level));
+    index.insert(index.end(), (char*)&count, (char*)&count + 8);
+    index.insert(index.end(), (char*)&chunk_count, (char*)&chunk_count + 8);
+    index.insert(index.end(), (char*)offsets.data(), (char*)(offsets.data() + offsets.size()));
+    index.insert(index.end(), chunks.begin(), chunks.end());
+    index.insert(index.end(), (char*)&index_offset, (char*)&index_offset + 8);
+    index.insert(index.end(), ARCHIVE_INDEX_MAGIC, ARCHIVE_INDEX_MAGIC + 4);
+    sink.write(index.data(), index.size());
+    PRISM_LOG(LOG_VERBOSE, "Wrote path index of " + std::to_string(count) + " entries in " + std::to_string(chunks.size()) + " bytes");
+}
+
+bool remove_archive_index(const std::string& archive_file) {
+    uint64_t index_offset;
+    {
+        std::ifstream in(archive_file, std::ios::binary);
+        if (!in) return false;
+        index_offset = find_index_offset(in);
+    }
+    if (index_offset == 0) return false;
+    fs::resize_file(archive_file, index_offset);
+    return true;
+}
+
+void update_archive_version(const std::string& archive_file) {
+    std::fstream f(archive_file, std::ios::binary | std::ios::in | std::ios::out);
+    uint16_t version = ARCHIVE_VERSION;
+    f.seekp(4);
+    f.write((char*)&version, 2);
+    if (!f) {
+        throw std::runtime_error("Cannot update archive header: " + archive_file);
+    }
+}
+
+} // namespace core
+} // namespace prism
@@ -0,0 +1,178 @@
+#include <prism/core/archive_io.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace prism {
+namespace core {
+
+namespace {
+const size_t SOURCE_STREAM_BUFFER = 64 * 1024;
+} // anonymous namespace
+
+#ifdef _WIN32
+FileSource::FileSource(const std::string& path) : path(path), in(path, std::ios::binary) {
+    if (!in) {
+        throw std::runtime_error("Cannot open archive: " + path);
+    }
+    in.seekg(0, std::ios::end);
+    file_size = in.tellg();
+}
+
+FileSource::~FileSource() = default;
+
+size_t FileSource::read_at(uint64_t offset, char* data, size_t size) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    in.clear();
+    in.seekg(offset);
+    in.read(data, size);
+    return in.gcount();
+}
+#else
+FileSource::FileSource(const std::string& path) : path(path) {
+    fd = ::open(path.c_str(), O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        if (fd >= 0) ::close(fd);
+        throw std::runtime_error("Cannot open archive: " + path);
+    }
+    file_size = st.st_size;
+}
+
+FileSource::~FileSource() {
+    ::close(fd);
+}
+
+size_t FileSource::read_at(uint64_t offset, char* data, size_t size) const {
+    size_t done = 0;
+    while (done < size) {
+        ssize_t got = pread(fd, data + done, size - done, offset + done);
+        if (got < 0) {
+            if (errno == EINTR) continue;
+            throw std::runtime_error("Failed reading archive: " + path);
+        }
+        if (got == 0) break;
+        done += got;
+    }
+    return done;
+}
+#endif
+
+size_t MemorySource::read_at(uint64_t offset, char* data, size_t size) const {
+    if (offset >= bytes.size()) return 0;
+    size_t count = std::min<uint64_t>(size, bytes.size() - offset);
+    memcpy(data, bytes.data() + offset, count);
+    return count;
+}
+
+FileSink::FileSink(const std::string& path, bool append)
+    : path(path), out(path, std::ios::binary | (append ? std::ios::app : std::ios::trunc)) {
+    if (!out) {
+        throw std::runtime_error("Cannot open archive file for writing: " + path);
+    }
+    out.seekp(0, std::ios::end);
+    written = out.tellp();
+}
+
+void FileSink::write(const char* data, size_t size) {
+    out.write(data, size);
+    if (!out) {
+        throw std::runtime_error("Failed writing archive file: " + path);
+    }
+    written += size;
+}
+
+void FileSink::flush() {
+    out.flush();
+    if (!out) {
+        throw std::runtime_error("Failed writing archive file: " + path);
+    }
+}
+
+void CallbackSink::write(const char* data, size_t size) {
+    write_fn(data, size);
+    written += size;
+}
+
+SourceStream::SourceStream() : std::istream(&buf) {}
+
+SourceStream::SourceStream(const ArchiveSource& source) : std::istream(&buf) {
+    open(source);
+}
+
+void SourceStream::open(const ArchiveSource& source) {
+    buf.reset(source);
+    clear();
+}
+
+void SourceStream::Buffer::reset(const ArchiveSource& new_source) {
+    source = &new_source;
+    buffer.resize(SOURCE_STREAM_BUFFER);
+    buffer_start = 0;
+    setg(buffer.data(), buffer.data(), buffer.data());
+}
+
+SourceStream::Buffer::int_type SourceStream::Buffer::underflow() {
+    if (gptr() < egptr()) return traits_type::to_int_type(*gptr());
+    if (!source) return traits_type::eof();
+    buffer_start += egptr() - eback();
+    size_t got = source->read_at(buffer_start, buffer.data(), buffer.size());
+    setg(buffer.data(), buffer.data(), buffer.data() + got);
+    return got == 0 ? traits_type::eof() : traits_type::to_int_type(*gptr());
+}
+
+// Large reads skip the buffer and go to the source directly.
+std::streamsize SourceStream::Buffer::xsgetn(char* data, std::streamsize size) {
+    std::streamsize done = std::min<std::streamsize>(size, egptr() - gptr());
+    memcpy(data, gptr(), done);
+    gbump(done);
+    if (done == size || !source) return done;
+
+    if ((size_t)(size - done) >= buffer.size()) {
+        uint64_t position = buffer_start + (gptr() - eback());
+        size_t got = source->read_at(position, data + done, size - done);
+        buffer_start = position + got;
+        setg(buffer.data(), buffer.data(), buffer.data());
+        return done + got;
+    }
+    while (done < size && underflow() != traits_type::eof()) {
+        std::streamsize count = std::min<std::streamsize>(size - done, egptr() - gptr());
+        memcpy(data + done, gptr(), count);
+        gbump(count);
+        done += count;
+    }
+    return done;
+}
+
+SourceStream::Buffer::pos_type SourceStream::Buffer::seekoff(off_type offset, std::ios_base::seekdir dir, std::ios_base::openmode which) {
+    int64_t base = 0;
+    if (dir == std::ios_base::cur) {
+        base = buffer_start + (gptr() - eback());
+    } else if (dir == std::ios_base::end) {
+        base = source ? source->size() : 0;
+    }
+    return seekpos(pos_type(base + offset), which);
+}
+
+SourceStream::Buffer::pos_type SourceStream::Buffer::seekpos(pos_type position, std::ios_base::openmode which) {
+    int64_t target = position;
+    if (target < 0 || !(which & std::ios_base::in)) return pos_type(off_type(-1));
+    uint64_t buffered_end = buffer_start + (egptr() - eback());
+    if ((uint64_t)target >= buffer_start && (uint64_t)target <= buffered_end) {
+        setg(eback(), eback() + (target - buffer_start), egptr());
+    } else {
+        buffer_start = target;
+        setg(buffer.data(), buffer.data(), buffer.data());
+    }
+    return position;
+}
+
+} // namespace core
+} // namespace prism
@@ -3,34 +3,42 @@
 #include <prism/core/file_utils.h>
 #include <prism/core/logging.h>
 #include <iostream>
+#include <cstdint>
 
 namespace prism {
 namespace core {
 
 void list_archive(const std::string& archive_file, bool raw_list_mode) {
-    std::vector<FileMetadata> items = read_archive_metadata(archive_file);
+    // Entries are printed as their headers are parsed; nothing here grows
+    // with the number of entries.
+    ArchiveReader reader(archive_file);
     
     if (!raw_list_mode) {
         log("Listing contents of '" + archive_file + "'..", LOG_SUM);
     }
     
-    if (items.empty()) {
-        if (!raw_list_mode) log("Archive is empty.", LOG_INFO);
-        return;
-    }
-    
+    size_t file_count = 0;
     uint64_t total_uncompressed = 0;
     uint64_t total_compressed = 0;
+    uint64_t counted_block = UINT64_MAX; // entries of a block arrive together
     
-    for (const auto& item : items) {
+    FileMetadata item;
+    while (reader.next(item)) {
+        file_count++;
         std::string comp_name = COMPRESSION_NAMES.at(item.compression_type);
         
         if (raw_list_mode) {
             std::cout << item.path << "\t" << item.file_size << "\t" << comp_name << "\n";
         } else {
-            double ratio = 0;
-            if (item.file_size > 0) {
-                ratio = 100.0 * (1.0 - (double)item.compressed_size / item.file_size);
+            // Files in solid blocks and small-file groups share one compressed
+            // stream, so they have no ratio of their own.
+            std::string saved_info = "solid";
+            if (!item.is_solid) {
+                double ratio = 0;
+                if (item.file_size > 0) {
+                    ratio = 100.0 * (1.0 - (double)item.compressed_size / item.file_size);
+                }
+                saved_info = std::to_string((int)ratio) + "% saved";
             }
             
             std::string hash_info = "";
@@ -40,17 +48,25 @@ void list_archive(const std::string& archive_file, bool raw_list_mode) {
             }
             
             log(item.path + " - " + format_size(item.file_size) + 
-                  " (" + comp_name + ", " + std::to_string((int)ratio) + "% saved" + hash_info + ")", LOG_INFO);
+                  " (" + comp_name + ", " + saved_info + hash_info + ")", LOG_INFO);
         }
         
         total_uncompressed += item.file_size;
-        total_compressed += item.compressed_size;
+        if (!item.is_solid || item.header_start_offset != counted_block) {
+            total_compressed += item.compressed_size;
+            if (item.is_solid) counted_block = item.header_start_offset;
+        }
+    }
+    
+    if (file_count == 0) {
+        if (!raw_list_mode) log("Archive is empty.", LOG_INFO);
+        return;
     }
     
     if (!raw_list_mode) {
         std::cout << std::endl;
         log("Archive Summary:", LOG_SUM);
-        log("  Files: " + std::to_string(items.size()), LOG_SUM);
+        log("  Files: " + std::to_string(file_count), LOG_SUM);
         log("  Total size: " + format_size(total_uncompressed), LOG_SUM);
         log("  Compressed size: " + format_size(total_compressed), LOG_SUM);
         
@@ -1,5 +1,6 @@
 #include <prism/core/archive_propertier.h>
 #include <prism/core/archive_reader.h>
+#include <prism/core/archive_index.h>
 #include <prism/core/file_utils.h>
 #include <prism/core/logging.h>
 #include <prism/core/ui_utils.h>
@@ -13,6 +14,9 @@ namespace core {
 void print_properties(const FileMetadata& item) {
     log("Properties for: " + item.path, LOG_SUM);
     log("  Size: " + format_size(item.file_size), LOG_SUM);
+    if (item.is_sparse) {
+        log("  Sparse: yes", LOG_SUM);
+    }
     log("  Compressed Size: " + format_size(item.compressed_size), LOG_SUM);
     log("  Compression: " + COMPRESSION_NAMES.at(item.compression_type), LOG_SUM);
     log("  Compression Level: " + std::to_string(item.level), LOG_SUM);
@@ -30,6 +34,36 @@ void print_properties(const FileMetadata& item) {
 }
 
 void get_properties(const std::string& archive_file, const std::string& path_in_archive, bool auto_yes) {
+    ArchiveIndex index;
+    if (index.open(archive_file)) {
+        IndexedItem indexed;
+        if (index.find(path_in_archive, indexed)) {
+            print_properties(indexed.item);
+            return;
+        }
+
+        std::string prefix = path_in_archive;
+        if (!prefix.empty() && prefix.back() != '/') prefix += '/';
+        std::vector<IndexedItem> contents = index.find_prefix(prefix);
+        if (contents.empty()) {
+            log("Error: File not found in archive: " + path_in_archive, LOG_ERROR);
+            return;
+        }
+        uint64_t total_size = 0;
+        uint64_t total_compressed = 0;
+        for (const auto& entry : contents) {
+            total_size += entry.item.file_size;
+            if (!entry.item.is_solid) total_compressed += entry.item.compressed_size;
+        }
+        log("Properties for folder: " + path_in_archive, LOG_SUM);
+        log("  Files: " + std::to_string(contents.size()), LOG_SUM);
+        log("  Size: " + format_size(total_size), LOG_SUM);
+        if (total_compressed > 0) {
+            log("  Compressed Size (non-solid entries): " + format_size(total_compressed), LOG_SUM);
+        }
+        return;
+    }
+
     if (is_solid_archive(archive_file)) {
         log("Warning: This is a solid archive. To get properties of a specific file, the entire archive may need to be decompressed.", LOG_WARN);
         if (!confirm_action("Do you want to proceed?", auto_yes)) {
@@ -38,12 +72,12 @@ void get_properties(const std::string& archive_file, const std::string& path_in_
         }
     }
 
-    std::vector<FileMetadata> items = read_archive_metadata(archive_file);
+    ArchiveCatalog items = read_archive_catalog(archive_file);
     bool found = false;
 
-    for (const auto& item : items) {
-        if (item.path == path_in_archive) {
-            print_properties(item);
+    for (size_t i = 0; i < items.size(); ++i) {
+        if (items[i].path() == path_in_archive) {
+            print_properties(items[i].to_metadata());
             found = true;
             break;
         }
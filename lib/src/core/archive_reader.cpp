@@ -1,5 +1,9 @@
 #include <prism/core/archive_reader.h>
 #include <prism/core/logging.h>
+#include <prism/core/solid_stream.h>
+#include <prism/core/metadata_codec.h>
+#include <prism/core/archive_index.h>
+#include <prism/core/file_utils.h>
 #include <fstream>
 #include <cstring>
 #include <iostream>
@@ -7,7 +11,7 @@
 namespace prism {
 namespace core {
 
-FileMetadata read_non_solid_file_metadata(std::ifstream& f, uint64_t& current_offset) {
+FileMetadata read_non_solid_file_metadata(std::istream& f, uint64_t& current_offset) {
     FileMetadata item;
     item.header_start_offset = current_offset;
     
@@ -23,7 +27,8 @@ FileMetadata read_non_solid_file_metadata(std::ifstream& f, uint64_t& current_of
     f.read((char*)comp_level_hash_bytes, 3);
     if (f.gcount() < 3) throw std::runtime_error("Unexpected EOF while reading compression/hash info.");
 
-    item.compression_type = static_cast<CompressionType>(comp_level_hash_bytes[0]);
+    item.is_sparse = (comp_level_hash_bytes[0] & SPARSE_ENTRY_FLAG) != 0;
+    item.compression_type = static_cast<CompressionType>(comp_level_hash_bytes[0] & ~SPARSE_ENTRY_FLAG);
     item.level = comp_level_hash_bytes[1];
     item.hash_type = static_cast<HashType>(comp_level_hash_bytes[2]);
     
@@ -56,44 +61,108 @@ FileMetadata read_non_solid_file_metadata(std::ifstream& f, uint64_t& current_of
     current_offset = f.tellg();
     item.is_solid = false;
     
-    log("Debug: Read metadata for '" + item.path + "':", LOG_DEBUG);
-    log("Debug:   Compression Type: " + COMPRESSION_NAMES.at(item.compression_type), LOG_DEBUG);
-    log("Debug:   File Size: " + std::to_string(item.file_size), LOG_DEBUG);
-    log("Debug:   Compressed Size: " + std::to_string(item.compressed_size), LOG_DEBUG);
+    PRISM_LOG(LOG_DEBUG, "Debug: Read metadata for '" + item.path + "':");
+    PRISM_LOG(LOG_DEBUG, "Debug:   Compression Type: " + COMPRESSION_NAMES.at(item.compression_type));
+    PRISM_LOG(LOG_DEBUG, "Debug:   File Size: " + std::to_string(item.file_size));
+    PRISM_LOG(LOG_DEBUG, "Debug:   Compressed Size: " + std::to_string(item.compressed_size));
     
     return item;
 }
 
-std::vector<FileMetadata> read_solid_block_metadata(std::ifstream& f, uint64_t& uncompressed_offset_counter, CompressionType& block_comp_type, uint8_t& block_level, uint64_t& compressed_block_size) {
+namespace {
+// Decodes the record at pos of a solid block or small-file group into item.
+void parse_solid_entry(const SolidRecords& block, size_t& buffer_pos, uint64_t& uncompressed_offset_counter, FileMetadata& item) {
+    const std::vector<char>& metadata_buffer = block.records;
+
+    uint32_t path_len;
+    memcpy(&path_len, &metadata_buffer[buffer_pos], 4);
+    buffer_pos += 4;
+    item.path.assign(&metadata_buffer[buffer_pos], path_len);
+    buffer_pos += path_len;
+    
+    uint8_t hash_type_val;
+    memcpy(&hash_type_val, &metadata_buffer[buffer_pos], 1);
+    buffer_pos += 1;
+    item.hash_type = static_cast<HashType>(hash_type_val);
+    
+    uint16_t hash_len;
+    memcpy(&hash_len, &metadata_buffer[buffer_pos], 2);
+    buffer_pos += 2;
+    item.file_hash.assign(&metadata_buffer[buffer_pos], hash_len);
+    buffer_pos += hash_len;
+    
+    memcpy(&item.file_size, &metadata_buffer[buffer_pos], 8);
+    buffer_pos += 8;
+
+    memcpy(&item.creation_time, &metadata_buffer[buffer_pos], 8);
+    buffer_pos += 8;
+    memcpy(&item.modification_time, &metadata_buffer[buffer_pos], 8);
+    buffer_pos += 8;
+    memcpy(&item.permissions, &metadata_buffer[buffer_pos], 4);
+    buffer_pos += 4;
+    memcpy(&item.uid, &metadata_buffer[buffer_pos], 4);
+    buffer_pos += 4;
+    memcpy(&item.gid, &metadata_buffer[buffer_pos], 4);
+    buffer_pos += 4;
+    
+    item.compression_type = block.comp_type;
+    item.level = block.level;
+    item.header_start_offset = block.data_start;
+    item.data_start_offset = uncompressed_offset_counter;
+    item.compressed_size = block.compressed_size;
+    item.is_solid = true;
+    item.is_sparse = false;
+    item.is_framed = block.framed;
+    
+    uncompressed_offset_counter += item.file_size;
+}
+
+std::vector<FileMetadata> parse_solid_entries(const SolidRecords& block, uint64_t& uncompressed_offset_counter) {
+    std::vector<FileMetadata> items;
+    size_t buffer_pos = 0;
+    while (buffer_pos < block.records.size()) {
+        FileMetadata item;
+        parse_solid_entry(block, buffer_pos, uncompressed_offset_counter, item);
+        items.push_back(std::move(item));
+    }
+    return items;
+}
+
+SolidRecords read_solid_block_records(std::istream& f, CompressionType block_comp_type, uint8_t block_level) {
     log("Debug: Entering read_solid_block_metadata", LOG_DEBUG);
-    std::vector<FileMetadata> block_items;
+    SolidRecords block;
+    block.comp_type = block_comp_type;
+    block.level = block_level;
 
-    uint64_t metadata_size;
-    f.read((char*)&metadata_size, 8);
+    uint64_t size_field;
+    f.read((char*)&size_field, 8);
     if (f.gcount() < 8) throw std::runtime_error("Unexpected EOF while reading solid block metadata size.");
+    uint64_t metadata_size = size_field & ~COMPACT_METADATA_FLAG;
     
     std::vector<char> metadata_buffer(metadata_size);
     f.read(metadata_buffer.data(), metadata_size);
-    if (f.gcount() < metadata_size) throw std::runtime_error("Unexpected EOF while reading solid block metadata.");
+    if ((uint64_t)f.gcount() < metadata_size) throw std::runtime_error("Unexpected EOF while reading solid block metadata.");
+    block.records = decode_metadata_block(metadata_buffer, size_field, block_comp_type);
     
     uint64_t current_data_start_pos = f.tellg();
-    log("Debug: read_solid_block_metadata - current_data_start_pos: " + std::to_string(current_data_start_pos), LOG_DEBUG);
+    PRISM_LOG(LOG_DEBUG, "Debug: read_solid_block_metadata - current_data_start_pos: " + std::to_string(current_data_start_pos));
 
     // Search for the next SOLID_BLOCK_MAGIC or EOF to determine compressed_block_size
     uint64_t search_pos = current_data_start_pos;
     char magic_buffer[4];
     bool found_next_magic = false;
     uint64_t next_magic_pos = 0;
+    uint64_t compressed_block_size;
 
     f.seekg(0, std::ios::end);
     uint64_t end_of_file = f.tellg();
     f.seekg(current_data_start_pos); // Reset to start of compressed data
-    log("Debug: read_solid_block_metadata - end_of_file: " + std::to_string(end_of_file), LOG_DEBUG);
+    PRISM_LOG(LOG_DEBUG, "Debug: read_solid_block_metadata - end_of_file: " + std::to_string(end_of_file));
 
     while (search_pos < end_of_file) {
         f.seekg(search_pos);
         if (f.fail()) { // Check if seek failed (e.g., past EOF)
-            log("Debug: read_solid_block_metadata - Seek failed at search_pos: " + std::to_string(search_pos), LOG_DEBUG);
+            PRISM_LOG(LOG_DEBUG, "Debug: read_solid_block_metadata - Seek failed at search_pos: " + std::to_string(search_pos));
             break;
         }
 
@@ -101,20 +170,21 @@ std::vector<FileMetadata> read_solid_block_metadata(std::ifstream& f, uint64_t&
         if (end_of_file - search_pos >= 4) {
             f.read(magic_buffer, 4);
             if (f.gcount() == 4) { // Successfully read 4 bytes
-                if (strncmp(magic_buffer, SOLID_BLOCK_MAGIC, 4) == 0) {
+                if (strncmp(magic_buffer, SOLID_BLOCK_MAGIC, 4) == 0 || strncmp(magic_buffer, SOLID_STREAM_MAGIC, 4) == 0 ||
+                    strncmp(magic_buffer, ARCHIVE_INDEX_MAGIC, 4) == 0) {
                     found_next_magic = true;
                     next_magic_pos = search_pos;
-                    log("Debug: read_solid_block_metadata - Found SOLID_BLOCK_MAGIC at: " + std::to_string(next_magic_pos), LOG_DEBUG);
+                    PRISM_LOG(LOG_DEBUG, "Debug: read_solid_block_metadata - Found SOLID_BLOCK_MAGIC at: " + std::to_string(next_magic_pos));
                     break;
                 }
             } else {
                 // Less than 4 bytes read, likely near EOF
-                log("Debug: read_solid_block_metadata - Less than 4 bytes read at search_pos: " + std::to_string(search_pos) + ", gcount: " + std::to_string(f.gcount()), LOG_DEBUG);
+                PRISM_LOG(LOG_DEBUG, "Debug: read_solid_block_metadata - Less than 4 bytes read at search_pos: " + std::to_string(search_pos) + ", gcount: " + std::to_string(f.gcount()));
                 break; 
             }
         } else {
             // Not enough bytes left for a full magic string
-            log("Debug: read_solid_block_metadata - Not enough bytes for magic at search_pos: " + std::to_string(search_pos), LOG_DEBUG);
+            PRISM_LOG(LOG_DEBUG, "Debug: read_solid_block_metadata - Not enough bytes for magic at search_pos: " + std::to_string(search_pos));
             break;
         }
         search_pos++; // Move to the next byte to search
@@ -122,134 +192,289 @@ std::vector<FileMetadata> read_solid_block_metadata(std::ifstream& f, uint64_t&
 
     if (found_next_magic) {
         compressed_block_size = next_magic_pos - current_data_start_pos;
-        log("Debug: read_solid_block_metadata - Calculated compressed_block_size (found magic): " + std::to_string(compressed_block_size), LOG_DEBUG);
+        PRISM_LOG(LOG_DEBUG, "Debug: read_solid_block_metadata - Calculated compressed_block_size (found magic): " + std::to_string(compressed_block_size));
     } else {
         compressed_block_size = end_of_file - current_data_start_pos;
-        log("Debug: read_solid_block_metadata - Calculated compressed_block_size (to EOF): " + std::to_string(compressed_block_size), LOG_DEBUG);
+        PRISM_LOG(LOG_DEBUG, "Debug: read_solid_block_metadata - Calculated compressed_block_size (to EOF): " + std::to_string(compressed_block_size));
     }
     
     f.seekg(current_data_start_pos); // Reset file pointer to the beginning of the compressed block
 
+    f.seekg(current_data_start_pos + compressed_block_size);
+
+    block.data_start = current_data_start_pos;
+    block.compressed_size = compressed_block_size;
+    return block;
+}
+
+SolidRecords read_solid_group_records(std::istream& f) {
+
+    uint8_t comp_type_val, level_val;
+    f.read((char*)&comp_type_val, 1);
+    f.read((char*)&level_val, 1);
+    uint64_t size_field, compressed_size;
+    f.read((char*)&size_field, 8);
+    f.read((char*)&compressed_size, 8);
+    if (!f) throw std::runtime_error("Unexpected EOF while reading small-file group header.");
+    uint64_t metadata_size = size_field & ~COMPACT_METADATA_FLAG;
+
+    std::vector<char> metadata_buffer(metadata_size);
+    f.read(metadata_buffer.data(), metadata_size);
+    if ((uint64_t)f.gcount() < metadata_size) throw std::runtime_error("Unexpected EOF while reading small-file group metadata.");
+    SolidRecords block;
+    block.records = decode_metadata_block(metadata_buffer, size_field, static_cast<CompressionType>(comp_type_val));
+    block.comp_type = static_cast<CompressionType>(comp_type_val);
+    block.level = level_val;
+    block.data_start = f.tellg();
+    block.compressed_size = compressed_size;
+    f.seekg(block.data_start + compressed_size);
+    return block;
+}
+
+SolidRecords read_framed_block_records(std::istream& f) {
+    uint8_t comp_type_val, level_val;
+    f.read((char*)&comp_type_val, 1);
+    f.read((char*)&level_val, 1);
+    if (!f) throw std::runtime_error("Unexpected EOF while reading solid block header.");
+
+    uint64_t data_start = f.tellg();
+    uint64_t framed_size = skip_solid_frames(f);
+
+    uint64_t size_field;
+    f.read((char*)&size_field, 8);
+    if (f.gcount() < 8) throw std::runtime_error("Unexpected EOF while reading solid block metadata size.");
+    uint64_t metadata_size = size_field & ~COMPACT_METADATA_FLAG;
+    std::vector<char> metadata_buffer(metadata_size);
+    f.read(metadata_buffer.data(), metadata_size);
+    if ((uint64_t)f.gcount() < metadata_size) throw std::runtime_error("Unexpected EOF while reading solid block metadata.");
+    SolidRecords block;
+    block.records = decode_metadata_block(metadata_buffer, size_field, static_cast<CompressionType>(comp_type_val));
+    block.comp_type = static_cast<CompressionType>(comp_type_val);
+    block.level = level_val;
+    block.data_start = data_start;
+    block.compressed_size = framed_size;
+    block.framed = true;
+    return block;
+}
+
+} // anonymous namespace
+
+std::vector<FileMetadata> read_solid_block_metadata(std::istream& f, uint64_t& uncompressed_offset_counter, CompressionType& block_comp_type, uint8_t& block_level, uint64_t& compressed_block_size) {
+    SolidRecords block = read_solid_block_records(f, block_comp_type, block_level);
+    compressed_block_size = block.compressed_size;
+    return parse_solid_entries(block, uncompressed_offset_counter);
+}
+
+void add_solid_entries(ArchiveCatalog& catalog, const SolidRecords& block) {
     size_t buffer_pos = 0;
-    while (buffer_pos < metadata_size) {
-        FileMetadata item;
-        
-        uint32_t path_len;
-        memcpy(&path_len, &metadata_buffer[buffer_pos], 4);
-        buffer_pos += 4;
-        item.path.assign(&metadata_buffer[buffer_pos], path_len);
-        buffer_pos += path_len;
-        
-        uint8_t hash_type_val;
-        memcpy(&hash_type_val, &metadata_buffer[buffer_pos], 1);
-        buffer_pos += 1;
-        item.hash_type = static_cast<HashType>(hash_type_val);
-        
-        uint16_t hash_len;
-        memcpy(&hash_len, &metadata_buffer[buffer_pos], 2);
-        buffer_pos += 2;
-        item.file_hash.assign(&metadata_buffer[buffer_pos], hash_len);
-        buffer_pos += hash_len;
-        
-        memcpy(&item.file_size, &metadata_buffer[buffer_pos], 8);
-        buffer_pos += 8;
-
-        memcpy(&item.creation_time, &metadata_buffer[buffer_pos], 8);
-        buffer_pos += 8;
-        memcpy(&item.modification_time, &metadata_buffer[buffer_pos], 8);
-        buffer_pos += 8;
-        memcpy(&item.permissions, &metadata_buffer[buffer_pos], 4);
-        buffer_pos += 4;
-        memcpy(&item.uid, &metadata_buffer[buffer_pos], 4);
-        buffer_pos += 4;
-        memcpy(&item.gid, &metadata_buffer[buffer_pos], 4);
-        buffer_pos += 4;
-        
-        item.compression_type = block_comp_type;
-        item.level = block_level;
-        item.header_start_offset = current_data_start_pos;
-        item.data_start_offset = uncompressed_offset_counter;
-        item.compressed_size = compressed_block_size;
-        item.is_solid = true;
-        
-        uncompressed_offset_counter += item.file_size;
-        block_items.push_back(item);
+    uint64_t uncompressed_offset_counter = 0;
+    FileMetadata item;
+    while (buffer_pos < block.records.size()) {
+        parse_solid_entry(block, buffer_pos, uncompressed_offset_counter, item);
+        catalog.add(item);
     }
-    
-    f.seekg(current_data_start_pos + compressed_block_size);
-    
-    return block_items;
 }
 
-std::vector<FileMetadata> read_archive_metadata(const std::string& archive_file) {
-    std::vector<FileMetadata> items;
-    
-    std::ifstream f(archive_file, std::ios::binary);
-    if (!f) {
+std::vector<FileMetadata> read_solid_group_metadata(std::istream& f) {
+    uint64_t uncompressed_offset_counter = 0;
+    return parse_solid_entries(read_solid_group_records(f), uncompressed_offset_counter);
+}
+
+std::vector<FileMetadata> read_framed_block_metadata(std::istream& f) {
+    uint64_t uncompressed_offset_counter = 0;
+    return parse_solid_entries(read_framed_block_records(f), uncompressed_offset_counter);
+}
+
+std::shared_ptr<const ArchiveSource> open_archive_source(const std::string& archive_file) {
+    if (!file_exists(archive_file)) {
         log("Error: Archive file not found: '" + archive_file + "'", LOG_ERROR);
         throw std::runtime_error("Archive file not found: " + archive_file);
     }
-    
-    log("Reading archive metadata from '" + archive_file + "'...", LOG_VERBOSE);
-    
+    PRISM_LOG(LOG_VERBOSE, "Reading archive metadata from '" + archive_file + "'...");
+    return std::make_shared<FileSource>(archive_file);
+}
+
+ArchiveReader::ArchiveReader(const std::string& archive_file) : ArchiveReader(open_archive_source(archive_file)) {}
+
+uint8_t read_archive_header(std::istream& f) {
     char magic[4];
     uint16_t version;
-    uint8_t flags;
     f.read(magic, 4);
     f.read((char*)&version, 2);
     
-    if (strncmp(magic, "PRZM", 4) != 0 || version != 2) {
+    if (!f || strncmp(magic, "PRZM", 4) != 0) {
         log("Error: Invalid archive format.", LOG_ERROR);
         throw std::runtime_error("Invalid archive format.");
     }
+    if (version < MIN_ARCHIVE_VERSION || version > ARCHIVE_VERSION) {
+        log("Error: Unsupported archive version " + std::to_string(version) + ".", LOG_ERROR);
+        throw std::runtime_error("Unsupported archive version " + std::to_string(version) + ".");
+    }
     
+    uint8_t flags;
     f.read((char*)&flags, 1);
+    if (!f || (flags & ~KNOWN_ARCHIVE_FLAGS) != 0) {
+        log("Error: Archive uses features this version does not support.", LOG_ERROR);
+        throw std::runtime_error("Archive uses unsupported features.");
+    }
+    return flags;
+}
 
-    uint64_t current_file_offset = f.tellg();
-    uint64_t uncompressed_offset_counter = 0;
+ArchiveReader::ArchiveReader(std::shared_ptr<const ArchiveSource> archive) : source(std::move(archive)), f(*source) {
+    flags = read_archive_header(f);
+    current_file_offset = f.tellg();
+}
 
-    if ((flags & SOLID_ARCHIVE_FLAG) != 0) {
-        log("Reading initial solid block...", LOG_VERBOSE);
+bool ArchiveReader::next(FileMetadata& item) {
+    while (!has_entry()) {
+        if (section == Section::DONE) return false;
+        read_more();
+        if (section == Section::DONE) log("Finished reading archive metadata.", LOG_VERBOSE);
+    }
+    if (pending_entry) {
+        item = std::move(entry);
+        pending_entry = false;
+        pending_block_size = 0;
+        return true;
+    }
+    pending_block_size = block_total;
+    parse_solid_entry(block, block_pos, block_offset, item);
+    return true;
+}
+
+bool ArchiveReader::has_entry() const {
+    return pending_entry || block_pos < block.records.size();
+}
+
+void ArchiveReader::take_entry(FileMetadata item) {
+    entry = std::move(item);
+    pending_entry = true;
+}
+
+void ArchiveReader::take_block(SolidRecords records) {
+    block = std::move(records);
+    block_pos = 0;
+    block_offset = 0;
+    // The block size is known before the first of its entries is handed out.
+    block_total = 0;
+    size_t pos = 0;
+    FileMetadata scratch;
+    while (pos < block.records.size()) {
+        parse_solid_entry(block, pos, block_total, scratch);
+    }
+}
+
+// Parses the next block, group or non-solid entry into pending.
+void ArchiveReader::read_more() {
+    if (section == Section::FIRST_BLOCK) {
+        if ((flags & SOLID_STREAM_FLAG) != 0) {
+            log("Reading initial solid block...", LOG_VERBOSE);
+            take_block(read_framed_block_records(f));
+            section = Section::BLOCKS;
+        } else if ((flags & SOLID_ARCHIVE_FLAG) != 0) {
+            log("Reading initial solid block...", LOG_VERBOSE);
+            uint8_t comp_type_val, level_val;
+            f.read((char*)&comp_type_val, 1);
+            f.read((char*)&level_val, 1);
+            CompressionType block_comp_type = static_cast<CompressionType>(comp_type_val);
+            uint8_t block_level = level_val;
+
+            take_block(read_solid_block_records(f, block_comp_type, block_level));
+            section = Section::BLOCKS;
+        } else {
+            log("Reading non-solid archive...", LOG_VERBOSE);
+            section = Section::ENTRIES;
+        }
+        return;
+    }
+
+    if (section == Section::ENTRIES) {
+        if (f.peek() == EOF) {
+            section = Section::DONE;
+            return;
+        }
+        char tag[4];
+        f.read(tag, 4);
+        if (f.gcount() < 4) throw std::runtime_error("Unexpected EOF while reading entry.");
+        if (strncmp(tag, SOLID_GROUP_MAGIC, 4) == 0) {
+            take_block(read_solid_group_records(f));
+            current_file_offset = f.tellg();
+            return;
+        }
+        f.seekg(-4, std::ios::cur);
+        if (strncmp(tag, SOLID_BLOCK_MAGIC, 4) == 0 || strncmp(tag, SOLID_STREAM_MAGIC, 4) == 0 ||
+            strncmp(tag, ARCHIVE_INDEX_MAGIC, 4) == 0) {
+            section = Section::BLOCKS;
+            return;
+        }
+        take_entry(read_non_solid_file_metadata(f, current_file_offset));
+        return;
+    }
+
+    if (f.peek() == EOF) {
+        section = Section::DONE;
+        return;
+    }
+    char block_magic[4];
+    f.read(block_magic, 4);
+    if (f.gcount() < 4 || strncmp(block_magic, ARCHIVE_INDEX_MAGIC, 4) == 0) {
+        // The index only repeats what was read above.
+        section = Section::DONE;
+    } else if (strncmp(block_magic, SOLID_STREAM_MAGIC, 4) == 0) {
+        log("Reading appended solid block...", LOG_VERBOSE);
+        take_block(read_framed_block_records(f));
+    } else if (strncmp(block_magic, SOLID_BLOCK_MAGIC, 4) == 0) {
+        log("Reading appended solid block...", LOG_VERBOSE);
         uint8_t comp_type_val, level_val;
         f.read((char*)&comp_type_val, 1);
         f.read((char*)&level_val, 1);
         CompressionType block_comp_type = static_cast<CompressionType>(comp_type_val);
         uint8_t block_level = level_val;
 
-        uint64_t compressed_block_size;
-        std::vector<FileMetadata> block_items = read_solid_block_metadata(f, uncompressed_offset_counter, block_comp_type, block_level, compressed_block_size);
-        items.insert(items.end(), block_items.begin(), block_items.end());
-        current_file_offset = f.tellg();
+        // Offsets are relative to each block's own decompressed data.
+        take_block(read_solid_block_records(f, block_comp_type, block_level));
     } else {
-        log("Reading non-solid archive...", LOG_VERBOSE);
-        while (f.peek() != EOF) {
-            items.push_back(read_non_solid_file_metadata(f, current_file_offset));
-        }
+        throw std::runtime_error("Corrupted archive: unexpected block type found after initial block.");
     }
+}
 
-    while (f.peek() != EOF) {
-        char block_magic[4];
-        f.read(block_magic, 4);
-        if (f.gcount() < 4) break;
+ArchiveCatalog read_archive_catalog(const std::string& archive_file) {
+    return read_archive_catalog(open_archive_source(archive_file));
+}
 
-        if (strncmp(block_magic, SOLID_BLOCK_MAGIC, 4) == 0) {
-            log("Reading appended solid block...", LOG_VERBOSE);
-            uint8_t comp_type_val, level_val;
-            f.read((char*)&comp_type_val, 1);
-            f.read((char*)&level_val, 1);
-            CompressionType block_comp_type = static_cast<CompressionType>(comp_type_val);
-            uint8_t block_level = level_val;
+ArchiveCatalog read_archive_catalog(std::shared_ptr<const ArchiveSource> source) {
+    ArchiveCatalog catalog;
+    ArchiveReader reader(source);
 
-            uint64_t compressed_block_size;
-            std::vector<FileMetadata> block_items = read_solid_block_metadata(f, uncompressed_offset_counter, block_comp_type, block_level, compressed_block_size);
-            items.insert(items.end(), block_items.begin(), block_items.end());
-            current_file_offset = f.tellg();
-        } else {
-            throw std::runtime_error("Corrupted archive: unexpected block type found after initial block.");
+    // The index holds every item in a few compressed chunks, which is much
+    // cheaper than walking the entries of a large archive.
+    ArchiveIndex index;
+    if (index.open(source)) {
+        try {
+            index.read_all(catalog);
+            catalog.sort_by_position();
+            PRISM_LOG(LOG_VERBOSE, "Read " + std::to_string(catalog.size()) + " items from the archive index.");
+            return catalog;
+        } catch (const std::runtime_error& e) {
+            log("Warning: Ignoring unreadable archive index: " + std::string(e.what()), LOG_WARN);
+            catalog = ArchiveCatalog();
         }
     }
-    
-    log("Finished reading archive metadata.", LOG_VERBOSE);
+
+    FileMetadata item;
+    while (reader.next(item)) {
+        catalog.add(item);
+    }
+    return catalog;
+}
+
+std::vector<FileMetadata> read_archive_metadata(const std::string& archive_file) {
+    ArchiveCatalog catalog = read_archive_catalog(archive_file);
+    std::vector<FileMetadata> items;
+    items.reserve(catalog.size());
+    for (size_t i = 0; i < catalog.size(); ++i) {
+        items.push_back(catalog[i].to_metadata());
+    }
     return items;
 }
 
@@ -269,7 +494,7 @@ bool is_solid_archive(const std::string& archive_file) {
     f.read((char*)&version, 2);
     if (f.gcount() < 2) return false;
     
-    if (strncmp(magic, "PRZM", 4) != 0 || version != 2) {
+    if (strncmp(magic, "PRZM", 4) != 0 || version < MIN_ARCHIVE_VERSION || version > ARCHIVE_VERSION) {
         return false;
     }
     
@@ -1,12 +1,20 @@
 #include <prism/core/archive_remover.h>
 #include <prism/core/archive_reader.h>
+#include <prism/core/archive_index.h>
 #include <prism/core/archive_writer.h>
 #include <prism/core/file_utils.h>
 #include <prism/core/logging.h>
+#include <prism/core/metadata_codec.h>
 #include <prism/core/ui_utils.h>
+#include <prism/compression.h>
+#include <prism/core/solid_stream.h>
+#include <prism/core/thread_pool.h>
+#include <prism/core/memory_budget.h>
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 #include <set>
+#include <map>
 #include <filesystem>
 #include <stdexcept>
 
@@ -15,20 +23,87 @@ namespace fs = std::filesystem;
 namespace prism {
 namespace core {
 
-void remove_from_archive(const std::string& archive_file, const std::vector<std::string>& files_to_remove, bool ignore_errors, bool raw_output, bool use_basic_chars) {
+namespace {
+// Writes comp_type, level, framed data holding the files of block_items (all
+// from one source block, in block order) and their records. The source block
+// is decoded piece by piece and only the kept ranges are re-framed, so a few
+// frames are held at a time however large the block is.
+void write_framed_block(std::ostream& out, const std::string& archive_file, const std::vector<EntryView>& block_items,
+                        CompressionType comp_type, uint8_t level, int num_threads) {
+    out.write((char*)&comp_type, 1);
+    out.write((char*)&level, 1);
+
+    uint64_t kept_bytes = 0;
+    for (const auto& item : block_items) kept_bytes += item.file_size();
+
+    uint64_t decode_memory = block_items.empty() ? 0 : solid_block_memory(block_items[0], block_items[0].block_size());
+    size_t frames = solid_frames_in_flight(num_threads, decode_memory);
+    MemoryReservation reservation(decode_memory + frames * 2 * (uint64_t)SOLID_FRAME_SIZE);
+    ThreadPool pool(std::max(1, num_threads));
+    SolidFrameWriter writer(out, comp_type, level, pool, frames);
+
+    if (kept_bytes > 0) {
+        // wanted may run on the decoder thread, so it only searches the kept files.
+        auto wanted = [&](uint64_t piece_begin, uint64_t piece_end) {
+            auto it = std::upper_bound(block_items.begin(), block_items.end(), piece_begin, [](uint64_t offset, const EntryView& item) {
+                return offset < item.data_start_offset() + item.file_size();
+            });
+            return it != block_items.end() && it->data_start_offset() < piece_end;
+        };
+        size_t next = 0;
+        uint64_t written = 0;
+        auto consume = [&](uint64_t offset, const char* data, size_t size) {
+            uint64_t piece_end = offset + size;
+            while (next < block_items.size()) {
+                uint64_t begin = block_items[next].data_start_offset();
+                uint64_t end = begin + block_items[next].file_size();
+                if (begin >= piece_end) break;
+                uint64_t from = std::max(begin, offset);
+                uint64_t to = std::min(end, piece_end);
+                if (from < to) {
+                    writer.write(data + (from - offset), to - from);
+                    written += to - from;
+                }
+                if (end > piece_end) break;
+                next++;
+            }
+        };
+        decode_solid_block(archive_file, block_items[0].to_metadata(), block_items[0].block_size(), wanted, consume);
+        if (written != kept_bytes) {
+            throw std::runtime_error("Corrupted solid block while rebuilding archive: " + std::string(block_items[0].path()));
+        }
+    }
+    writer.finish();
+
+    std::vector<char> metadata_block;
+    for (const auto& item : block_items) {
+        std::vector<char> record = create_solid_file_metadata(std::string(item.path()), item.hash_type(), item.file_hash(), item.file_size(),
+                                                              item.creation_time(), item.modification_time(),
+                                                              item.permissions(), item.uid(), item.gid());
+        metadata_block.insert(metadata_block.end(), record.begin(), record.end());
+    }
+    uint64_t metadata_size;
+    std::vector<char> stored_metadata = encode_metadata_block(metadata_block, comp_type, level, metadata_size);
+    out.write((char*)&metadata_size, 8);
+    out.write(stored_metadata.data(), stored_metadata.size());
+}
+} // anonymous namespace
+
+void remove_from_archive(const std::string& archive_file, const std::vector<std::string>& files_to_remove, bool ignore_errors, bool raw_output, bool use_basic_chars, int num_threads) {
     if (!file_exists(archive_file)) {
         throw std::runtime_error("Archive file not found: " + archive_file);
     }
 
-    std::vector<FileMetadata> all_items = read_archive_metadata(archive_file);
-    std::vector<FileMetadata> items_to_keep;
-    std::set<std::string> remove_set(files_to_remove.begin(), files_to_remove.end());
+    ArchiveCatalog all_items = read_archive_catalog(archive_file);
+    std::vector<EntryView> items_to_keep;
+    std::set<std::string_view> remove_set(files_to_remove.begin(), files_to_remove.end());
 
-    for (const auto& item : all_items) {
-        if (remove_set.find(item.path) == remove_set.end()) {
+    for (size_t i = 0; i < all_items.size(); ++i) {
+        EntryView item = all_items[i];
+        if (remove_set.find(item.path()) == remove_set.end()) {
             items_to_keep.push_back(item);
         } else {
-            log("Marked for removal: '" + item.path + "'", LOG_INFO);
+            log("Marked for removal: '" + std::string(item.path()) + "'", LOG_INFO);
         }
     }
 
@@ -46,9 +121,14 @@ void remove_from_archive(const std::string& archive_file, const std::vector<std:
         throw std::runtime_error("Could not create temporary archive file.");
     }
 
+    // A solid archive stays solid: its blocks are written out framed, the
+    // first one straight after the header.
+    bool solid_archive = is_solid_archive(archive_file);
     temp_out.write("PRZM", 4);
-    uint16_t version = 2;
+    uint16_t version = ARCHIVE_VERSION;
     temp_out.write((char*)&version, 2);
+    uint8_t flags = solid_archive ? SOLID_ARCHIVE_FLAG | SOLID_STREAM_FLAG : 0;
+    temp_out.write((char*)&flags, 1);
 
     log("Rebuilding archive...", LOG_INFO);
 
@@ -57,29 +137,106 @@ void remove_from_archive(const std::string& archive_file, const std::vector<std:
         throw std::runtime_error("Could not open original archive for reading.");
     }
 
-    for (size_t i = 0; i < items_to_keep.size(); ++i) {
-        const auto& item = items_to_keep[i];
+    uint64_t total_bytes_to_copy = 0;
+    for (const auto& item : items_to_keep) {
+        total_bytes_to_copy += item.compressed_size();
+    }
+    ProgressReporter progress(items_to_keep.size(), total_bytes_to_copy, raw_output, use_basic_chars);
+
+    // Files from solid blocks and small-file groups are repacked per source
+    // block, holding only the files that remain.
+    std::map<uint64_t, std::vector<EntryView>> kept_blocks;
+
+    for (const auto& item : items_to_keep) {
+        if (item.is_solid()) {
+            kept_blocks[item.header_start_offset()].push_back(item);
+            continue;
+        }
         
-        std::vector<char> header = create_archive_header(item.path, item.compression_type, item.level,
-                                                       item.hash_type, item.file_hash, item.file_size,
-                                                       item.compressed_size, item.creation_time,
-                                                       item.modification_time, item.permissions,
-                                                       item.uid, item.gid);
+        std::string path(item.path());
+        std::vector<char> header = create_archive_header(path, item.compression_type(), item.level(),
+                                                       item.hash_type(), item.file_hash(), item.file_size(),
+                                                       item.compressed_size(), item.creation_time(),
+                                                       item.modification_time(), item.permissions(),
+                                                       item.uid(), item.gid(), item.is_sparse());
         temp_out.write(header.data(), header.size());
 
-        original_in.seekg(item.data_start_offset);
-        std::vector<char> buffer(item.compressed_size);
-        original_in.read(buffer.data(), item.compressed_size);
+        original_in.seekg(item.data_start_offset());
+        std::vector<char> buffer(item.compressed_size());
+        original_in.read(buffer.data(), item.compressed_size());
         temp_out.write(buffer.data(), buffer.size());
         
-        show_progress_bar(i + 1, items_to_keep.size(), item.path, item.file_size, 0, std::chrono::steady_clock::now(), raw_output, use_basic_chars);
+        progress.file_done(path, item.compressed_size(), item.compressed_size());
+    }
+
+    // In a non-solid archive, blocks no larger than a frame (small-file
+    // groups among them) become groups, which may sit between entries; larger
+    // ones are framed and go last, where readers expect solid blocks.
+    std::vector<const std::vector<EntryView>*> framed_blocks;
+    for (const auto& pair : kept_blocks) {
+        const std::vector<EntryView>& block_items = pair.second;
+        if (solid_archive || block_items[0].is_framed() || block_items[0].block_size() > SOLID_FRAME_SIZE) {
+            framed_blocks.push_back(&block_items);
+            continue;
+        }
+        FileMetadata first_item = block_items[0].to_metadata();
+
+        std::vector<char> block_data = read_solid_block(archive_file, first_item, block_items[0].block_size());
+
+        std::vector<char> group_data;
+        std::vector<char> metadata_block;
+        for (const auto& item : block_items) {
+            std::string path(item.path());
+            if (item.data_start_offset() + item.file_size() > block_data.size()) {
+                throw std::runtime_error("Corrupted solid block while rebuilding archive: " + path);
+            }
+            group_data.insert(group_data.end(), block_data.begin() + item.data_start_offset(),
+                              block_data.begin() + item.data_start_offset() + item.file_size());
+            std::vector<char> record = create_solid_file_metadata(path, item.hash_type(), item.file_hash(), item.file_size(),
+                                                                  item.creation_time(), item.modification_time(),
+                                                                  item.permissions(), item.uid(), item.gid());
+            metadata_block.insert(metadata_block.end(), record.begin(), record.end());
+        }
+
+        std::vector<char> compressed = compression::compress_data(group_data, first_item.compression_type, first_item.level);
+        uint64_t metadata_size;
+        std::vector<char> stored_metadata = encode_metadata_block(metadata_block, first_item.compression_type, first_item.level, metadata_size);
+        uint64_t compressed_size = compressed.size();
+        temp_out.write(SOLID_GROUP_MAGIC, 4);
+        temp_out.write((char*)&first_item.compression_type, 1);
+        temp_out.write((char*)&first_item.level, 1);
+        temp_out.write((char*)&metadata_size, 8);
+        temp_out.write((char*)&compressed_size, 8);
+        temp_out.write(stored_metadata.data(), stored_metadata.size());
+        temp_out.write(compressed.data(), compressed.size());
+
+        for (const auto& item : block_items) {
+            progress.file_done(std::string(item.path()), item.compressed_size(), item.compressed_size());
+        }
+    }
+
+    if (solid_archive && framed_blocks.empty()) {
+        // Every file was removed; the archive still needs its first block.
+        write_framed_block(temp_out, archive_file, {}, all_items[0].compression_type(), all_items[0].level(), num_threads);
+    }
+    for (size_t i = 0; i < framed_blocks.size(); ++i) {
+        const std::vector<EntryView>& block_items = *framed_blocks[i];
+        if (!solid_archive || i > 0) {
+            temp_out.write(SOLID_STREAM_MAGIC, 4);
+        }
+        write_framed_block(temp_out, archive_file, block_items, block_items[0].compression_type(), block_items[0].level(), num_threads);
+        for (const auto& item : block_items) {
+            progress.file_done(std::string(item.path()), item.compressed_size(), item.compressed_size());
+        }
     }
+    progress.stop();
     if (!items_to_keep.empty() && !raw_output) {
         std::cout << std::endl;
     }
 
     original_in.close();
     temp_out.close();
+    write_archive_index(temp_archive_file);
 
     std::error_code ec;
     fs::rename(temp_archive_file, archive_file, ec);
@@ -5,7 +5,13 @@
 #include <prism/compression.h>
 #include <prism/hashing.h>
 #include <prism/core/ui_utils.h>
+#include <prism/core/metrics.h>
+#include <prism/core/sparse.h>
+#include <prism/core/solid_stream.h>
+#include <prism/core/memory_budget.h>
+#include <algorithm>
 #include <fstream>
+#include <memory>
 #include <iostream>
 #include <vector>
 #include <string>
@@ -17,187 +23,246 @@ namespace fs = std::filesystem;
 namespace prism {
 namespace core {
 
-void verify_non_solid_file(const std::string& archive_file, const FileMetadata& item, const std::string& temp_dir, std::atomic<int>& mismatches, std::atomic<int>& checked_files, std::atomic<int>& progress_counter, size_t total_items_to_process, bool raw_output, bool use_basic_chars, bool no_verify, std::chrono::steady_clock::time_point start_time) {
-    if (item.hash_type == HashType::NONE) {
-        log("Debug: Skipping hash verification for '" + item.path + "' (HashType::NONE)", LOG_DEBUG);
-        return;
-    }
-    log("Debug: Proceeding with hash verification for '" + item.path + "'", LOG_DEBUG);
-
-    log("Debug: Verifying '" + item.path + "':", LOG_DEBUG);
-    log("Debug:   Hash Type: " + HASH_NAMES.at(item.hash_type), LOG_DEBUG);
-    log("Debug:   Compression Type: " + COMPRESSION_NAMES.at(item.compression_type), LOG_DEBUG);
-    log("Debug:   File Size: " + std::to_string(item.file_size), LOG_DEBUG);
-    log("Debug:   Compressed Size: " + std::to_string(item.compressed_size), LOG_DEBUG);
-
-    std::string out_path = temp_dir + "/" + item.path + "_" + std::to_string(progress_counter.load());
-    
-    std::vector<char> compressed_data(item.compressed_size);
-    std::ifstream in(archive_file, std::ios::binary);
-    if (!in) {
-        throw std::runtime_error("Cannot open archive for reading: " + archive_file);
-    }
-    in.seekg(item.data_start_offset);
-    log("Debug:   Reading compressed data from offset: " + std::to_string(item.data_start_offset) + " size: " + std::to_string(item.compressed_size), LOG_DEBUG);
-    in.read(compressed_data.data(), item.compressed_size);
-    log("Debug:   Bytes read: " + std::to_string(in.gcount()), LOG_DEBUG);
-    in.close();
-
-    std::vector<char> decompressed_data = compression::decompress_data(compressed_data, item.compression_type, item.file_size);
-    
-    std::ofstream out_file(out_path, std::ios::binary);
-    if (!out_file) {
-        log("Could not write temporary file for verification: " + out_path, LOG_WARN);
-        return;
-    }
-    out_file.write(decompressed_data.data(), decompressed_data.size());
-    out_file.close();
-
-    if (!no_verify && item.hash_type != HashType::NONE) {
-        log("Debug: Incrementing checked_files for '" + item.path + "'", LOG_DEBUG);
-        checked_files++;
-        std::string calculated_hash = prism::hashing::calculate_hash(out_path, item.hash_type);
-        if (calculated_hash != item.file_hash) {
-            mismatches++;
-            log("Hash mismatch for: '" + item.path + "'. Data may be corrupted.", LOG_WARN);
-            log("  - Expected: " + item.file_hash, LOG_WARN);
-            log("  - Got:      " + calculated_hash, LOG_WARN);
-        } else {
-            log("Hash verified for '" + item.path + "'", LOG_VERBOSE);
-        }
+namespace {
+// Largest gap between two payloads of a batch that is still read through.
+const uint64_t BATCH_READ_GAP = 4096;
+
+void check_hash(const EntryView& item, const std::string& calculated_hash, std::atomic<int>& mismatches, std::atomic<int>& checked_files) {
+    checked_files++;
+    if (calculated_hash != item.file_hash()) {
+        mismatches++;
+        log("Hash mismatch for: '" + std::string(item.path()) + "'. Data may be corrupted.", LOG_WARN);
+        log("  - Expected: " + item.file_hash(), LOG_WARN);
+        log("  - Got:      " + calculated_hash, LOG_WARN);
+    } else {
+        PRISM_LOG(LOG_VERBOSE, "Hash verified for '" + std::string(item.path()) + "'");
     }
-    
-    show_progress_bar(progress_counter.fetch_add(1) + 1, total_items_to_process, item.path, item.file_size, item.compressed_size, start_time, raw_output, use_basic_chars);
 }
 
-void verify_solid_block(const std::string& archive_file, const std::vector<FileMetadata>& block_items, const std::string& temp_dir, std::atomic<int>& mismatches, std::atomic<int>& checked_files, std::atomic<int>& progress_counter, size_t total_items_to_process, bool raw_output, bool use_basic_chars, bool no_verify, std::chrono::steady_clock::time_point start_time) {
-    if (block_items.empty()) return;
-
-    const FileMetadata& first_item = block_items[0];
+void check_hash(const EntryView& item, const char* data, size_t size, std::atomic<int>& mismatches, std::atomic<int>& checked_files) {
+    StageTimer hash_timer(Stage::HASH);
+    prism::hashing::StreamHasher hasher(item.hash_type());
+    hasher.update(data, size);
+    std::string calculated_hash = hasher.finish();
+    hash_timer.stop(size);
+    check_hash(item, calculated_hash, mismatches, checked_files);
+}
+} // anonymous namespace
 
-    std::vector<char> compressed_block(first_item.compressed_size);
-    {
-        std::ifstream in(archive_file, std::ios::binary);
-        if (!in) {
-            throw std::runtime_error("Cannot open archive: " + archive_file);
+void verify_non_solid_files(const ArchiveSource& source, const std::vector<EntryView>& batch, std::atomic<int>& mismatches, std::atomic<int>& checked_files, ProgressReporter& progress, bool no_verify) {
+    std::vector<EntryView> items;
+    for (const auto& item : batch) {
+        if (item.hash_type() == HashType::NONE) {
+            PRISM_LOG(LOG_DEBUG, "Debug: Skipping hash verification for '" + std::string(item.path()) + "' (HashType::NONE)");
+            continue;
         }
-        in.seekg(first_item.header_start_offset);
-        in.read(compressed_block.data(), first_item.compressed_size);
+        items.push_back(item);
     }
-
-    uint64_t total_uncompressed_size_in_block = 0;
-    for (const auto& item : block_items) {
-        total_uncompressed_size_in_block += item.file_size;
+    if (items.empty()) return;
+    std::sort(items.begin(), items.end(), [](const EntryView& a, const EntryView& b) {
+        return a.data_start_offset() < b.data_start_offset();
+    });
+
+    // Payloads separated by little more than their headers are read together.
+    uint64_t span_begin = items.front().data_start_offset();
+    uint64_t span_end = span_begin;
+    uint64_t compressed_total = 0;
+    uint64_t largest_file = 0;
+    for (const auto& item : items) {
+        span_end = std::max(span_end, item.data_start_offset() + item.compressed_size());
+        compressed_total += item.compressed_size();
+        largest_file = std::max(largest_file, item.file_size());
+    }
+    bool one_read = items.size() > 1 && span_end - span_begin <= compressed_total + items.size() * BATCH_READ_GAP;
+    // Entries are decoded one at a time.
+    MemoryReservation reservation((one_read ? span_end - span_begin : compressed_total) + largest_file);
+    std::vector<char> span;
+    if (one_read) {
+        StageTimer read_timer(Stage::READ);
+        span.resize(span_end - span_begin);
+        span.resize(source.read_at(span_begin, span.data(), span.size()));
+        read_timer.stop(span.size());
     }
 
-    std::vector<char> decompressed_block = compression::decompress_data(compressed_block,
-                                                                      first_item.compression_type,
-                                                                      total_uncompressed_size_in_block);
+    for (const auto& item : items) {
+        PRISM_LOG(LOG_DEBUG, "Debug: Verifying '" + std::string(item.path()) + "':");
+        PRISM_LOG(LOG_DEBUG, "Debug:   Hash Type: " + HASH_NAMES.at(item.hash_type()));
+        PRISM_LOG(LOG_DEBUG, "Debug:   Compression Type: " + COMPRESSION_NAMES.at(item.compression_type()));
+        PRISM_LOG(LOG_DEBUG, "Debug:   File Size: " + std::to_string(item.file_size()));
+        PRISM_LOG(LOG_DEBUG, "Debug:   Compressed Size: " + std::to_string(item.compressed_size()));
+
+        std::vector<char> compressed_data;
+        if (one_read) {
+            uint64_t from = std::min<uint64_t>(item.data_start_offset() - span_begin, span.size());
+            uint64_t to = std::min<uint64_t>(from + item.compressed_size(), span.size());
+            compressed_data.assign(span.begin() + from, span.begin() + to);
+        } else {
+            StageTimer read_timer(Stage::READ);
+            compressed_data.resize(item.compressed_size());
+            compressed_data.resize(source.read_at(item.data_start_offset(), compressed_data.data(), item.compressed_size()));
+            read_timer.stop(compressed_data.size());
+        }
+        PRISM_LOG(LOG_DEBUG, "Debug:   Bytes read: " + std::to_string(compressed_data.size()));
+
+        StageTimer decompress_timer(Stage::DECOMPRESS);
+        std::vector<FileExtent> extents;
+        std::vector<char> data = item.is_sparse()
+            ? decode_sparse_payload(compressed_data, item.compression_type(), item.file_size(), extents)
+            : compression::decompress_data(compressed_data, item.compression_type(), item.file_size());
+        decompress_timer.stop(data.size());
+
+        if (!no_verify && item.is_sparse()) {
+            // The holes hash as zeros, as they read back from the extracted file.
+            StageTimer hash_timer(Stage::HASH);
+            std::string calculated_hash = hash_sparse_contents(extents, data.data(), item.file_size(), item.hash_type());
+            hash_timer.stop(item.file_size());
+            check_hash(item, calculated_hash, mismatches, checked_files);
+        } else if (!no_verify) {
+            check_hash(item, data.data(), data.size(), mismatches, checked_files);
+        }
+        progress.file_done(std::string(item.path()), item.file_size(), item.compressed_size());
+    }
+}
 
+void verify_solid_block(const ArchiveSource& source, const std::vector<EntryView>& block_items, std::atomic<int>& mismatches, std::atomic<int>& checked_files, ProgressReporter& progress, bool no_verify) {
+    std::vector<EntryView> targets;
     for (const auto& item : block_items) {
-        if (item.hash_type == HashType::NONE) {
-            continue;
+        if (item.hash_type() != HashType::NONE) targets.push_back(item);
+    }
+    if (targets.empty()) return;
+
+    // Each file is hashed as its bytes come out of the decoder; frames that
+    // hold none of the files are skipped. wanted may run on the decoder
+    // thread, so it only searches the targets.
+    auto wanted = [&](uint64_t piece_begin, uint64_t piece_end) {
+        auto it = std::upper_bound(targets.begin(), targets.end(), piece_begin, [](uint64_t offset, const EntryView& item) {
+            return offset < item.data_start_offset() + item.file_size();
+        });
+        return it != targets.end() && it->data_start_offset() < piece_end;
+    };
+
+    size_t next = 0;
+    uint64_t hashed = 0;
+    std::unique_ptr<prism::hashing::StreamHasher> hasher;
+    auto finish_file = [&](const EntryView& item) {
+        if (hashed != item.file_size()) {
+            throw std::runtime_error("Corrupted solid block: data ended before '" + std::string(item.path()) + "'.");
         }
-
-        std::string out_path = temp_dir + "/" + item.path + "_" + std::to_string(progress_counter.load());
-
-        std::vector<char> file_data(decompressed_block.begin() + item.data_start_offset,
-                                    decompressed_block.begin() + item.data_start_offset + item.file_size);
-
-        std::ofstream out_file(out_path, std::ios::binary);
-        if (!out_file) {
-            log("Could not write temporary file for verification: " + out_path, LOG_WARN);
-            continue;
+        if (!no_verify) {
+            std::string calculated_hash = hasher ? hasher->finish() : prism::hashing::StreamHasher(item.hash_type()).finish();
+            check_hash(item, calculated_hash, mismatches, checked_files);
         }
-        out_file.write(file_data.data(), file_data.size());
-        out_file.close();
+        progress.file_done(std::string(item.path()), item.file_size(), item.compressed_size());
+        hasher.reset();
+        hashed = 0;
+        next++;
+    };
+    auto consume = [&](uint64_t offset, const char* data, size_t size) {
+        uint64_t piece_end = offset + size;
+        while (next < targets.size()) {
+            const EntryView& item = targets[next];
+            uint64_t begin = item.data_start_offset();
+            uint64_t end = begin + item.file_size();
+            if (begin >= piece_end) break;
+            uint64_t from = std::max(begin, offset);
+            uint64_t to = std::min(end, piece_end);
+            if (from < to) {
+                if (!no_verify) {
+                    if (!hasher) hasher.reset(new prism::hashing::StreamHasher(item.hash_type()));
+                    StageTimer hash_timer(Stage::HASH);
+                    hasher->update(data + (from - offset), to - from);
+                    hash_timer.stop(to - from);
+                }
+                hashed += to - from;
+            }
+            if (end > piece_end) break;
+            finish_file(item);
+        }
+    };
 
-        std::string calculated_hash = prism::hashing::calculate_hash(out_path, item.hash_type);
-        checked_files++;
+    MemoryReservation reservation(solid_block_memory(block_items[0], block_items[0].block_size()));
+    decode_solid_block(source, block_items[0].to_metadata(), block_items[0].block_size(), wanted, consume);
 
-        if (calculated_hash != item.file_hash) {
-            mismatches++;
-            log("Hash mismatch for: '" + item.path + "'", LOG_WARN);
-            log("  - Expected: " + item.file_hash, LOG_WARN);
-            log("  - Got:      " + calculated_hash, LOG_WARN);
-        }
-        
-        show_progress_bar(progress_counter.fetch_add(1) + 1, total_items_to_process, item.path, item.file_size, item.compressed_size, start_time, raw_output, use_basic_chars);
+    // Empty files at the very end of the block get no piece of their own.
+    while (next < targets.size()) {
+        finish_file(targets[next]);
     }
 }
 
 void verify_archive(const std::string& archive_file, bool raw_output, bool use_basic_chars, bool no_verify) {
-    auto start_time = std::chrono::steady_clock::now();
     log("Verifying archive: '" + archive_file + "'", LOG_INFO);
 
-    std::vector<FileMetadata> items = read_archive_metadata(archive_file);
+    std::shared_ptr<const ArchiveSource> source = open_archive_source(archive_file);
+    ArchiveCatalog items = read_archive_catalog(source);
     if (items.empty()) {
         log("Archive is empty or metadata is corrupted.", LOG_WARN);
         return;
     }
 
-    std::string temp_dir = "prism_verify_temp";
-    if (fs::exists(temp_dir)) {
-        fs::remove_all(temp_dir);
-    }
-    fs::create_directory(temp_dir);
-
     std::atomic<int> mismatches = 0;
     std::atomic<int> checked_files = 0;
-    std::atomic<int> progress_counter = 0;
 
-    std::map<uint64_t, std::vector<FileMetadata>> solid_blocks;
-    std::vector<FileMetadata> non_solid_files;
+    std::map<uint64_t, std::vector<EntryView>> solid_blocks;
+    std::vector<EntryView> non_solid_files;
 
-    for (const auto& item : items) {
-        if (item.hash_type == HashType::NONE) {
+    for (size_t i = 0; i < items.size(); ++i) {
+        EntryView item = items[i];
+        if (item.hash_type() == HashType::NONE) {
             continue;
         }
 
-        if (!item.is_solid) {
+        if (!item.is_solid()) {
             non_solid_files.push_back(item);
         } else {
-            solid_blocks[item.header_start_offset].push_back(item);
+            solid_blocks[item.header_start_offset()].push_back(item);
         }
     }
 
     size_t total_items_to_process = non_solid_files.size();
+    uint64_t total_bytes_to_process = 0;
+    for (const auto& item : non_solid_files) {
+        total_bytes_to_process += item.file_size();
+    }
     for (const auto& pair : solid_blocks) {
         total_items_to_process += pair.second.size();
+        for (const auto& item : pair.second) {
+            total_bytes_to_process += item.file_size();
+        }
     }
 
     if (total_items_to_process == 0) {
         log("Verification complete. No files had hashes to check.", LOG_SUM);
-        fs::remove_all(temp_dir);
         return;
     }
 
-    {
-        ThreadPool pool(1);
-        std::vector<std::future<void>> results;
+    ProgressReporter progress(total_items_to_process, total_bytes_to_process, raw_output, use_basic_chars);
 
-        for (const auto& item : non_solid_files) {
-            results.emplace_back(pool.enqueue([&, item, no_verify] {
-                verify_non_solid_file(archive_file, item, temp_dir, mismatches, checked_files, progress_counter, total_items_to_process, raw_output, use_basic_chars, no_verify, start_time);
-            }));
+    {
+        TaskGroup tasks;
+        ThreadPool pool(1, QUEUED_TASKS_PER_THREAD);
+
+        for (auto& batch : make_task_batches(std::move(non_solid_files), [](const EntryView& item) { return item.file_size(); })) {
+            if (tasks.failed()) break;
+            pool.submit(tasks, [&, batch = std::move(batch)] {
+                verify_non_solid_files(*source, batch, mismatches, checked_files, progress, no_verify);
+            });
         }
 
         for (const auto& pair : solid_blocks) {
-            results.emplace_back(pool.enqueue([&, pair, no_verify] {
-                verify_solid_block(archive_file, pair.second, temp_dir, mismatches, checked_files, progress_counter, total_items_to_process, raw_output, use_basic_chars, no_verify, start_time);
-            }));
+            if (tasks.failed()) break;
+            pool.submit(tasks, [&, &block_items = pair.second] {
+                verify_solid_block(*source, block_items, mismatches, checked_files, progress, no_verify);
+            });
         }
 
-        for(auto && result : results)
-            result.get();
+        tasks.wait();
     }
-    
+
+    progress.stop();
     if (total_items_to_process > 0 && !raw_output) {
         std::cout << std::endl;
     }
 
-    fs::remove_all(temp_dir);
-
     if (checked_files == 0) {
         log("Verification complete. No files had hashes to check.", LOG_SUM);
     } else if (mismatches == 0) {
@@ -6,6 +6,14 @@
 #include <prism/hashing.h>
 #include <prism/core/ui_utils.h>
 #include <prism/core/thread_pool.h>
+#include <prism/core/memory_budget.h>
+#include <prism/core/metrics.h>
+#include <prism/core/sampling.h>
+#include <prism/core/batch_io.h>
+#include <prism/core/sparse.h>
+#include <prism/core/solid_stream.h>
+#include <prism/core/archive_index.h>
+#include <prism/core/metadata_codec.h>
 #include <fstream>
 #include <iostream>
 #include <iomanip>
@@ -17,6 +25,15 @@
 #include <stdexcept>
 #include <algorithm>
 #include <cstring>
+#include <cerrno>
+#include <deque>
+#include <chrono>
+#include <exception>
+
+#ifndef _WIN32
+#include <unistd.h>
+#include <sys/stat.h>
+#endif
 
 namespace fs = std::filesystem;
 
@@ -51,1270 +68,860 @@ std::string get_archive_path(const std::string& file_path, const std::vector<std
 
     return fs::relative(file_path, base_path).string();
 }
-} // anonymous namespace
-
-uint64_t estimate_archive_size(const std::string& archive_file, const std::vector<std::string>& paths,
-                             CompressionType comp_type,
-                             bool ignore_errors, const std::vector<std::string>& exclude_patterns, bool use_full_path);
-
-inline std::vector<char> create_solid_file_metadata(const std::string& archive_path, HashType hash_type, const std::string& file_hash, uint64_t file_size,
-                                                    uint64_t creation_time, uint64_t modification_time,
-                                                    uint32_t permissions, uint32_t uid, uint32_t gid) {
 
-    std::vector<char> metadata;
-
-    uint32_t path_len = archive_path.size();
-    metadata.resize(metadata.size() + 4);
-    memcpy(&metadata[metadata.size() - 4], &path_len, 4);
-    metadata.insert(metadata.end(), archive_path.begin(), archive_path.end());
-    
-    metadata.push_back(static_cast<uint8_t>(hash_type));
-    
-    uint16_t hash_len = file_hash.size();
-    metadata.resize(metadata.size() + 2);
-    memcpy(&metadata[metadata.size() - 2], &hash_len, 2);
-    metadata.insert(metadata.end(), file_hash.begin(), file_hash.end());
-    
-    metadata.resize(metadata.size() + 8);
-    memcpy(&metadata[metadata.size() - 8], &file_size, 8);
-
-    metadata.resize(metadata.size() + 8);
-    memcpy(&metadata[metadata.size() - 8], &creation_time, 8);
-    metadata.resize(metadata.size() + 8);
-    memcpy(&metadata[metadata.size() - 8], &modification_time, 8);
-    metadata.resize(metadata.size() + 4);
-    memcpy(&metadata[metadata.size() - 4], &permissions, 4);
-    metadata.resize(metadata.size() + 4);
-    memcpy(&metadata[metadata.size() - 4], &uid, 4);
-    metadata.resize(metadata.size() + 4);
-    memcpy(&metadata[metadata.size() - 4], &gid, 4);
-    
-    return metadata;
+std::vector<ManifestEntry> collect_input_files(const std::vector<std::string>& paths, const ExcludeMatcher& excludes, bool ignore_errors) {
+    std::vector<ManifestEntry> manifest;
+    for (const auto& path : paths) {
+        if (!file_exists(path)) {
+            if (ignore_errors) {
+                log("Warning: Path not found: '" + path + "' (ignored)", LOG_WARN);
+                continue;
+            } else {
+                throw std::runtime_error("Path not found: " + path);
+            }
+        }
+        if (is_directory(path)) {
+            list_files_recursive(path, manifest, excludes);
+        } else if (!excludes.matches(path)) {
+            std::error_code ec;
+            uint64_t size = fs::file_size(path, ec);
+            manifest.push_back({path, ec ? 0 : size});
+        }
+    }
+    return manifest;
 }
 
+uint64_t manifest_bytes(const std::vector<ManifestEntry>& manifest) {
+    uint64_t total = 0;
+    for (const auto& entry : manifest) {
+        total += entry.size;
+    }
+    return total;
+}
 
-
-ArchiveCreationResult create_archive(const std::string& archive_file, const std::vector<std::string>& paths,
-
-                   CompressionType comp_type, int level, HashType hash_type, 
-
-                   bool ignore_errors, const std::vector<std::string>& exclude_patterns, bool use_full_path, bool auto_yes, int num_threads, bool raw_output, bool use_basic_chars, bool solid_mode) {
-
-
-
-    uint64_t estimated_size = estimate_archive_size(archive_file, paths, comp_type, ignore_errors, exclude_patterns, use_full_path);
-
+void check_free_space(const std::string& archive_file, const std::vector<ManifestEntry>& manifest, CompressionType comp_type,
+                      int level, HashType hash_type, int num_threads, bool auto_yes, const std::string& cancel_message) {
     fs::path p = archive_file;
-
     fs::path parent = p.parent_path();
-
     std::string path_for_space_check = parent.empty() ? "." : parent.string();
-
     uint64_t free_space = get_free_disk_space(path_for_space_check);
 
+    // Skip sampling when even storing everything uncompressed would fit.
+    uint64_t total_size = manifest_bytes(manifest);
+    uint64_t worst_case = total_size + total_size / 100 + manifest.size() * 256;
+    if (worst_case <= free_space) {
+        return;
+    }
 
-
+    uint64_t estimated_size = estimate_archive_size(manifest, comp_type, level, hash_type, num_threads);
     if (estimated_size > free_space) {
-
         std::string message = "Warning: Estimated archive size (" + format_size(estimated_size) + ") exceeds available disk space (" + format_size(free_space) + ") on target drive. Continue anyway?";
-
         if (!confirm_action(message, auto_yes)) {
-
-            throw std::runtime_error("Archive creation cancelled by user.");
-
+            throw std::runtime_error(cancel_message);
         }
-
     }
+}
 
+// Reads one input file for a non-solid entry. Sparse files are read as their
+// data extents only, which are returned in extents (empty for a file that is all
+// hole); file_size is the apparent size.
+bool read_input_file(const std::string& path, std::vector<char>& data, std::vector<FileExtent>& extents, uint64_t& file_size, bool& sparse) {
+    sparse = get_data_extents(path, extents, file_size);
+    if (sparse) {
+        return read_extents(path, extents, data);
+    }
+    if (!read_file_contents(path, data)) {
+        return false;
+    }
+    file_size = data.size();
+    return true;
+}
 
-
-    std::vector<std::string> all_files;
-
-    for (const auto& path : paths) {
-
-        if (!file_exists(path)) {
-
-            if (ignore_errors) {
-
-                log("Warning: Path not found: '" + path + "' (ignored)", LOG_WARN);
-
-                continue;
-
+// Streams files into framed solid data on out. Batches of small files are
+// read, stat'ed and hashed by read-ahead tasks while earlier frames compress;
+// files larger than a batch are read and hashed in chunks as they are fed to
+// the encoder, so memory stays bounded by the read-ahead window and the
+// frames in flight.
+// The per-file records are returned for the caller to write after the data.
+struct SolidStreamResult {
+    std::vector<char> metadata_block;
+    uint64_t framed_size = 0;
+    uint64_t uncompressed_size = 0;
+    int files_added = 0;
+};
+
+SolidStreamResult write_solid_stream(std::ofstream& out, const std::vector<ManifestEntry>& files, const std::vector<std::string>& paths,
+                                     bool use_full_path, CompressionType comp_type, int level, HashType hash_type, bool ignore_errors,
+                                     int num_threads, ProgressReporter& progress) {
+    const size_t BATCH_FILES = 64;
+    const uint64_t BATCH_BYTES = 4 * 1024 * 1024;
+    const uint64_t READ_AHEAD_BYTES = 64 * 1024 * 1024;
+
+    struct LoadedFile {
+        FileReadRequest request;
+        bool streamed = false;
+        FileMetadata props;
+        bool props_ok = false;
+        std::string hash;
+    };
+    using Batch = std::vector<LoadedFile>;
+
+    size_t frames = solid_frames_in_flight(num_threads, READ_AHEAD_BYTES + BATCH_BYTES);
+    MemoryReservation reservation(READ_AHEAD_BYTES + BATCH_BYTES + frames * 2 * (uint64_t)SOLID_FRAME_SIZE);
+    ThreadPool pool(std::max(1, num_threads));
+    SolidFrameWriter writer(out, comp_type, level, pool, frames);
+    SolidStreamResult result;
+
+    std::deque<std::pair<std::future<Batch>, uint64_t>> ahead;
+    uint64_t ahead_bytes = 0;
+    size_t next = 0;
+    auto refill = [&]() {
+        while (next < files.size()) {
+            size_t begin = next;
+            size_t end = next;
+            uint64_t batch_bytes = 0;
+            bool streamed = files[begin].size > BATCH_BYTES;
+            if (streamed) {
+                end++;
             } else {
-
-                throw std::runtime_error("Path not found: " + path);
-
+                while (end < files.size() && end - begin < BATCH_FILES && files[end].size <= BATCH_BYTES &&
+                       (end == begin || batch_bytes + files[end].size <= BATCH_BYTES)) {
+                    batch_bytes += files[end].size;
+                    end++;
+                }
             }
-
+            if (!ahead.empty() && ahead_bytes + batch_bytes > READ_AHEAD_BYTES) break;
+            next = end;
+            ahead_bytes += batch_bytes;
+            ahead.emplace_back(pool.enqueue([&files, begin, end, streamed, hash_type] {
+                std::vector<FileReadRequest> requests;
+                for (size_t i = begin; i < end; ++i) {
+                    requests.push_back({files[i].path, files[i].size, {}, 0});
+                }
+                if (streamed) {
+                    Batch batch(1);
+                    batch[0].request = std::move(requests[0]);
+                    batch[0].streamed = true;
+                    batch[0].props_ok = get_file_properties(batch[0].request.path, batch[0].props);
+                    return batch;
+                }
+                {
+                    StageTimer read_timer(Stage::READ);
+                    read_files(requests);
+                    uint64_t bytes = 0;
+                    for (const auto& request : requests) bytes += request.data.size();
+                    read_timer.stop(bytes);
+                }
+                Batch batch(requests.size());
+                for (size_t i = 0; i < requests.size(); ++i) {
+                    LoadedFile& file = batch[i];
+                    file.request = std::move(requests[i]);
+                    if (file.request.error != 0) continue;
+                    StageTimer hash_timer(Stage::HASH);
+                    file.hash = prism::hashing::calculate_hash_from_data(file.request.data, hash_type);
+                    hash_timer.stop(file.request.data.size());
+                    file.props_ok = get_file_properties(file.request.path, file.props);
+                }
+                return batch;
+            }), batch_bytes);
         }
-
-        if (is_directory(path)) {
-
-            list_files_recursive(path, all_files, exclude_patterns);
-
-        } else {
-
-            if (!should_exclude(path, exclude_patterns)) {
-
-                all_files.push_back(path);
-
+    };
+
+    std::vector<char> chunk(BATCH_BYTES);
+    refill();
+    while (!ahead.empty()) {
+        Batch batch = ahead.front().first.get();
+        ahead_bytes -= ahead.front().second;
+        ahead.pop_front();
+        refill();
+
+        for (auto& file : batch) {
+            const std::string& file_path = file.request.path;
+            std::ifstream stream;
+            if (file.streamed) {
+                stream.open(file_path, std::ios::binary);
+                if (!stream) file.request.error = EIO;
             }
-
-        }
-
-    }
-
-
-
-    if (solid_mode) {
-
-        log("Creating solid archive file named '" + archive_file + "'", LOG_INFO);
-
-
-
-        std::vector<char> all_uncompressed_data;
-
-                std::vector<char> metadata_block;
-
-                uint64_t total_uncompressed_size = 0;
-
-                int files_added = 0;
-
-                auto start_time = std::chrono::steady_clock::now();
-
-        
-
-                for (const auto& file_path : all_files) {
-
-                        std::string archive_path = get_archive_path(file_path, paths, use_full_path);
-
-
-
-            std::ifstream file(file_path, std::ios::binary);
-
-            if (!file) {
-
+            if (file.request.error != 0) {
                 if (ignore_errors) {
-
                     log("Warning: Cannot open file: '" + file_path + "' (ignored)", LOG_WARN);
-
                     continue;
-
                 } else {
-
                     throw std::runtime_error("Cannot open file: " + file_path);
-
                 }
-
+            }
+            if (!file.props_ok) {
+                if (ignore_errors) {
+                    log("Warning: Failed to get properties for file: '" + file_path + "' (ignored)", LOG_WARN);
+                    continue;
+                } else {
+                    throw std::runtime_error("Failed to get properties for file: " + file_path);
+                }
             }
 
-            std::vector<char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
-
-            file.close();
-
-
-
-            all_uncompressed_data.insert(all_uncompressed_data.end(), data.begin(), data.end());
-
-                                    std::string hash = prism::hashing::calculate_hash(file_path, hash_type);
-
-
-
-            
-
-
-
-                        FileMetadata file_props;
-
-
-
-                        if (!get_file_properties(file_path, file_props)) {
-
-
-
-                            if (ignore_errors) {
-
-
-
-                                log("Warning: Failed to get properties for file: '" + file_path + "' (ignored)", LOG_WARN);
-
-
-
-                                continue;
-
-
-
-                            } else {
-
-
-
-                                throw std::runtime_error("Failed to get properties for file: " + file_path);
-
-
-
-                            }
-
-
-
-                        }
-
-
-
-            
-
-
-
-                        std::vector<char> file_metadata = create_solid_file_metadata(archive_path, hash_type, hash, data.size(),
-
-
-
-                                                                                     file_props.creation_time, file_props.modification_time,
-
-
-
-                                                                                     file_props.permissions, file_props.uid, file_props.gid);
-
-            metadata_block.insert(metadata_block.end(), file_metadata.begin(), file_metadata.end());
-
-            
-
-            files_added++;
-
-            show_progress_bar(files_added, all_files.size(), archive_path, data.size(), 0, start_time, raw_output, use_basic_chars);
+            uint64_t file_size = 0;
+            std::string file_hash = file.hash;
+            if (file.streamed) {
+                prism::hashing::StreamHasher hasher(hash_type);
+                while (stream) {
+                    StageTimer read_timer(Stage::READ);
+                    stream.read(chunk.data(), chunk.size());
+                    size_t got = static_cast<size_t>(stream.gcount());
+                    read_timer.stop(got);
+                    if (got == 0) break;
+                    {
+                        StageTimer hash_timer(Stage::HASH);
+                        hasher.update(chunk.data(), got);
+                        hash_timer.stop(got);
+                    }
+                    writer.write(chunk.data(), got);
+                    file_size += got;
+                }
+                // Bytes already handed to the encoder cannot be taken back, so
+                // a read failure part way through a file is fatal even with -i.
+                if (stream.bad()) {
+                    throw std::runtime_error("Error reading file: " + file_path);
+                }
+                file_hash = hasher.finish();
+            } else {
+                const std::vector<char>& data = file.request.data;
+                writer.write(data.data(), data.size());
+                file_size = data.size();
+            }
+            result.uncompressed_size += file_size;
 
+            std::string archive_path = get_archive_path(file_path, paths, use_full_path);
+            std::vector<char> file_metadata = create_solid_file_metadata(archive_path, hash_type, file_hash, file_size,
+                                                                         file.props.creation_time, file.props.modification_time,
+                                                                         file.props.permissions, file.props.uid, file.props.gid);
+            result.metadata_block.insert(result.metadata_block.end(), file_metadata.begin(), file_metadata.end());
+            result.files_added++;
+            progress.file_done(archive_path, file_size, 0);
         }
+    }
 
-        
-
-        if (files_added > 0 && !raw_output) std::cout << std::endl;
-
-
-
-        log("Compressing solid block...", LOG_INFO);
-
-        std::vector<char> compressed_data = compression::compress_data(all_uncompressed_data, comp_type, level);
-
-        log("Compression complete.", LOG_VERBOSE);
-
-
-
-        std::ofstream out(archive_file, std::ios::binary);
-
-        if (!out) {
-
-            throw std::runtime_error("Cannot create archive file: " + archive_file);
+    result.framed_size = writer.finish();
+    return result;
+}
 
+// Files below this size are packed into small-file groups in non-solid archives.
+const uint64_t GROUP_FILE_MAX_SIZE = 64 * 1024;
+// Uncompressed size at which a group is closed; extracting one small file decodes at most about this much.
+const uint64_t GROUP_TARGET_SIZE = 2 * 1024 * 1024;
+
+// Splits the inputs into batches of files stored as their own entries and
+// groups of small files. Grouping by extension, then directory, keeps similar content
+// in the same codec context. Entries are moved out of manifest, which is left empty.
+void plan_file_groups(std::vector<ManifestEntry>& manifest, CompressionType comp_type, bool group_small_files,
+                      std::vector<std::vector<ManifestEntry>>& single_batches, std::vector<std::vector<ManifestEntry>>& groups) {
+    std::vector<ManifestEntry> singles;
+    std::vector<ManifestEntry> small;
+    for (auto& entry : manifest) {
+        if (group_small_files && entry.size < GROUP_FILE_MAX_SIZE && should_compress(entry.path, comp_type)) {
+            small.push_back(std::move(entry));
+        } else {
+            singles.push_back(std::move(entry));
         }
-
-
-
-                out.write("PRZM", 4);
-
-
-
-                uint16_t version = 2;
-
-
-
-                out.write((char*)&version, 2);
-
-
-
-                uint8_t flags = SOLID_ARCHIVE_FLAG;
-
-
-
-                out.write((char*)&flags, 1);
-
-
-
-                out.write((char*)&comp_type, 1);
-
-
-
-                out.write((char*)&level, 1);
-
-
-
-                
-
-
-
-                uint64_t metadata_size = metadata_block.size();
-
-        out.write((char*)&metadata_size, 8);
-
-        out.write(metadata_block.data(), metadata_block.size());
-
-        out.write(compressed_data.data(), compressed_data.size());
-
-        
-
-        log("Successfully created solid archive '" + archive_file + "'", LOG_SUCCESS);
-
-        log("Items added: " + std::to_string(files_added) + " files", LOG_SUM);
-
-        log("Total uncompressed data: " + format_size(total_uncompressed_size), LOG_SUM);
-
-        log("Total compressed data: " + format_size(compressed_data.size()), LOG_SUM);
-
-        if (total_uncompressed_size > 0) {
-
-            double ratio = 100.0 * (1.0 - (double)compressed_data.size() / total_uncompressed_size);
-
-            log("Compression ratio: " + std::to_string((int)ratio) + "%", LOG_SUM);
-
+    }
+    std::vector<ManifestEntry>().swap(manifest);
+
+    std::sort(small.begin(), small.end(), [](const ManifestEntry& a, const ManifestEntry& b) {
+        std::string ext_a = get_extension(a.path), ext_b = get_extension(b.path);
+        if (ext_a != ext_b) return ext_a < ext_b;
+        std::string dir_a = fs::path(a.path).parent_path().string(), dir_b = fs::path(b.path).parent_path().string();
+        if (dir_a != dir_b) return dir_a < dir_b;
+        return a.path < b.path;
+    });
+
+    std::vector<ManifestEntry> current;
+    uint64_t current_size = 0;
+    auto close_group = [&]() {
+        if (current.size() == 1) {
+            singles.push_back(std::move(current[0]));
+        } else if (!current.empty()) {
+            groups.push_back(std::move(current));
         }
+        current.clear();
+        current_size = 0;
+    };
+    for (auto& entry : small) {
+        current_size += entry.size;
+        current.push_back(std::move(entry));
+        if (current_size >= GROUP_TARGET_SIZE) {
+            close_group();
+        }
+    }
+    close_group();
 
+    single_batches = make_task_batches(std::move(singles), [](const ManifestEntry& entry) { return entry.size; });
+}
 
+// Reads, hashes and compresses one group of small files and writes it as a
+// single SOLID_GROUP_MAGIC record, adding its files to entries under
+// out_mutex. existing_paths is only set when appending.
+void write_file_group(const std::vector<ManifestEntry>& group, const std::vector<std::string>& paths, bool use_full_path,
+                      CompressionType comp_type, int level, HashType hash_type, bool ignore_errors,
+                      const std::set<std::string_view>* existing_paths, ArchiveSink& out, std::mutex& out_mutex,
+                      ArchiveCatalog& entries, std::mutex& cout_mutex,
+                      ProgressReporter& progress, std::atomic<int>& total_files, std::atomic<uint64_t>& total_uncompressed,
+                      std::atomic<uint64_t>& total_compressed, std::atomic<uint64_t>& total_header_size,
+                      std::atomic<uint64_t>& total_file_data_size, std::atomic<uint64_t>& total_metadata_size) {
+    std::vector<FileReadRequest> requests;
+    std::vector<std::string> archive_paths;
+    uint64_t group_size = 0;
+    for (const auto& entry : group) {
+        std::string archive_path = get_archive_path(entry.path, paths, use_full_path);
+        if (existing_paths && existing_paths->count(archive_path)) {
+            if (ignore_errors) {
+                std::lock_guard<std::mutex> lock(cout_mutex);
+                log("Warning: File already exists in archive: '" + archive_path + "' (ignored)", LOG_WARN);
+                continue;
+            } else {
+                throw std::runtime_error("File already exists in archive: " + archive_path);
+            }
+        }
+        requests.push_back({entry.path, entry.size, {}, 0});
+        archive_paths.push_back(archive_path);
+        group_size += entry.size;
+    }
 
-        return { (long)files_added, total_uncompressed_size, compressed_data.size(),
-                 (uint64_t)(4 + 2 + 1 + 1 + 1 + 8) + metadata_block.size(), // PRZM + version + flags + comp_type + level + metadata_size_field + metadata_block
-                 metadata_block.size(),
-                 compressed_data.size(),
-                 {} };
-
-
-
-    } else {
-
-        std::ofstream out(archive_file, std::ios::binary);
-
-        if (!out) {
-
-            throw std::runtime_error("Cannot create archive file: " + archive_file);
-
-        }
-
-        
-
-        out.write("PRZM", 4);
-
-        uint16_t version = 2;
-
-        out.write((char*)&version, 2);
-
-        uint8_t flags = 0;
-
-        out.write((char*)&flags, 1);
-
-        
-
-                log("Created archive file named '" + archive_file + "' using " + std::to_string(num_threads) + " threads.", LOG_INFO);
-
-        
-
-                
-
-        
-
-                                                                        std::atomic<int> total_files = 0;
-
-        
-
-                
-
-        
-
-                                                        
-
-        
-
-                
-
-        
-
-                                                                        std::atomic<uint64_t> total_uncompressed = 0;
-
-        
-
-                
-
-        
-
-                                                        
-
-        
-
-                
-
-        
-
-                                                                        std::atomic<uint64_t> total_compressed = 0;
-
-        
-
-                
-
-        
-
-                                                        
-
-        
-
-                
-
-        
-
-                                                                        std::atomic<uint64_t> total_header_size = 0;
-
-        
-
-                
-
-        
-
-                                                        
-
-        
-
-                
-
-        
-
-                                                                        std::atomic<uint64_t> total_file_data_size = 0;
-
-        
-
-                
-
-        
-
-                                                        
-
-        
-
-                
-
-        
-
-                                                                        std::atomic<uint64_t> total_metadata_size = 0;
-
-        
-
-                
-
-        
-
-                        std::atomic<int> progress_counter = 0;
-
-        
-
-                
-
-        
-
-                        auto start_time = std::chrono::steady_clock::now();
-
-        
-
-                
-
-        
-
-                        
-
-        
-
-                
-
-        
-
-                        std::mutex out_mutex;
-
-        
-
-                
-
-        
-
-                        std::mutex cout_mutex;
-
-        
-
-                
-
-        
-
-                        std::vector<long long> durations_ms;
-
-        
-
-                
-
-        
-
-                
-
-        
-
-                
-
-        
-
-                        {
-
-        
-
-                
-
-        
-
-                            ThreadPool pool(num_threads);
-
-        
-
-                
-
-        
-
-                            std::vector<std::future<void>> results;
-
-        
-
-                
-
-        
-
-                
-
-        
-
-                
-
-        
-
-                                                        for (const auto& file_path : all_files) {
-
-        
-
-                
-
-        
-
-                
-
-        
-
-                
-
-        
-
-                                    
-
-        
-
-                
-
-        
-
-                
-
-        
-
-                
-
-        
-
-                                                            results.emplace_back(pool.enqueue([&, file_path, &total_metadata_size] {
-
-        
-
-                
-
-        
-
-                                    std::string archive_path = get_archive_path(file_path, paths, use_full_path);
-
-        
-
-                
-
-        
-
-                                    
-
-        
-
-                
-
-        
-
-                                    CompressionType actual_comp = should_compress(file_path, comp_type) ? comp_type : CompressionType::NONE;
-
-        
-
-                
-
-        
-
-                                    if (actual_comp != comp_type) {
-
-        
-
-                
-
-        
-
-                                        std::lock_guard<std::mutex> lock(cout_mutex);
-
-        
-
-                
-
-        
-
-                                        log("Skipping compression for already compressed file '" + file_path + "'", LOG_VERBOSE);
-
-        
-
-                
-
-        
-
-                                    }
-
-        
-
-                
-
-        
-
-                                    
-
-        
-
-                
-
-        
-
-                                    std::ifstream file(file_path, std::ios::binary);
-
-        
-
-                
-
-        
-
-                                    if (!file) {
-
-        
-
-                
-
-        
-
-                                        if (ignore_errors) {
-
-        
-
-                
-
-        
-
-                                            std::lock_guard<std::mutex> lock(cout_mutex);
-
-        
-
-                
-
-        
-
-                                            log("Warning: Cannot open file: '" + file_path + "' (ignored)", LOG_WARN);
-
-        
-
-                
-
-        
-
-                                            return;
-
-        
-
-                
-
-        
-
-                                        } else {
-
-        
-
-                
-
-        
-
-                                            throw std::runtime_error("Cannot open file: " + file_path);
-
-        
-
-                
-
-        
-
-                                        }
-
-        
-
-                
-
-        
-
-                                    }
-
-        
-
-                
-
-        
-
-                                    
-
-        
-
-                
-
-        
-
-                                    std::vector<char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
-
-        
-
-                
-
-        
-
-                                    file.close();
-
-        
-
-                
-
-        
-
-                                    
-
-        
-
-                
-
-        
-
-                                    std::string hash = prism::hashing::calculate_hash(file_path, hash_type);
-
-        
-
-                
-
-        
-
-                                    std::vector<char> compressed = compression::compress_data(data, actual_comp, level);
-
-        
-
-                
-
-        
-
-                                    
-
-        
-
-                
-
-        
-
-                                    FileMetadata file_props;
-
-        
-
-                
-
-        
-
-                                    if (!get_file_properties(file_path, file_props)) {
-
-        
-
-                
-
-        
-
-                                        if (ignore_errors) {
-
-        
-
-                
-
-        
-
-                                            std::lock_guard<std::mutex> lock(cout_mutex);
-
-        
-
-                
-
-        
-
-                                            log("Warning: Failed to get properties for file: '" + file_path + "' (ignored)", LOG_WARN);
-
-        
-
-                
-
-        
-
-                                            return;
-
-        
-
-                
-
-        
-
-                                        } else {
-
-        
-
-                
-
-        
-
-                                            throw std::runtime_error("Failed to get properties for file: " + file_path);
-
-        
-
-                
-
-        
-
-                                        }
-
-        
-
-                
-
-        
-
-                                    }
-
-        
-
-                
-
-        
-
-                
-
-        
-
-                
-
-        
-
-                                    std::vector<char> header = create_archive_header(archive_path, actual_comp, level, 
-
-        
-
-                
-
-        
-
-                                                                               hash_type, hash, data.size(), compressed.size(),
-
-        
-
-                
-
-        
-
-                                                                               file_props.creation_time, file_props.modification_time,
-
-        
-
-                
-
-        
-
-                                                                               file_props.permissions, file_props.uid, file_props.gid);
-
-        
-
-                
-
-        
-
-                                    
-
-        
-
-                
-
-        
-
-                                    {
-
-        
-
-                
-
-        
-
-                                        std::lock_guard<std::mutex> lock(out_mutex);
-
-        
-
-                
-
-        
-
-                                        out.write(header.data(), header.size());
-
-        
-
-                
-
-        
-
-                                        out.write(compressed.data(), compressed.size());
-
-        
-
-                
-
-        
-
-                                    }
-
-        
-
-                
-
-        
-
-                                    
-
-        
-
-                
-
-        
-
-                                    total_files++;
-
-        
-
-                
-
-        
-
-                                    total_uncompressed += data.size();
-
-        
-
-                
-
-        
-
-                                    total_compressed += compressed.size();
-
-        
-
-                
-
-        
-
-                                    total_header_size += header.size();
-
-        
-
-                
-
-        
-
-                                    total_file_data_size += compressed.size();
-
-        
-
-                
-
-        
-
-                                    
-
-        
-
-                
-
-        
-
-                                    {
-
-        
-
-                
-
-        
-
-                                        std::lock_guard<std::mutex> lock(cout_mutex);
-
-        
-
-                
-
-        
-
-                                        show_progress_bar(++progress_counter, all_files.size(), archive_path, data.size(), compressed.size(), start_time, raw_output, use_basic_chars);
-
-        
-
-                
-
-        
-
-                                    }
-
-        
-
-                
-
-        
-
-                                }));
-
-        
-
-                
-
-        
-
-                            }
-
-        
-
-                
-
-        
-
-                
-
-        
-
-                
-
-        
-
-                            for(auto && result : results)
-
-        
-
-                
-
-        
-
-                                result.get();
-
-        
-
-                
-
-        
-
-                            
-
-        
-
-                
-
-        
-
-                            durations_ms = pool.get_thread_durations();
-
-        
-
-                
-
-        
-
-                        }
-
-        
-
-                
-
-        
-
-                        
-
-        
-
-                
-
-        
-
-                        if (total_files > 0 && !raw_output) std::cout << std::endl;
-
-        
-
-                
-
-        
-
-                        
-
-        
-
-                
+    // The files, their concatenation and its compressed copy are held together.
+    MemoryReservation reservation(3 * group_size);
+    {
+        StageTimer read_timer(Stage::READ);
+        read_files(requests);
+        uint64_t bytes = 0;
+        for (const auto& request : requests) bytes += request.data.size();
+        read_timer.stop(bytes);
+    }
 
-        
+    std::vector<char> group_data;
+    std::vector<char> metadata_block;
+    std::vector<std::pair<std::string, uint64_t>> added;
+    for (size_t i = 0; i < requests.size(); ++i) {
+        const FileReadRequest& request = requests[i];
+        const std::string& file_path = request.path;
+        if (request.error != 0) {
+            if (ignore_errors) {
+                std::lock_guard<std::mutex> lock(cout_mutex);
+                log("Warning: Cannot open file: '" + file_path + "' (ignored)", LOG_WARN);
+                continue;
+            } else {
+                throw std::runtime_error("Cannot open file: " + file_path);
+            }
+        }
 
-                        log("Successfully created archive '" + archive_file + "'", LOG_SUCCESS);
+        FileMetadata file_props;
+        if (!get_file_properties(file_path, file_props)) {
+            if (ignore_errors) {
+                std::lock_guard<std::mutex> lock(cout_mutex);
+                log("Warning: Failed to get properties for file: '" + file_path + "' (ignored)", LOG_WARN);
+                continue;
+            } else {
+                throw std::runtime_error("Failed to get properties for file: " + file_path);
+            }
+        }
 
-        
+        StageTimer hash_timer(Stage::HASH);
+        std::string hash = prism::hashing::calculate_hash_from_data(request.data, hash_type);
+        hash_timer.stop(request.data.size());
 
-                
+        std::vector<char> file_metadata = create_solid_file_metadata(archive_paths[i], hash_type, hash, request.data.size(),
+                                                                     file_props.creation_time, file_props.modification_time,
+                                                                     file_props.permissions, file_props.uid, file_props.gid);
+        metadata_block.insert(metadata_block.end(), file_metadata.begin(), file_metadata.end());
+        group_data.insert(group_data.end(), request.data.begin(), request.data.end());
+        added.emplace_back(archive_paths[i], request.data.size());
+    }
 
-        
+    if (added.empty()) return;
+
+    StageTimer compress_timer(Stage::COMPRESS);
+    std::vector<char> compressed = compression::compress_data(group_data, comp_type, level);
+    compress_timer.stop(group_data.size());
+
+    uint8_t comp_byte = static_cast<uint8_t>(comp_type);
+    uint8_t level_byte = static_cast<uint8_t>(level);
+    uint64_t metadata_size;
+    std::vector<char> stored_metadata = encode_metadata_block(metadata_block, comp_type, level, metadata_size);
+    uint64_t compressed_size = compressed.size();
+    SolidRecords block;
+    block.records = std::move(metadata_block);
+    block.comp_type = comp_type;
+    block.level = level_byte;
+    block.compressed_size = compressed_size;
+    {
+        StageTimer write_timer(Stage::WRITE);
+        std::lock_guard<std::mutex> lock(out_mutex);
+        block.data_start = out.position() + 22 + stored_metadata.size();
+        out.write(SOLID_GROUP_MAGIC, 4);
+        out.write((char*)&comp_byte, 1);
+        out.write((char*)&level_byte, 1);
+        out.write((char*)&metadata_size, 8);
+        out.write((char*)&compressed_size, 8);
+        out.write(stored_metadata.data(), stored_metadata.size());
+        out.write(compressed.data(), compressed.size());
+        write_timer.stop(22 + stored_metadata.size() + compressed.size());
+        add_solid_entries(entries, block);
+    }
 
-                        log("Items added: " + std::to_string(total_files.load()) + " files", LOG_SUM);
+    total_files += added.size();
+    total_uncompressed += group_data.size();
+    total_compressed += compressed.size();
+    total_header_size += 22 + stored_metadata.size(); // magic + comp + level + metadata_size + compressed_size + metadata
+    total_file_data_size += compressed.size();
+    total_metadata_size += stored_metadata.size();
 
-        
+    for (const auto& file : added) {
+        progress.file_done(file.first, file.second, 0);
+    }
+}
 
-                
+// Reads, hashes and compresses a batch of files stored as their own entries.
+// A batch of small files is written with one lock and one write; a large
+// file comes alone and is written straight from its compressed copy. The
+// files are added to entries under out_mutex. existing_paths is only set
+// when appending.
+void write_single_files(const std::vector<ManifestEntry>& batch, const std::vector<std::string>& paths, bool use_full_path,
+                        CompressionType comp_type, int level, HashType hash_type, bool ignore_errors,
+                        const std::set<std::string_view>* existing_paths, ArchiveSink& out, std::mutex& out_mutex,
+                        ArchiveCatalog& entries, std::mutex& cout_mutex,
+                        ProgressReporter& progress, std::atomic<int>& total_files, std::atomic<uint64_t>& total_uncompressed,
+                        std::atomic<uint64_t>& total_compressed, std::atomic<uint64_t>& total_header_size,
+                        std::atomic<uint64_t>& total_file_data_size, std::atomic<uint64_t>& total_metadata_size) {
+    uint64_t batch_size = 0;
+    for (const auto& entry : batch) batch_size += entry.size;
+    // Each file and its compressed copy are held together.
+    MemoryReservation reservation(2 * batch_size);
+
+    // Offsets are relative to buffer until the batch is written.
+    std::vector<FileMetadata> added;
+    std::vector<char> buffer;
+    uint64_t header_bytes = 0;
+    uint64_t data_bytes = 0;
+    uint64_t metadata_bytes = 0;
+    for (const auto& entry : batch) {
+        const std::string& file_path = entry.path;
+        std::string archive_path = get_archive_path(file_path, paths, use_full_path);
+
+        if (existing_paths && existing_paths->count(archive_path)) {
+            if (ignore_errors) {
+                std::lock_guard<std::mutex> lock(cout_mutex);
+                log("Warning: File already exists in archive: '" + archive_path + "' (ignored)", LOG_WARN);
+                continue;
+            } else {
+                throw std::runtime_error("File already exists in archive: " + archive_path);
+            }
+        }
 
-        
+        CompressionType actual_comp = should_compress(file_path, comp_type) ? comp_type : CompressionType::NONE;
+        if (actual_comp != comp_type && log_enabled(LOG_VERBOSE)) {
+            std::lock_guard<std::mutex> lock(cout_mutex);
+            log("Skipping compression for already compressed file '" + file_path + "'", LOG_VERBOSE);
+        }
 
-                        log("Total uncompressed data: " + format_size(total_uncompressed.load()), LOG_SUM);
+        StageTimer read_timer(Stage::READ);
+        std::vector<char> data;
+        std::vector<FileExtent> extents;
+        uint64_t file_size = 0;
+        bool sparse = false;
+        if (!read_input_file(file_path, data, extents, file_size, sparse)) {
+            if (ignore_errors) {
+                std::lock_guard<std::mutex> lock(cout_mutex);
+                log("Warning: Cannot open file: '" + file_path + "' (ignored)", LOG_WARN);
+                continue;
+            } else {
+                throw std::runtime_error("Cannot open file: " + file_path);
+            }
+        }
+        read_timer.stop(data.size());
+
+        StageTimer hash_timer(Stage::HASH);
+        std::string hash = sparse ? hash_sparse_contents(extents, data.data(), file_size, hash_type)
+                                 : prism::hashing::calculate_hash_from_data(data, hash_type);
+        hash_timer.stop(file_size);
+
+        StageTimer compress_timer(Stage::COMPRESS);
+        std::vector<char> compressed = compression::compress_data(data, actual_comp, level);
+        compress_timer.stop(data.size());
+        if (sparse) {
+            compressed = encode_sparse_payload(extents, compressed);
+        }
 
-        
+        FileMetadata file_props;
+        if (!get_file_properties(file_path, file_props)) {
+            if (ignore_errors) {
+                std::lock_guard<std::mutex> lock(cout_mutex);
+                log("Warning: Failed to get properties for file: '" + file_path + "' (ignored)", LOG_WARN);
+                continue;
+            } else {
+                throw std::runtime_error("Failed to get properties for file: " + file_path);
+            }
+        }
 
-                
+        std::vector<char> header = create_archive_header(archive_path, actual_comp, level, 
+                                                         hash_type, hash, file_size, compressed.size(),
+                                                         file_props.creation_time, file_props.modification_time,
+                                                         file_props.permissions, file_props.uid, file_props.gid, sparse);
+
+        FileMetadata item = file_props;
+        item.path = archive_path;
+        item.compression_type = actual_comp;
+        item.level = level;
+        item.hash_type = hash_type;
+        item.file_hash = hash;
+        item.file_size = file_size;
+        item.compressed_size = compressed.size();
+        item.is_solid = false;
+        item.is_sparse = sparse;
+        item.is_framed = false;
+        item.header_start_offset = buffer.size();
+        item.data_start_offset = buffer.size() + header.size();
+
+        if (batch.size() == 1) {
+            StageTimer write_timer(Stage::WRITE);
+            std::lock_guard<std::mutex> lock(out_mutex);
+            item.header_start_offset = out.position();
+            item.data_start_offset = item.header_start_offset + header.size();
+            out.write(header.data(), header.size());
+            out.write(compressed.data(), compressed.size());
+            write_timer.stop(header.size() + compressed.size());
+            entries.add(item);
+        } else {
+            buffer.insert(buffer.end(), header.begin(), header.end());
+            buffer.insert(buffer.end(), compressed.begin(), compressed.end());
+        }
 
-        
+        header_bytes += header.size();
+        data_bytes += compressed.size();
+        metadata_bytes += sizeof(uint32_t) + archive_path.size() + // path_len + archive_path
+                          sizeof(uint8_t) + // compression_type
+                          sizeof(uint8_t) + // level
+                          sizeof(uint8_t) + // hash_type
+                          sizeof(uint16_t) + hash.size() + // hash_len + file_hash
+                          sizeof(uint64_t) + // file_size
+                          sizeof(uint64_t) + // compressed_size
+                          sizeof(uint64_t) + // creation_time
+                          sizeof(uint64_t) + // modification_time
+                          sizeof(uint32_t) + // permissions
+                          sizeof(uint32_t) + // uid
+                          sizeof(uint32_t); // gid
+        added.push_back(std::move(item));
+    }
 
-                        log("Total compressed data: " + format_size(total_compressed.load()), LOG_SUM);
+    if (!buffer.empty()) {
+        StageTimer write_timer(Stage::WRITE);
+        std::lock_guard<std::mutex> lock(out_mutex);
+        uint64_t base = out.position();
+        out.write(buffer.data(), buffer.size());
+        write_timer.stop(buffer.size());
+        for (auto& item : added) {
+            item.header_start_offset += base;
+            item.data_start_offset += base;
+            entries.add(item);
+        }
+    }
 
-        
+    uint64_t uncompressed_bytes = 0;
+    for (const auto& file : added) uncompressed_bytes += file.file_size;
+    total_files += added.size();
+    total_uncompressed += uncompressed_bytes;
+    total_compressed += data_bytes;
+    total_header_size += header_bytes;
+    total_file_data_size += data_bytes;
+    total_metadata_size += metadata_bytes;
+
+    for (const auto& file : added) {
+        progress.file_done(file.path, file.file_size, file.compressed_size);
+    }
+}
 
-                
+// Adds the files of a framed block that write_solid_stream wrote starting at
+// data_start; stream's records are moved out.
+void add_solid_stream_entries(ArchiveCatalog& entries, SolidStreamResult& stream, CompressionType comp_type, int level, uint64_t data_start) {
+    SolidRecords block;
+    block.records = std::move(stream.metadata_block);
+    block.comp_type = comp_type;
+    block.level = static_cast<uint8_t>(level);
+    block.data_start = data_start;
+    block.compressed_size = stream.framed_size;
+    block.framed = true;
+    add_solid_entries(entries, block);
+}
 
-        
+// Appends the index of entries, which must hold every item of the archive.
+void append_archive_index(const std::string& archive_file, const ArchiveCatalog& entries) {
+    FileSink sink(archive_file, true);
+    write_archive_index(sink, entries);
+    sink.flush();
+}
 
-                        
+// Properties for entries added from memory: a regular file owned by the
+// current user, modified now.
+FileMetadata buffer_properties() {
+    FileMetadata props{};
+    auto now = fs::file_time_type::clock::now();
+    props.modification_time = std::chrono::duration_cast<std::chrono::seconds>(now.time_since_epoch()).count();
+    props.creation_time = props.modification_time;
+#ifdef _WIN32
+    props.permissions = static_cast<uint32_t>(fs::perms::owner_read | fs::perms::owner_write | fs::perms::group_read | fs::perms::others_read);
+    props.uid = 1000;
+    props.gid = 1000;
+#else
+    props.permissions = S_IFREG | 0644;
+    props.uid = getuid();
+    props.gid = getgid();
+#endif
+    return props;
+}
+} // anonymous namespace
 
-        
+ArchiveCreationResult create_archive(const std::string& archive_file, const std::vector<std::string>& paths,
+                   CompressionType comp_type, int level, HashType hash_type, 
+                   bool ignore_errors, const std::vector<std::string>& exclude_patterns, bool use_full_path, bool auto_yes, int num_threads, bool raw_output, bool use_basic_chars, bool solid_mode, bool group_small_files) {
+    ExcludeMatcher excludes(exclude_patterns);
+    StageTimer walk_timer(Stage::WALK);
+    std::vector<ManifestEntry> manifest = collect_input_files(paths, excludes, ignore_errors);
+    walk_timer.stop(0);
 
-                
+    check_free_space(archive_file, manifest, comp_type, level, hash_type, num_threads, auto_yes, "Archive creation cancelled by user.");
 
-        
+    if (solid_mode) {
+        log("Creating solid archive file named '" + archive_file + "'", LOG_INFO);
 
-                        if (total_uncompressed > 0) {
+        std::ofstream out(archive_file, std::ios::binary);
+        if (!out) {
+            throw std::runtime_error("Cannot create archive file: " + archive_file);
+        }
 
-        
+        out.write("PRZM", 4);
+        uint16_t version = ARCHIVE_VERSION;
+        out.write((char*)&version, 2);
+        uint8_t flags = SOLID_ARCHIVE_FLAG | SOLID_STREAM_FLAG;
+        out.write((char*)&flags, 1);
+        out.write((char*)&comp_type, 1);
+        out.write((char*)&level, 1);
+        uint64_t data_start = out.tellp();
 
-                
+        ProgressReporter progress(manifest.size(), manifest_bytes(manifest), raw_output, use_basic_chars);
+        SolidStreamResult stream = write_solid_stream(out, manifest, paths, use_full_path, comp_type, level, hash_type,
+                                                      ignore_errors, num_threads, progress);
+        progress.stop();
+        if (stream.files_added > 0 && !raw_output) std::cout << std::endl;
 
-        
+        uint64_t metadata_size;
+        std::vector<char> metadata_block = encode_metadata_block(stream.metadata_block, comp_type, level, metadata_size);
+        {
+            StageTimer write_timer(Stage::WRITE);
+            out.write((char*)&metadata_size, 8);
+            out.write(metadata_block.data(), metadata_block.size());
+            write_timer.stop(8 + metadata_block.size());
+        }
+        out.close();
+        if (!out) {
+            throw std::runtime_error("Failed writing archive file: " + archive_file);
+        }
 
-                            double ratio = 100.0 * (1.0 - (double)total_compressed.load() / total_uncompressed.load());
+        ArchiveCatalog entries;
+        add_solid_stream_entries(entries, stream, comp_type, level, data_start);
+        append_archive_index(archive_file, entries);
 
-        
+        int files_added = stream.files_added;
+        uint64_t total_uncompressed_size = stream.uncompressed_size;
+        uint64_t compressed_size = stream.framed_size;
 
-                
+        log("Successfully created solid archive '" + archive_file + "'", LOG_SUCCESS);
+        log("Items added: " + std::to_string(files_added) + " files", LOG_SUM);
+        log("Total uncompressed data: " + format_size(total_uncompressed_size), LOG_SUM);
+        log("Total compressed data: " + format_size(compressed_size), LOG_SUM);
+        if (total_uncompressed_size > 0) {
+            double ratio = 100.0 * (1.0 - (double)compressed_size / total_uncompressed_size);
+            log("Compression ratio: " + std::to_string((int)ratio) + "%", LOG_SUM);
+        }
 
-        
+        return { (long)files_added, total_uncompressed_size, compressed_size,
+                 (uint64_t)(4 + 2 + 1 + 1 + 1 + 8) + metadata_block.size(), // PRZM + version + flags + comp_type + level + metadata_size_field + metadata_block
+                 metadata_block.size(),
+                 compressed_size,
+                 {} };
 
-                            log("Compression ratio: " + std::to_string((int)ratio) + "%", LOG_SUM);
+    } else {
+        FileSink out(archive_file);
+        out.write("PRZM", 4);
+        uint16_t version = ARCHIVE_VERSION;
+        out.write((char*)&version, 2);
+        uint8_t flags = 0;
+        out.write((char*)&flags, 1);
 
-        
+        log("Created archive file named '" + archive_file + "' using " + std::to_string(num_threads) + " threads.", LOG_INFO);
 
-                
+        std::atomic<int> total_files = 0;
+        std::atomic<uint64_t> total_uncompressed = 0;
+        std::atomic<uint64_t> total_compressed = 0;
+        std::atomic<uint64_t> total_header_size = 0;
+        std::atomic<uint64_t> total_file_data_size = 0;
+        std::atomic<uint64_t> total_metadata_size = 0;
 
-        
+        std::mutex out_mutex;
+        ArchiveCatalog entries;
+        std::mutex cout_mutex;
+        std::vector<long long> durations_ms;
+        ProgressReporter progress(manifest.size(), manifest_bytes(manifest), raw_output, use_basic_chars, &cout_mutex);
 
-                        }
+        std::vector<std::vector<ManifestEntry>> single_batches;
+        std::vector<std::vector<ManifestEntry>> groups;
+        plan_file_groups(manifest, comp_type, group_small_files, single_batches, groups);
 
-        
+        {
+            // Tasks are fed through a short queue and counted by one group, so
+            // queued work stays small however many files there are.
+            TaskGroup tasks;
+            ThreadPool pool(num_threads, num_threads * QUEUED_TASKS_PER_THREAD);
+
+            for (const auto& group : groups) {
+                if (tasks.failed()) break;
+                pool.submit(tasks, [&] {
+                    write_file_group(group, paths, use_full_path, comp_type, level, hash_type, ignore_errors, nullptr,
+                                     out, out_mutex, entries, cout_mutex, progress, total_files, total_uncompressed, total_compressed,
+                                     total_header_size, total_file_data_size, total_metadata_size);
+                });
+            }
 
-                
+            for (const auto& batch : single_batches) {
+                if (tasks.failed()) break;
+                pool.submit(tasks, [&] {
+                    write_single_files(batch, paths, use_full_path, comp_type, level, hash_type, ignore_errors, nullptr,
+                                       out, out_mutex, entries, cout_mutex, progress, total_files, total_uncompressed, total_compressed,
+                                       total_header_size, total_file_data_size, total_metadata_size);
+                });
+            }
 
-        
+            tasks.wait();
 
-                        
+            durations_ms = pool.get_thread_durations();
+        }
 
-        
+        progress.stop();
+        if (total_files > 0 && !raw_output) std::cout << std::endl;
 
-                
+        write_archive_index(out, entries);
+        out.flush();
 
-        
+        log("Successfully created archive '" + archive_file + "'", LOG_SUCCESS);
+        log("Items added: " + std::to_string(total_files.load()) + " files", LOG_SUM);
+        log("Total uncompressed data: " + format_size(total_uncompressed.load()), LOG_SUM);
+        log("Total compressed data: " + format_size(total_compressed.load()), LOG_SUM);
+        if (total_uncompressed > 0) {
+            double ratio = 100.0 * (1.0 - (double)total_compressed.load() / total_uncompressed.load());
+            log("Compression ratio: " + std::to_string((int)ratio) + "%", LOG_SUM);
+        }
 
         return {total_files.load(), total_uncompressed.load(), total_compressed.load(), total_header_size.load(), total_metadata_size.load(), total_file_data_size.load(), durations_ms};
+    }
+}
 
+ArchiveCreationResult create_archive_from_stream(std::istream& input, std::ostream& out, const std::string& entry_name,
+                                                 CompressionType comp_type, int level, HashType hash_type, int num_threads) {
+    const size_t READ_CHUNK = 4 * 1024 * 1024;
+
+    // Same layout as a streamed solid archive: the entry record follows the
+    // frames, so nothing needs to be known before the input ends.
+    out.write("PRZM", 4);
+    uint16_t version = ARCHIVE_VERSION;
+    out.write((char*)&version, 2);
+    uint8_t flags = SOLID_ARCHIVE_FLAG | SOLID_STREAM_FLAG;
+    out.write((char*)&flags, 1);
+    out.write((char*)&comp_type, 1);
+    out.write((char*)&level, 1);
+
+    size_t frames = solid_frames_in_flight(num_threads, READ_CHUNK);
+    MemoryReservation reservation(READ_CHUNK + frames * 2 * (uint64_t)SOLID_FRAME_SIZE);
+    ThreadPool pool(std::max(1, num_threads));
+    SolidFrameWriter writer(out, comp_type, level, pool, frames);
+    prism::hashing::StreamHasher hasher(hash_type);
+    std::vector<char> chunk(READ_CHUNK);
+    uint64_t file_size = 0;
+    while (input) {
+        StageTimer read_timer(Stage::READ);
+        input.read(chunk.data(), chunk.size());
+        size_t got = static_cast<size_t>(input.gcount());
+        read_timer.stop(got);
+        if (got == 0) break;
+        {
+            StageTimer hash_timer(Stage::HASH);
+            hasher.update(chunk.data(), got);
+            hash_timer.stop(got);
+        }
+        writer.write(chunk.data(), got);
+        file_size += got;
+    }
+    if (input.bad()) {
+        throw std::runtime_error("Error reading input stream for '" + entry_name + "'");
+    }
+    uint64_t framed_size = writer.finish();
+
+    FileMetadata props = buffer_properties();
+    std::vector<char> file_metadata = create_solid_file_metadata(entry_name, hash_type, hasher.finish(), file_size,
+                                                                 props.creation_time, props.modification_time,
+                                                                 props.permissions, props.uid, props.gid);
+    uint64_t metadata_size;
+    std::vector<char> metadata_block = encode_metadata_block(file_metadata, comp_type, level, metadata_size);
+    {
+        StageTimer write_timer(Stage::WRITE);
+        out.write((char*)&metadata_size, 8);
+        out.write(metadata_block.data(), metadata_block.size());
+        out.flush();
+        write_timer.stop(8 + metadata_block.size());
+    }
+    if (!out) {
+        throw std::runtime_error("Failed writing archive stream");
     }
 
+    log("Successfully stored the input stream as '" + entry_name + "'", LOG_SUCCESS);
+    log("Total uncompressed data: " + format_size(file_size), LOG_SUM);
+    log("Total compressed data: " + format_size(framed_size), LOG_SUM);
+
+    return { 1, file_size, framed_size,
+             (uint64_t)(4 + 2 + 1 + 1 + 1 + 8) + metadata_block.size(), // PRZM + version + flags + comp_type + level + metadata_size_field + metadata_block
+             metadata_block.size(),
+             framed_size,
+             pool.get_thread_durations() };
 }
 
 ArchiveCreationResult append_to_archive(const std::string& archive_file, const std::vector<std::string>& paths,
                       CompressionType comp_type, int level, HashType hash_type, 
-                      bool ignore_errors, const std::vector<std::string>& exclude_patterns, bool use_full_path, bool auto_yes, int num_threads, bool raw_output, bool use_basic_chars, bool solid_mode) {
+                      bool ignore_errors, const std::vector<std::string>& exclude_patterns, bool use_full_path, bool auto_yes, int num_threads, bool raw_output, bool use_basic_chars, bool solid_mode, bool group_small_files) {
     if (!file_exists(archive_file)) {
         throw std::runtime_error("Archive file not found: " + archive_file);
     }
-    
-    uint64_t estimated_size = estimate_archive_size(archive_file, paths, comp_type, ignore_errors, exclude_patterns, use_full_path);
-    fs::path p = archive_file;
-    fs::path parent = p.parent_path();
-    std::string path_for_space_check = parent.empty() ? "." : parent.string();
-    uint64_t free_space = get_free_disk_space(path_for_space_check);
-
-    if (estimated_size > free_space) {
-        std::string message = "Warning: Estimated archive size (" + format_size(estimated_size) + ") exceeds available disk space (" + format_size(free_space) + ") on target drive. Continue anyway?";
-        if (!confirm_action(message, auto_yes)) {
-            throw std::runtime_error("Archive append cancelled by user.");
-        }
+    // Readers expect only solid blocks after a solid archive's first block.
+    if (!solid_mode && is_solid_archive(archive_file)) {
+        throw std::runtime_error("Cannot append non-solid entries to a solid archive (use --solid): " + archive_file);
     }
+    
+    ExcludeMatcher excludes(exclude_patterns);
+    StageTimer walk_timer(Stage::WALK);
+    std::vector<ManifestEntry> manifest = collect_input_files(paths, excludes, ignore_errors);
+    walk_timer.stop(0);
 
-    std::vector<std::string> all_files;
-    for (const auto& path : paths) {
-        if (!file_exists(path)) {
-            if (ignore_errors) {
-                log("Warning: Path not found: '" + path + "' (ignored)", LOG_WARN);
-                continue;
-            } else {
-                throw std::runtime_error("Path not found: " + path);
-            }
-        }
-        if (is_directory(path)) {
-            list_files_recursive(path, all_files, exclude_patterns);
-        } else {
-            if (!should_exclude(path, exclude_patterns)) {
-                all_files.push_back(path);
-            }
-        }
-    }
+    check_free_space(archive_file, manifest, comp_type, level, hash_type, num_threads, auto_yes, "Archive append cancelled by user.");
 
     if (solid_mode) {
         if (is_solid_archive(archive_file)) {
             log("Warning: This will add another block to the end of the archive, this will make it no longer a solid block archive", LOG_WARN);
         }
 
-        std::vector<FileMetadata> existing_items = read_archive_metadata(archive_file);
-        std::set<std::string> existing_paths;
-        for (const auto& item : existing_items) {
-            existing_paths.insert(item.path);
+        ArchiveCatalog existing_items = read_archive_catalog(archive_file);
+        std::set<std::string_view> existing_paths;
+        for (size_t i = 0; i < existing_items.size(); ++i) {
+            existing_paths.insert(existing_items[i].path());
         }
 
         log("Appending to archive '" + archive_file + "' in solid mode.", LOG_INFO);
 
-        std::vector<char> all_uncompressed_data;
-        std::vector<char> metadata_block;
-        uint64_t total_uncompressed_size = 0;
-        int files_added = 0;
-        auto start_time = std::chrono::steady_clock::now();
-
-        for (const auto& file_path : all_files) {
-            std::string archive_path = get_archive_path(file_path, paths, use_full_path);
-
+        std::vector<ManifestEntry> new_files;
+        for (auto& entry : manifest) {
+            std::string archive_path = get_archive_path(entry.path, paths, use_full_path);
             if (existing_paths.count(archive_path)) {
                 if (ignore_errors) {
                     log("Warning: File already exists in archive: '" + archive_path + "' (ignored)", LOG_WARN);
@@ -1323,87 +930,84 @@ ArchiveCreationResult append_to_archive(const std::string& archive_file, const s
                     throw std::runtime_error("File already exists in archive: " + archive_path);
                 }
             }
-
-            std::ifstream file(file_path, std::ios::binary);
-            if (!file) {
-                if (ignore_errors) {
-                    log("Warning: Cannot open file: '" + file_path + "' (ignored)", LOG_WARN);
-                    continue;
-                } else {
-                    throw std::runtime_error("Cannot open file: " + file_path);
-                }
-            }
-            std::vector<char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
-            file.close();
-
-            all_uncompressed_data.insert(all_uncompressed_data.end(), data.begin(), data.end());
-            total_uncompressed_size += data.size();
-
-                                std::string hash = prism::hashing::calculate_hash(file_path, hash_type);            
-            FileMetadata file_props;
-            if (!get_file_properties(file_path, file_props)) {
-                if (ignore_errors) {
-                    log("Warning: Failed to get properties for file: '" + file_path + "' (ignored)", LOG_WARN);
-                    continue;
-                } else {
-                    throw std::runtime_error("Failed to get properties for file: " + file_path);
-                }
-            }
-
-            std::vector<char> file_metadata = create_solid_file_metadata(archive_path, hash_type, hash, data.size(),
-                                                                         file_props.creation_time, file_props.modification_time,
-                                                                         file_props.permissions, file_props.uid, file_props.gid);
-            metadata_block.insert(metadata_block.end(), file_metadata.begin(), file_metadata.end());
-            files_added++;
-            show_progress_bar(files_added, all_files.size(), archive_path, data.size(), 0, start_time, raw_output, use_basic_chars);
+            new_files.push_back(std::move(entry));
         }
 
-        if (files_added > 0 && !raw_output) std::cout << std::endl;
-
-        if (files_added == 0) {
+        if (new_files.empty()) {
             log("No new files to append.", LOG_INFO);
-            return {0, 0, 0, {}};
+            return {};
         }
 
-        log("Compressing solid block for appending...", LOG_INFO);
-        std::vector<char> compressed_data = compression::compress_data(all_uncompressed_data, comp_type, level);
-        log("Compression complete.", LOG_VERBOSE);
-
+        // New entries go after the last block; the index is written again
+        // from the existing and new entries afterwards.
+        remove_archive_index(archive_file);
+        update_archive_version(archive_file);
         std::ofstream out(archive_file, std::ios::binary | std::ios::app);
         if (!out) {
             throw std::runtime_error("Cannot open archive file for appending: " + archive_file);
         }
+        out.seekp(0, std::ios::end);
 
-        out.write(SOLID_BLOCK_MAGIC, 4);
+        out.write(SOLID_STREAM_MAGIC, 4);
         out.write((char*)&comp_type, 1);
         out.write((char*)&level, 1);
-        uint64_t metadata_size = metadata_block.size();
-        out.write((char*)&metadata_size, 8);
-        out.write(metadata_block.data(), metadata_block.size());
-        out.write(compressed_data.data(), compressed_data.size());
+        uint64_t data_start = out.tellp();
+
+        ProgressReporter progress(new_files.size(), manifest_bytes(new_files), raw_output, use_basic_chars);
+        SolidStreamResult stream = write_solid_stream(out, new_files, paths, use_full_path, comp_type, level, hash_type,
+                                                      ignore_errors, num_threads, progress);
+        progress.stop();
+        if (stream.files_added > 0 && !raw_output) std::cout << std::endl;
+
+        uint64_t metadata_size;
+        std::vector<char> metadata_block = encode_metadata_block(stream.metadata_block, comp_type, level, metadata_size);
+        {
+            StageTimer write_timer(Stage::WRITE);
+            out.write((char*)&metadata_size, 8);
+            out.write(metadata_block.data(), metadata_block.size());
+            write_timer.stop(8 + metadata_block.size());
+        }
+        out.close();
+        if (!out) {
+            throw std::runtime_error("Failed writing archive file: " + archive_file);
+        }
+
+        // The path views point into existing_items, which grows below.
+        existing_paths.clear();
+        add_solid_stream_entries(existing_items, stream, comp_type, level, data_start);
+        append_archive_index(archive_file, existing_items);
+
+        int files_added = stream.files_added;
+        uint64_t total_uncompressed_size = stream.uncompressed_size;
+        uint64_t compressed_size = stream.framed_size;
 
         log("Successfully appended solid block to archive '" + archive_file + "'", LOG_SUCCESS);
         log("Items added: " + std::to_string(files_added) + " files", LOG_SUM);
         log("Total uncompressed data: " + format_size(total_uncompressed_size), LOG_SUM);
-        log("Total compressed data: " + format_size(compressed_data.size()), LOG_SUM);
+        log("Total compressed data: " + format_size(compressed_size), LOG_SUM);
 
-        return {(long)files_added, total_uncompressed_size, compressed_data.size(),
-                (uint64_t)(4 + 1 + 1 + 8) + metadata_block.size(), // SOLID_BLOCK_MAGIC + comp_type + level + metadata_size_field + metadata_block
+        return {(long)files_added, total_uncompressed_size, compressed_size,
+                (uint64_t)(4 + 1 + 1 + 8) + metadata_block.size(), // SOLID_STREAM_MAGIC + comp_type + level + metadata_size_field + metadata_block
                 metadata_block.size(),
-                compressed_data.size(),
+                compressed_size,
                 {}};
 
     } else {
-        std::vector<FileMetadata> existing_items = read_archive_metadata(archive_file);
-        std::set<std::string> existing_paths;
-        for (const auto& item : existing_items) {
-            existing_paths.insert(item.path);
+        ArchiveCatalog existing_items = read_archive_catalog(archive_file);
+        std::set<std::string_view> existing_paths;
+        for (size_t i = 0; i < existing_items.size(); ++i) {
+            // Entries cannot follow an appended solid block.
+            if (existing_items[i].is_framed()) {
+                throw std::runtime_error("Cannot append non-solid entries after appended solid blocks (use --solid): " + archive_file);
+            }
+            existing_paths.insert(existing_items[i].path());
         }
         
-        std::ofstream out(archive_file, std::ios::binary | std::ios::app);
-        if (!out) {
-            throw std::runtime_error("Cannot open archive file for appending: " + archive_file);
-        }
+        // New entries go after the last block; the index is written again
+        // from the existing and new entries afterwards.
+        remove_archive_index(archive_file);
+        update_archive_version(archive_file);
+        FileSink out(archive_file, true);
         
         log("Appending to existing archive: '" + archive_file + "' using " + std::to_string(num_threads) + " threads.", LOG_INFO);
         
@@ -1413,105 +1017,54 @@ ArchiveCreationResult append_to_archive(const std::string& archive_file, const s
         std::atomic<uint64_t> total_header_size = 0;
         std::atomic<uint64_t> total_file_data_size = 0;
         std::atomic<uint64_t> total_metadata_size = 0;
-        auto start_time = std::chrono::steady_clock::now();
-        std::atomic<int> progress_counter = 0;
 
         std::mutex out_mutex;
+        ArchiveCatalog entries;
         std::mutex cout_mutex;
         std::vector<long long> durations_ms;
+        ProgressReporter progress(manifest.size(), manifest_bytes(manifest), raw_output, use_basic_chars, &cout_mutex);
+
+        std::vector<std::vector<ManifestEntry>> single_batches;
+        std::vector<std::vector<ManifestEntry>> groups;
+        plan_file_groups(manifest, comp_type, group_small_files, single_batches, groups);
 
         {
-            ThreadPool pool(num_threads);
-            std::vector<std::future<void>> results;
-
-            for (const auto& file_path : all_files) {
-                results.emplace_back(pool.enqueue([&, file_path, &total_metadata_size] {
-                    std::string archive_path = get_archive_path(file_path, paths, use_full_path);
-
-                    if (existing_paths.count(archive_path)) {
-                        if (ignore_errors) {
-                            std::lock_guard<std::mutex> lock(cout_mutex);
-                            log("Warning: File already exists in archive: '" + archive_path + "' (ignored)", LOG_WARN);
-                            return;
-                        } else {
-                            throw std::runtime_error("File already exists in archive: " + archive_path);
-                        }
-                    }
-                    
-                    CompressionType actual_comp = should_compress(file_path, comp_type) ? comp_type : CompressionType::NONE;
-                    
-                    std::ifstream file(file_path, std::ios::binary);
-                    if (!file) {
-                        if (ignore_errors) {
-                            std::lock_guard<std::mutex> lock(cout_mutex);
-                            log("Warning: Cannot open file: '" + file_path + "' (ignored)", LOG_WARN);
-                            return;
-                        } else {
-                            throw std::runtime_error("Cannot open file: " + file_path);
-                        }
-                    }
-                    
-                    std::vector<char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
-                    file.close();
-                    
-                    std::string hash = prism::hashing::calculate_hash(file_path, hash_type);
-                    std::vector<char> compressed = compression::compress_data(data, actual_comp, level);
-                    
-                    
-                    FileMetadata file_props;
-                    if (!get_file_properties(file_path, file_props)) {
-                        if (ignore_errors) {
-                            std::lock_guard<std::mutex> lock(cout_mutex);
-                            log("Warning: Failed to get properties for file: '" + file_path + "' (ignored)", LOG_WARN);
-                            return;
-                        } else {
-                            throw std::runtime_error("Failed to get properties for file: " + file_path);
-                        }
-                    }
+            TaskGroup tasks;
+            ThreadPool pool(num_threads, num_threads * QUEUED_TASKS_PER_THREAD);
+
+            for (const auto& group : groups) {
+                if (tasks.failed()) break;
+                pool.submit(tasks, [&] {
+                    write_file_group(group, paths, use_full_path, comp_type, level, hash_type, ignore_errors, &existing_paths,
+                                     out, out_mutex, entries, cout_mutex, progress, total_files, total_uncompressed, total_compressed,
+                                     total_header_size, total_file_data_size, total_metadata_size);
+                });
+            }
 
-                    std::vector<char> header = create_archive_header(archive_path, actual_comp, level, 
-                                                               hash_type, hash, data.size(), compressed.size(),
-                                                               file_props.creation_time, file_props.modification_time,
-                                                               file_props.permissions, file_props.uid, file_props.gid);
-                    
-                    {
-                        std::lock_guard<std::mutex> lock(out_mutex);
-                        out.write(header.data(), header.size());
-                        out.write(compressed.data(), compressed.size());
-                    }
-                    
-                    total_files++;
-                    total_uncompressed += data.size();
-                    total_compressed += compressed.size();
-                    total_header_size += header.size();
-                    total_file_data_size += compressed.size();
-                    total_metadata_size.fetch_add(sizeof(uint32_t) + archive_path.size() + // path_len + archive_path
-                                           sizeof(uint8_t) + // compression_type
-                                           sizeof(uint8_t) + // level
-                                           sizeof(uint8_t) + // hash_type
-                                           sizeof(uint16_t) + hash.size() + // hash_len + file_hash
-                                           sizeof(uint64_t) + // file_size
-                                           sizeof(uint64_t) + // compressed_size
-                                           sizeof(uint64_t) + // creation_time
-                                           sizeof(uint64_t) + // modification_time
-                                           sizeof(uint32_t) + // permissions
-                                           sizeof(uint32_t) + // uid
-                                           sizeof(uint32_t)); // gid
-                    
-                    {
-                        std::lock_guard<std::mutex> lock(cout_mutex);
-                        show_progress_bar(++progress_counter, all_files.size(), archive_path, data.size(), compressed.size(), start_time, raw_output, use_basic_chars);
-                    }
-                }));
+            for (const auto& batch : single_batches) {
+                if (tasks.failed()) break;
+                pool.submit(tasks, [&] {
+                    write_single_files(batch, paths, use_full_path, comp_type, level, hash_type, ignore_errors, &existing_paths,
+                                       out, out_mutex, entries, cout_mutex, progress, total_files, total_uncompressed, total_compressed,
+                                       total_header_size, total_file_data_size, total_metadata_size);
+                });
             }
 
-            for(auto && result : results)
-                result.get();
+            tasks.wait();
             
             durations_ms = pool.get_thread_durations();
         }
-        
+
+        progress.stop();
         if (total_files > 0 && !raw_output) std::cout << std::endl;
+
+        // The path views point into existing_items, which grows below.
+        existing_paths.clear();
+        for (size_t i = 0; i < entries.size(); ++i) {
+            existing_items.add(entries[i].to_metadata());
+        }
+        write_archive_index(out, existing_items);
+        out.flush();
         
         log("Successfully appended to archive '" + archive_file + "'", LOG_SUCCESS);
         log("Items added: " + std::to_string(total_files.load()) + " files", LOG_SUM);
@@ -1522,69 +1075,233 @@ ArchiveCreationResult append_to_archive(const std::string& archive_file, const s
     }
 }
 
-uint64_t estimate_archive_size(const std::string& archive_file, const std::vector<std::string>& paths,
-                             CompressionType comp_type,
-                             bool ignore_errors, const std::vector<std::string>& exclude_patterns, bool use_full_path) {
-    uint64_t total_uncompressed_size = 0;
-    double compression_ratio = 1.0;
-
-    switch (comp_type) {
-        case CompressionType::NONE:
-            compression_ratio = 1.0;
-            break;
-        case CompressionType::ZLIB:
-        case CompressionType::BZIP2:
-        case CompressionType::LZMA:
-        case CompressionType::GZIP:
-        case CompressionType::LZ4:
-        case CompressionType::ZSTD:
-        case CompressionType::BROTLI:
-            compression_ratio = 0.5;
-            break;
-        default:
-            compression_ratio = 1.0;
-            break;
+ArchiveWriter::ArchiveWriter(const std::string& archive_file, CompressionType comp_type, int level, HashType hash_type, int num_threads)
+    : archive_file(archive_file), comp_type(comp_type), level(level), hash_type(hash_type),
+      pool(num_threads, num_threads * QUEUED_TASKS_PER_THREAD) {
+    if (!file_exists(archive_file)) {
+        sink = std::make_shared<FileSink>(archive_file);
+        write_archive_start();
+        log("Created archive file named '" + archive_file + "'.", LOG_VERBOSE);
+        return;
+    }
+
+    if (is_solid_archive(archive_file)) {
+        throw std::runtime_error("Cannot keep a solid archive open for appending: " + archive_file);
+    }
+    entries = read_archive_catalog(archive_file);
+    for (size_t i = 0; i < entries.size(); ++i) {
+        // Entries cannot follow an appended solid block.
+        if (entries[i].is_framed()) {
+            throw std::runtime_error("Cannot keep an archive with appended solid blocks open for appending: " + archive_file);
+        }
+        paths.emplace(entries[i].path());
+    }
+    remove_archive_index(archive_file);
+    update_archive_version(archive_file);
+    sink = std::make_shared<FileSink>(archive_file, true);
+}
+
+ArchiveWriter::ArchiveWriter(std::shared_ptr<ArchiveSink> sink, CompressionType comp_type, int level, HashType hash_type, int num_threads)
+    : comp_type(comp_type), level(level), hash_type(hash_type), sink(std::move(sink)),
+      pool(num_threads, num_threads * QUEUED_TASKS_PER_THREAD) {
+    if (this->sink->position() != 0) {
+        throw std::runtime_error("A new archive needs an empty sink.");
     }
+    write_archive_start();
+}
 
-    for (const auto& path : paths) {
-        if (!file_exists(path)) {
-            if (ignore_errors) {
-                log("Warning: Path not found for size estimation: '" + path + "' (ignored)", LOG_WARN);
-                continue;
-            } else {
-                throw std::runtime_error("Path not found for size estimation: " + path);
+void ArchiveWriter::write_archive_start() {
+    std::vector<char> start = {'P', 'R', 'Z', 'M'};
+    uint16_t version = ARCHIVE_VERSION;
+    start.insert(start.end(), (char*)&version, (char*)&version + 2);
+    start.push_back(0); // flags: a non-solid archive
+    sink->write(start.data(), start.size());
+}
+
+ArchiveWriter::~ArchiveWriter() {
+    try {
+        close();
+    } catch (const std::exception& e) {
+        log("Error: Failed to close archive: " + std::string(e.what()), LOG_ERROR);
+    }
+}
+
+void ArchiveWriter::reserve_path(const std::string& archive_path) {
+    if (closed) {
+        throw std::runtime_error("Archive writer is closed.");
+    }
+    std::lock_guard<std::mutex> lock(out_mutex);
+    if (!paths.insert(archive_path).second) {
+        throw std::runtime_error("File already exists in archive: " + archive_path);
+    }
+}
+
+void ArchiveWriter::add_file(const std::string& file_path, const std::string& archive_path) {
+    reserve_path(archive_path);
+    pool.submit(tasks, [this, file_path, archive_path] {
+        // A file that cannot be read gives its path back, so it can be added again.
+        auto fail = [&](const std::string& message) {
+            {
+                std::lock_guard<std::mutex> lock(out_mutex);
+                paths.erase(archive_path);
             }
+            throw std::runtime_error(message);
+        };
+
+        std::error_code ec;
+        uint64_t size_on_disk = fs::file_size(file_path, ec);
+        MemoryReservation reservation(ec ? 0 : 2 * size_on_disk);
+        StageTimer read_timer(Stage::READ);
+        std::vector<char> data;
+        std::vector<FileExtent> extents;
+        uint64_t file_size = 0;
+        bool sparse = false;
+        if (!read_input_file(file_path, data, extents, file_size, sparse)) {
+            fail("Cannot open file: " + file_path);
         }
+        read_timer.stop(data.size());
 
-        if (should_exclude(path, exclude_patterns)) {
-            continue;
+        FileMetadata props{};
+        if (!get_file_properties(file_path, props)) {
+            fail("Failed to get properties for file: " + file_path);
         }
+        CompressionType entry_comp = should_compress(file_path, comp_type) ? comp_type : CompressionType::NONE;
+        write_entry(archive_path, data, extents, file_size, sparse, entry_comp, props);
+    });
+}
 
-        std::vector<std::string> files_to_process;
-        if (is_directory(path)) {
-            list_files_recursive(path, files_to_process, exclude_patterns);
+void ArchiveWriter::add_buffer(const std::string& archive_path, std::vector<char> data) {
+    reserve_path(archive_path);
+    FileMetadata props = buffer_properties();
+    pool.submit(tasks, [this, archive_path, props, data = std::move(data)] {
+        // The buffer is already held; only its compressed copy is new.
+        MemoryReservation reservation(data.size());
+        write_entry(archive_path, data, {}, data.size(), false, comp_type, props);
+    });
+}
+
+void ArchiveWriter::write_entry(const std::string& archive_path, const std::vector<char>& data, const std::vector<FileExtent>& extents,
+                                uint64_t file_size, bool sparse, CompressionType entry_comp, const FileMetadata& props) {
+    StageTimer hash_timer(Stage::HASH);
+    std::string hash = sparse ? hash_sparse_contents(extents, data.data(), file_size, hash_type)
+                             : prism::hashing::calculate_hash_from_data(data, hash_type);
+    hash_timer.stop(file_size);
+
+    StageTimer compress_timer(Stage::COMPRESS);
+    std::vector<char> compressed = compression::compress_data(data, entry_comp, level);
+    compress_timer.stop(data.size());
+    if (sparse) {
+        compressed = encode_sparse_payload(extents, compressed);
+    }
+
+    std::vector<char> header = create_archive_header(archive_path, entry_comp, level, hash_type, hash, file_size, compressed.size(),
+                                                     props.creation_time, props.modification_time,
+                                                     props.permissions, props.uid, props.gid, sparse);
+
+    FileMetadata item = props;
+    item.path = archive_path;
+    item.compression_type = entry_comp;
+    item.level = level;
+    item.hash_type = hash_type;
+    item.file_hash = hash;
+    item.file_size = file_size;
+    item.compressed_size = compressed.size();
+    item.is_solid = false;
+    item.is_sparse = sparse;
+    item.is_framed = false;
+
+    StageTimer write_timer(Stage::WRITE);
+    std::lock_guard<std::mutex> lock(out_mutex);
+    item.header_start_offset = sink->position();
+    item.data_start_offset = item.header_start_offset + header.size();
+    sink->write(header.data(), header.size());
+    sink->write(compressed.data(), compressed.size());
+    entries.add(item);
+    write_timer.stop(header.size() + compressed.size());
+}
+
+void ArchiveWriter::flush() {
+    // The sink is flushed before the first failure is rethrown.
+    std::exception_ptr failure;
+    try {
+        tasks.wait();
+    } catch (...) {
+        failure = std::current_exception();
+    }
+
+    std::lock_guard<std::mutex> lock(out_mutex);
+    sink->flush();
+    if (failure) std::rethrow_exception(failure);
+}
+
+void ArchiveWriter::close() {
+    if (closed) return;
+    closed = true;
+    // The entries that did get written are indexed before a task's failure
+    // is rethrown; appending removed the old index.
+    std::exception_ptr failure;
+    try {
+        flush();
+    } catch (...) {
+        failure = std::current_exception();
+    }
+    write_archive_index(*sink, entries);
+    sink->flush();
+    sink.reset();
+    if (failure) std::rethrow_exception(failure);
+}
+
+uint64_t estimate_archive_size(const std::vector<ManifestEntry>& manifest, CompressionType comp_type, int level, HashType hash_type, int num_threads) {
+    uint64_t compressible_size = 0;
+    uint64_t stored_size = 0;
+    uint64_t header_overhead = 7;
+    uint64_t hash_len = prism::hashing::calculate_hash_from_data({}, hash_type).size();
+    std::vector<ManifestEntry> compressible;
+    for (const auto& entry : manifest) {
+        // Per-entry header: 53 bytes of fixed fields plus the path and hex hash.
+        header_overhead += 53 + entry.path.size() + hash_len;
+        if (should_compress(entry.path, comp_type)) {
+            compressible_size += entry.size;
+            compressible.push_back(entry);
         } else {
-            files_to_process.push_back(path);
+            stored_size += entry.size;
         }
+    }
 
-        for (const auto& file_path : files_to_process) {
-            std::error_code ec;
-            uint64_t size = fs::file_size(file_path, ec);
-            if (!ec) {
-                total_uncompressed_size += size;
-            } else {
-                if (ignore_errors) {
-                    log("Warning: Could not get size of file: '" + file_path + "' (ignored)", LOG_WARN);
-                } else {
-                    throw std::runtime_error("Could not get size of file: " + file_path);
-                }
-            }
+    if (compressible_size == 0) {
+        return stored_size + header_overhead;
+    }
+
+    // Trial-compress a small size-weighted sample with the real codec and level.
+    std::vector<SampleChunk> sample = select_sample(compressible, 4 * 1024 * 1024, 128 * 1024);
+    load_sample(sample);
+    std::vector<double> weighted_out(sample.size(), 0.0);
+    {
+        ThreadPool pool(std::max(1, num_threads));
+        std::vector<std::future<void>> results;
+        for (size_t i = 0; i < sample.size(); ++i) {
+            results.emplace_back(pool.enqueue([&, i] {
+                const SampleChunk& chunk = sample[i];
+                std::vector<char> compressed = compression::compress_data(chunk.data, comp_type, level);
+                weighted_out[i] = chunk.weight * (double)compressed.size() / chunk.data.size();
+            }));
+        }
+        for (auto&& result : results) {
+            result.get();
         }
     }
 
-    uint64_t metadata_overhead = std::max((uint64_t)1024, total_uncompressed_size / 100);
+    double sample_weight = 0.0;
+    double sample_out = 0.0;
+    for (size_t i = 0; i < sample.size(); ++i) {
+        sample_weight += sample[i].weight;
+        sample_out += weighted_out[i];
+    }
+    double ratio = sample_weight > 0.0 ? sample_out / sample_weight : 1.0;
+    PRISM_LOG(LOG_VERBOSE, "Estimated compressed/uncompressed ratio " + std::to_string(ratio) + " from " +
+                           std::to_string(sample.size()) + " sampled chunks");
 
-    return (uint64_t)(total_uncompressed_size * compression_ratio) + metadata_overhead;
+    return (uint64_t)(compressible_size * ratio) + stored_size + header_overhead;
 }
 
 } // namespace core
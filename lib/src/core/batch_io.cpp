@@ -0,0 +1,237 @@
+#include <prism/core/batch_io.h>
+#include <prism/core/file_utils.h>
+#include <prism/core/logging.h>
+#include <algorithm>
+#include <cerrno>
+
+#ifdef PRISM_HAVE_IO_URING
+#include <liburing.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace prism {
+namespace core {
+
+namespace {
+
+void read_file_fallback(FileReadRequest& request) {
+    errno = 0;
+    if (!read_file_contents(request.path, request.data)) {
+        request.error = errno ? errno : EIO;
+    }
+}
+
+void write_file_fallback(FileWriteRequest& request) {
+    errno = 0;
+    if (!write_file_contents(request.path, request.data, request.size)) {
+        request.error = errno ? errno : EIO;
+    }
+}
+
+#ifdef PRISM_HAVE_IO_URING
+
+const unsigned QUEUE_DEPTH = 64;
+const uint64_t GROW_STEP = 64 * 1024;
+
+// One ring per thread, created on first use. If the kernel refuses
+// io_uring (old kernel, seccomp) the thread falls back for good.
+class Ring {
+public:
+    Ring() {
+        ok = io_uring_queue_init(QUEUE_DEPTH, &ring, 0) == 0;
+        if (!ok) {
+            PRISM_LOG(LOG_DEBUG, "Debug: io_uring unavailable, using blocking file I/O");
+        }
+    }
+    ~Ring() {
+        if (ok) io_uring_queue_exit(&ring);
+    }
+
+    bool ok;
+    io_uring ring;
+};
+
+Ring& thread_ring() {
+    thread_local Ring ring;
+    return ring;
+}
+
+// Submits what is queued and collects exactly `expected` completions as (user_data, res).
+std::vector<std::pair<uint64_t, int>> submit_and_reap(io_uring& ring, size_t expected) {
+    std::vector<std::pair<uint64_t, int>> completions;
+    completions.reserve(expected);
+    io_uring_submit(&ring);
+    while (completions.size() < expected) {
+        io_uring_cqe* cqe = nullptr;
+        int ret = io_uring_wait_cqe(&ring, &cqe);
+        if (ret == -EINTR) continue;
+        if (ret < 0) break;
+        completions.emplace_back(io_uring_cqe_get_data64(cqe), cqe->res);
+        io_uring_cqe_seen(&ring, cqe);
+    }
+    return completions;
+}
+
+// Opens every path in [begin, end); fds[i] is -1 on failure with errors[i] set.
+template <class Request>
+void open_batch(io_uring& ring, std::vector<Request>& requests, size_t begin, size_t end, int flags, std::vector<int>& fds) {
+    for (size_t i = begin; i < end; ++i) {
+        io_uring_sqe* sqe = io_uring_get_sqe(&ring);
+        io_uring_prep_openat(sqe, AT_FDCWD, requests[i].path.c_str(), flags | O_CLOEXEC, 0644);
+        io_uring_sqe_set_data64(sqe, i);
+    }
+    for (const auto& c : submit_and_reap(ring, end - begin)) {
+        if (c.second < 0) {
+            requests[c.first].error = -c.second;
+        } else {
+            fds[c.first - begin] = c.second;
+        }
+    }
+}
+
+void close_batch(io_uring& ring, const std::vector<int>& fds) {
+    size_t queued = 0;
+    for (size_t i = 0; i < fds.size(); ++i) {
+        if (fds[i] < 0) continue;
+        io_uring_sqe* sqe = io_uring_get_sqe(&ring);
+        io_uring_prep_close(sqe, fds[i]);
+        io_uring_sqe_set_data64(sqe, i);
+        queued++;
+    }
+    submit_and_reap(ring, queued);
+}
+
+void read_batch(io_uring& ring, std::vector<FileReadRequest>& requests, size_t begin, size_t end) {
+    std::vector<int> fds(end - begin, -1);
+    std::vector<uint64_t> offsets(end - begin, 0);
+    open_batch(ring, requests, begin, end, O_RDONLY, fds);
+
+    // Ask for one byte more than expected so a short read means EOF and files
+    // that grew since the walk are still read in full.
+    std::vector<size_t> active;
+    for (size_t i = begin; i < end; ++i) {
+        if (fds[i - begin] < 0) continue;
+        requests[i].data.resize(requests[i].size_hint + 1);
+        active.push_back(i);
+    }
+
+    while (!active.empty()) {
+        std::vector<unsigned> requested(end - begin, 0);
+        for (size_t i : active) {
+            FileReadRequest& request = requests[i];
+            uint64_t offset = offsets[i - begin];
+            if (offset == request.data.size()) {
+                request.data.resize(request.data.size() + GROW_STEP);
+            }
+            unsigned length = (unsigned)std::min<uint64_t>(request.data.size() - offset, 1u << 30);
+            requested[i - begin] = length;
+            io_uring_sqe* sqe = io_uring_get_sqe(&ring);
+            io_uring_prep_read(sqe, fds[i - begin], request.data.data() + offset, length, offset);
+            io_uring_sqe_set_data64(sqe, i);
+        }
+
+        std::vector<size_t> still_active;
+        for (const auto& c : submit_and_reap(ring, active.size())) {
+            size_t i = c.first;
+            FileReadRequest& request = requests[i];
+            if (c.second < 0) {
+                request.error = -c.second;
+                request.data.clear();
+                continue;
+            }
+            offsets[i - begin] += c.second;
+            if ((unsigned)c.second < requested[i - begin]) {
+                request.data.resize(offsets[i - begin]);
+            } else {
+                still_active.push_back(i);
+            }
+        }
+        active.swap(still_active);
+    }
+
+    close_batch(ring, fds);
+}
+
+void write_batch(io_uring& ring, std::vector<FileWriteRequest>& requests, size_t begin, size_t end) {
+    std::vector<int> fds(end - begin, -1);
+    std::vector<uint64_t> offsets(end - begin, 0);
+    open_batch(ring, requests, begin, end, O_WRONLY | O_CREAT | O_TRUNC, fds);
+
+    std::vector<size_t> active;
+    for (size_t i = begin; i < end; ++i) {
+        if (fds[i - begin] >= 0 && requests[i].size > 0) active.push_back(i);
+    }
+
+    while (!active.empty()) {
+        for (size_t i : active) {
+            const FileWriteRequest& request = requests[i];
+            uint64_t offset = offsets[i - begin];
+            unsigned length = (unsigned)std::min<uint64_t>(request.size - offset, 1u << 30);
+            io_uring_sqe* sqe = io_uring_get_sqe(&ring);
+            io_uring_prep_write(sqe, fds[i - begin], request.data + offset, length, offset);
+            io_uring_sqe_set_data64(sqe, i);
+        }
+
+        std::vector<size_t> still_active;
+        for (const auto& c : submit_and_reap(ring, active.size())) {
+            size_t i = c.first;
+            if (c.second <= 0) {
+                requests[i].error = c.second < 0 ? -c.second : EIO;
+                continue;
+            }
+            offsets[i - begin] += c.second;
+            if (offsets[i - begin] < requests[i].size) {
+                still_active.push_back(i);
+            }
+        }
+        active.swap(still_active);
+    }
+
+    close_batch(ring, fds);
+}
+
+#endif // PRISM_HAVE_IO_URING
+
+} // anonymous namespace
+
+bool batch_io_uses_io_uring() {
+#ifdef PRISM_HAVE_IO_URING
+    return thread_ring().ok;
+#else
+    return false;
+#endif
+}
+
+void read_files(std::vector<FileReadRequest>& requests) {
+#ifdef PRISM_HAVE_IO_URING
+    Ring& ring = thread_ring();
+    if (ring.ok) {
+        for (size_t begin = 0; begin < requests.size(); begin += QUEUE_DEPTH) {
+            read_batch(ring.ring, requests, begin, std::min<size_t>(begin + QUEUE_DEPTH, requests.size()));
+        }
+        return;
+    }
+#endif
+    for (auto& request : requests) {
+        read_file_fallback(request);
+    }
+}
+
+void write_files(std::vector<FileWriteRequest>& requests) {
+#ifdef PRISM_HAVE_IO_URING
+    Ring& ring = thread_ring();
+    if (ring.ok) {
+        for (size_t begin = 0; begin < requests.size(); begin += QUEUE_DEPTH) {
+            write_batch(ring.ring, requests, begin, std::min<size_t>(begin + QUEUE_DEPTH, requests.size()));
+        }
+        return;
+    }
+#endif
+    for (auto& request : requests) {
+        write_file_fallback(request);
+    }
+}
+
+} // namespace core
+} // namespace prism
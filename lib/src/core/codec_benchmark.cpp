@@ -0,0 +1,225 @@
+#include <prism/core/codec_benchmark.h>
+#include <prism/core/sampling.h>
+#include <prism/core/file_utils.h>
+#include <prism/core/logging.h>
+#include <prism/core/thread_pool.h>
+#include <prism/compression.h>
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <stdexcept>
+
+namespace fs = std::filesystem;
+
+namespace prism {
+namespace core {
+
+namespace {
+
+double seconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+double mbps(uint64_t bytes, double seconds) {
+    return seconds > 0.0 ? (double)bytes / (1024.0 * 1024.0) / seconds : 0.0;
+}
+
+CodecBenchmarkEntry run_entry(CompressionType codec, int level, const std::vector<SampleChunk>& sample,
+                              const std::vector<char>& solid_buffer, double solid_weight, double total_weight,
+                              uint64_t total_bytes, bool solid) {
+    CodecBenchmarkEntry entry{codec, level, total_bytes, 0, 0.0, 0.0, 0.0, false, ""};
+    double compress_s = 0.0;
+    double decompress_s = 0.0;
+    uint64_t timed_bytes = 0;
+    double weighted_out = 0.0;
+
+    // Small samples finish in microseconds; repeat passes so the timings are not noise.
+    const double min_seconds = 0.1;
+    const int max_passes = 10;
+
+    try {
+        for (int pass = 0; pass < max_passes && (pass == 0 || compress_s + decompress_s < min_seconds); ++pass) {
+            bool first_pass = pass == 0;
+            if (solid) {
+                for (const auto& chunk : sample) {
+                    if (!chunk.compressible && first_pass) weighted_out += chunk.weight;
+                }
+                if (!solid_buffer.empty()) {
+                    auto start = std::chrono::steady_clock::now();
+                    std::vector<char> compressed = compression::compress_data(solid_buffer, codec, level);
+                    compress_s += seconds_since(start);
+                    start = std::chrono::steady_clock::now();
+                    std::vector<char> restored = compression::decompress_data(compressed, codec, solid_buffer.size());
+                    decompress_s += seconds_since(start);
+                    if (restored != solid_buffer) {
+                        throw std::runtime_error("round trip mismatch");
+                    }
+                    timed_bytes += solid_buffer.size();
+                    if (first_pass) weighted_out += solid_weight * (double)compressed.size() / solid_buffer.size();
+                }
+            } else {
+                for (const auto& chunk : sample) {
+                    if (!chunk.compressible) {
+                        if (first_pass) weighted_out += chunk.weight;
+                        continue;
+                    }
+                    auto start = std::chrono::steady_clock::now();
+                    std::vector<char> compressed = compression::compress_data(chunk.data, codec, level);
+                    compress_s += seconds_since(start);
+                    start = std::chrono::steady_clock::now();
+                    std::vector<char> restored = compression::decompress_data(compressed, codec, chunk.data.size());
+                    decompress_s += seconds_since(start);
+                    if (restored != chunk.data) {
+                        throw std::runtime_error("round trip mismatch");
+                    }
+                    timed_bytes += chunk.data.size();
+                    if (first_pass) weighted_out += chunk.weight * (double)compressed.size() / chunk.data.size();
+                }
+            }
+        }
+    } catch (const std::exception& e) {
+        entry.error = e.what();
+        return entry;
+    }
+
+    entry.ratio = weighted_out > 0.0 ? total_weight / weighted_out : 1.0;
+    entry.compressed_bytes = (uint64_t)(total_bytes / entry.ratio);
+    entry.compress_mbps = mbps(timed_bytes, compress_s);
+    entry.decompress_mbps = mbps(timed_bytes, decompress_s);
+    return entry;
+}
+
+bool dominates(const CodecBenchmarkEntry& a, const CodecBenchmarkEntry& b) {
+    bool no_worse = a.ratio >= b.ratio && a.compress_mbps >= b.compress_mbps && a.decompress_mbps >= b.decompress_mbps;
+    bool better = a.ratio > b.ratio || a.compress_mbps > b.compress_mbps || a.decompress_mbps > b.decompress_mbps;
+    return no_worse && better;
+}
+
+} // anonymous namespace
+
+CodecBenchmarkResult benchmark_codecs(const std::vector<std::string>& paths, const CodecBenchmarkOptions& options) {
+    ExcludeMatcher excludes(options.exclude_patterns);
+    std::vector<std::string> files;
+    for (const auto& path : paths) {
+        if (!file_exists(path)) {
+            throw std::runtime_error("Path not found: " + path);
+        }
+        if (is_directory(path)) {
+            list_files_recursive(path, files, excludes);
+        } else if (!excludes.matches(path)) {
+            files.push_back(path);
+        }
+    }
+
+    std::vector<ManifestEntry> manifest;
+    manifest.reserve(files.size());
+    uint64_t total_bytes = 0;
+    for (const auto& file : files) {
+        std::error_code ec;
+        uint64_t size = fs::file_size(file, ec);
+        if (ec) continue;
+        manifest.push_back({file, size});
+        total_bytes += size;
+    }
+
+    CodecBenchmarkResult result{manifest.size(), total_bytes, 0, 0, 0, {}, -1};
+    if (total_bytes == 0) {
+        log("Warning: Nothing to sample", LOG_WARN);
+        return result;
+    }
+
+    log("Sampling " + format_size(std::min(total_bytes, options.sample_bytes)) + " from " +
+        std::to_string(manifest.size()) + " files (" + format_size(total_bytes) + ")...", LOG_INFO);
+    std::vector<SampleChunk> sample = select_sample(manifest, options.sample_bytes);
+    load_sample(sample);
+
+    double total_weight = 0.0;
+    double solid_weight = 0.0;
+    std::vector<char> solid_buffer;
+    for (const auto& chunk : sample) {
+        result.sampled_chunks++;
+        result.sampled_bytes += chunk.data.size();
+        total_weight += chunk.weight;
+        if (!chunk.compressible) {
+            result.incompressible_bytes += chunk.data.size();
+        } else {
+            solid_weight += chunk.weight;
+            if (options.solid) {
+                solid_buffer.insert(solid_buffer.end(), chunk.data.begin(), chunk.data.end());
+            }
+        }
+    }
+
+    std::vector<CompressionType> codecs = options.codecs;
+    if (codecs.empty()) {
+        for (const auto& pair : COMPRESSION_NAMES) codecs.push_back(pair.first);
+    }
+    std::vector<int> levels = options.levels;
+    if (levels.empty()) {
+        for (int level = 0; level <= 9; ++level) levels.push_back(level);
+    }
+
+    std::vector<std::pair<CompressionType, int>> settings;
+    for (CompressionType codec : codecs) {
+        if (compression::codec_uses_level(codec)) {
+            for (int level : levels) settings.emplace_back(codec, level);
+        } else {
+            settings.emplace_back(codec, 0);
+        }
+    }
+
+    log("Benchmarking " + std::to_string(settings.size()) + " settings on " + format_size(result.sampled_bytes) +
+        " using " + std::to_string(options.num_threads) + " threads...", LOG_INFO);
+
+    result.entries.resize(settings.size());
+    {
+        ThreadPool pool(std::max(1, options.num_threads));
+        std::vector<std::future<void>> futures;
+        for (size_t i = 0; i < settings.size(); ++i) {
+            futures.emplace_back(pool.enqueue([&, i] {
+                result.entries[i] = run_entry(settings[i].first, settings[i].second, sample, solid_buffer,
+                                              solid_weight, total_weight, total_bytes, options.solid);
+            }));
+        }
+        for (auto&& future : futures) {
+            future.get();
+        }
+    }
+
+    for (auto& entry : result.entries) {
+        if (!entry.error.empty()) continue;
+        entry.pareto = true;
+        for (const auto& other : result.entries) {
+            if (other.error.empty() && dominates(other, entry)) {
+                entry.pareto = false;
+                break;
+            }
+        }
+    }
+
+    double threads = std::max(1, options.num_threads);
+    int fastest = -1;
+    for (size_t i = 0; i < result.entries.size(); ++i) {
+        const auto& entry = result.entries[i];
+        if (!entry.error.empty()) continue;
+        if (fastest < 0 || entry.compress_mbps > result.entries[fastest].compress_mbps) {
+            fastest = (int)i;
+        }
+        if (entry.compress_mbps * threads < options.target_mbps) continue;
+        if (result.recommended < 0) {
+            result.recommended = (int)i;
+            continue;
+        }
+        const auto& best = result.entries[result.recommended];
+        if (entry.ratio > best.ratio || (entry.ratio == best.ratio && entry.compress_mbps > best.compress_mbps)) {
+            result.recommended = (int)i;
+        }
+    }
+    if (result.recommended < 0) {
+        result.recommended = fastest;
+    }
+    return result;
+}
+
+} // namespace core
+} // namespace prism
@@ -3,11 +3,13 @@
 #include <algorithm>
 #include <iomanip>
 #include <sstream>
-#include <regex>
 #include <cmath>
 #include <cstdlib>
 #include <filesystem>
 #include <system_error>
+#include <fstream>
+#include <cerrno>
+#include <mutex>
 
 #include <prism/core/logging.h>
 
@@ -68,76 +70,140 @@ bool should_compress(const std::string& file_path, CompressionType compression_t
     return COMPRESSED_EXTENSIONS.find(ext) == COMPRESSED_EXTENSIONS.end();
 }
 
-bool match_pattern(const std::string& path, const std::string& pattern) {
-    log("match_pattern: path='" + path + "', original_pattern='" + pattern + "'", LOG_VERBOSE);
-    std::string regex_pattern_str;
-    for (char c : pattern) {
-        if (c == '.' || c == '^' || c == '$' || c == '|' || c == '(' || c == ')' ||
-            c == '[' || c == ']' || c == '{' || c == '}' || c == '*' || c == '+' ||
-            c == '?' || c == '\\') {
-            regex_pattern_str += '\\';
+namespace {
+
+size_t find_segment(const std::string& path, size_t from, const std::string& segment, bool has_any_char) {
+    if (!has_any_char) {
+        return path.find(segment, from);
+    }
+    if (segment.size() > path.size()) {
+        return std::string::npos;
+    }
+    for (size_t start = from; start + segment.size() <= path.size(); ++start) {
+        size_t i = 0;
+        while (i < segment.size() && (segment[i] == '?' || segment[i] == path[start + i])) {
+            ++i;
+        }
+        if (i == segment.size()) {
+            return start;
         }
-        regex_pattern_str += c;
     }
+    return std::string::npos;
+}
 
-    regex_pattern_str = std::regex_replace(regex_pattern_str, std::regex("\\*"), ".*");
-    regex_pattern_str = std::regex_replace(regex_pattern_str, std::regex("\\?"), ".");
+} // anonymous namespace
 
-    log("match_pattern: generated regex_pattern='" + regex_pattern_str + "'", LOG_VERBOSE);
-    
-    try {
-        log("match_pattern: compiling regex: '" + regex_pattern_str + "'", LOG_VERBOSE);
-        std::regex re(regex_pattern_str);
-        bool result = std::regex_search(path, re);
-        log("match_pattern: regex_search result=" + std::to_string(result), LOG_VERBOSE);
-        return result;
-    } catch (const std::regex_error& e) {
-        log("match_pattern: regex_error: " + std::string(e.what()), LOG_WARN);
-        bool result = path.find(pattern) != std::string::npos;
-        log("match_pattern: fallback substring search result=" + std::to_string(result), LOG_VERBOSE);
-        return result;
-    } catch (...) {
-        log("match_pattern: unknown error in regex processing", LOG_WARN);
-        bool result = path.find(pattern) != std::string::npos;
-        log("match_pattern: fallback substring search result=" + std::to_string(result), LOG_VERBOSE);
-        return result;
+ExcludeMatcher::ExcludeMatcher(const std::vector<std::string>& sources) {
+    for (const auto& source : sources) {
+        if (source.empty()) {
+            continue;
+        }
+        CompiledPattern pattern;
+        pattern.source = source;
+        size_t start = 0;
+        while (start <= source.size()) {
+            size_t star = source.find('*', start);
+            std::string text = source.substr(start, star == std::string::npos ? std::string::npos : star - start);
+            if (!text.empty()) {
+                pattern.segments.push_back({text, text.find('?') != std::string::npos});
+            }
+            if (star == std::string::npos) {
+                break;
+            }
+            start = star + 1;
+        }
+        patterns.push_back(std::move(pattern));
     }
 }
 
-bool should_exclude(const std::string& path, const std::vector<std::string>& exclude_patterns) {
-    log("should_exclude: path='" + path + "', exclude_patterns_count=" + std::to_string(exclude_patterns.size()), LOG_VERBOSE);
-    for (const auto& pattern : exclude_patterns) {
-        if (match_pattern(path, pattern)) {
-            log("Excluding '" + path + "' (matches pattern: " + pattern + ")", LOG_VERBOSE);
-            return true;
+// Patterns are unanchored, so they behave as "*seg1*seg2*...*". Taking the
+// leftmost occurrence of each segment in turn is enough to decide a match.
+bool ExcludeMatcher::match_compiled(const CompiledPattern& pattern, const std::string& path) {
+    size_t pos = 0;
+    for (const auto& segment : pattern.segments) {
+        size_t found = find_segment(path, pos, segment.text, segment.has_any_char);
+        if (found == std::string::npos) {
+            return false;
         }
-        
-        if (path.rfind(pattern, 0) == 0) {
-            log("Excluding '" + path + "' (under excluded path: " + pattern + ")", LOG_VERBOSE);
+        pos = found + segment.text.size();
+    }
+    return true;
+}
+
+bool ExcludeMatcher::matches(const std::string& path) const {
+    for (const auto& pattern : patterns) {
+        if (match_compiled(pattern, path)) {
+            PRISM_LOG(LOG_VERBOSE, "Excluding '" + path + "' (matches pattern: " + pattern.source + ")");
             return true;
         }
     }
     return false;
 }
 
+bool ExcludeMatcher::matches_directory(const std::string& dir_path) const {
+    if (patterns.empty()) {
+        return false;
+    }
+    // Any match inside "dir/" is also a match inside every "dir/child".
+    return matches(dir_path) || matches(dir_path + "/");
+}
+
+bool match_pattern(const std::string& path, const std::string& pattern) {
+    return ExcludeMatcher({pattern}).matches(path);
+}
+
+bool should_exclude(const std::string& path, const std::vector<std::string>& exclude_patterns) {
+    return ExcludeMatcher(exclude_patterns).matches(path);
+}
+
 std::string get_absolute_path(const std::string& path) {
     return fs::absolute(path).string();
 }
 
-void list_files_recursive(const std::string& dir_path, std::vector<std::string>& files, const std::vector<std::string>& exclude_patterns) {
-    for (const auto& entry : fs::recursive_directory_iterator(dir_path)) {
+namespace {
+
+template <class OnFile>
+void walk_files(const std::string& dir_path, const ExcludeMatcher& excludes, OnFile&& on_file) {
+    fs::recursive_directory_iterator it(dir_path), end;
+    for (; it != end; ++it) {
+        const fs::directory_entry& entry = *it;
         std::string full_path = entry.path().string();
-        
-        if (should_exclude(full_path, exclude_patterns)) {
+
+        std::error_code ec;
+        if (entry.is_directory(ec)) {
+            if (excludes.matches_directory(full_path)) {
+                it.disable_recursion_pending();
+            }
             continue;
         }
-        
-        if (fs::is_regular_file(entry.status())) {
-            files.push_back(full_path);
+
+        if (!excludes.empty() && excludes.matches(full_path)) {
+            continue;
+        }
+
+        if (entry.is_regular_file(ec)) {
+            on_file(entry, std::move(full_path));
         }
     }
 }
 
+} // anonymous namespace
+
+void list_files_recursive(const std::string& dir_path, std::vector<std::string>& files, const ExcludeMatcher& excludes) {
+    walk_files(dir_path, excludes, [&](const fs::directory_entry&, std::string&& path) {
+        files.push_back(std::move(path));
+    });
+}
+
+void list_files_recursive(const std::string& dir_path, std::vector<ManifestEntry>& files, const ExcludeMatcher& excludes) {
+    walk_files(dir_path, excludes, [&](const fs::directory_entry& entry, std::string&& path) {
+        // The iterator usually has the size cached from the directory read.
+        std::error_code ec;
+        uint64_t size = entry.file_size(ec);
+        files.push_back({std::move(path), ec ? 0 : size});
+    });
+}
+
 uint64_t get_free_disk_space(const std::string& path) {
     try {
         std::error_code ec;
@@ -153,6 +219,135 @@ uint64_t get_free_disk_space(const std::string& path) {
     }
 }
 
+bool read_file_contents(const std::string& path, std::vector<char>& data) {
+#ifdef _WIN32
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file) {
+        return false;
+    }
+    std::streamsize size = file.tellg();
+    file.seekg(0, std::ios::beg);
+    data.resize(size);
+    return size == 0 || static_cast<bool>(file.read(data.data(), size));
+#else
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat st;
+    uint64_t expected = 0;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) {
+        expected = st.st_size;
+    }
+#ifdef POSIX_FADV_SEQUENTIAL
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+    // One spare byte lets the read that hits EOF return 0 without a regrow;
+    // files that grew since the stat are still read in full.
+    data.resize(expected + 1);
+    size_t filled = 0;
+    while (true) {
+        if (filled == data.size()) {
+            data.resize(data.size() + std::max<size_t>(data.size() / 2, 64 * 1024));
+        }
+        ssize_t n = read(fd, data.data() + filled, data.size() - filled);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            int saved = errno;
+            close(fd);
+            errno = saved;
+            data.clear();
+            return false;
+        }
+        if (n == 0) break;
+        filled += n;
+    }
+    close(fd);
+    data.resize(filled);
+    return true;
+#endif
+}
+
+namespace {
+#ifdef __linux__
+const uint64_t PREALLOCATE_MIN_SIZE = 1024 * 1024;
+
+void preallocate(int fd, uint64_t size) {
+    if (size >= PREALLOCATE_MIN_SIZE) {
+        // Best effort; filesystems without fallocate support just skip it.
+        posix_fallocate(fd, 0, size);
+    }
+}
+#endif
+} // anonymous namespace
+
+bool write_file_contents(const std::string& path, const char* data, uint64_t size) {
+#ifdef _WIN32
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        return false;
+    }
+    file.write(data, size);
+    file.close();
+    return static_cast<bool>(file);
+#else
+    const size_t WRITE_CHUNK = 8 * 1024 * 1024;
+
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+#ifdef __linux__
+    preallocate(fd, size);
+#endif
+
+    uint64_t written = 0;
+    while (written < size) {
+        size_t chunk = std::min<uint64_t>(size - written, WRITE_CHUNK);
+        ssize_t n = write(fd, data + written, chunk);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            int saved = errno;
+            close(fd);
+            errno = saved;
+            return false;
+        }
+        written += n;
+    }
+    return close(fd) == 0;
+#endif
+}
+
+void open_preallocated(const std::string& path, uint64_t size, std::ofstream& out) {
+#ifdef __linux__
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        out.setstate(std::ios::failbit);
+        return;
+    }
+    preallocate(fd, size);
+    close(fd);
+    // Opened for update so the preallocated blocks are not truncated away again.
+    out.open(path, std::ios::binary | std::ios::in | std::ios::out);
+#else
+    (void)size;
+    out.open(path, std::ios::binary | std::ios::trunc);
+#endif
+}
+
+void DirectoryCache::ensure(const std::string& dir_path) {
+    if (dir_path.empty()) return;
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        if (created.count(dir_path)) return;
+    }
+    fs::create_directories(dir_path);
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    created.insert(dir_path);
+}
+
 bool get_file_properties(const std::string& path, FileMetadata& metadata) {
     std::error_code ec;
     fs::file_status status = fs::status(path, ec);
@@ -224,14 +419,14 @@ bool get_file_properties(const std::string& path, FileMetadata& metadata) {
     return true;
 }
 
-bool set_file_properties(const std::string& path, const FileMetadata& metadata) {
+bool set_file_properties(const std::string& path, uint64_t modification_time, uint32_t permissions, uint32_t uid, uint32_t gid) {
     std::error_code ec;
 
 #ifdef _WIN32
     HANDLE hFile = CreateFileA(path.c_str(), FILE_WRITE_ATTRIBUTES, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
     if (hFile != INVALID_HANDLE_VALUE) {
         ULARGE_INTEGER uli;
-        uli.QuadPart = (uint64_t)metadata.modification_time * 10000000ULL + 11644473600ULL;
+        uli.QuadPart = (uint64_t)modification_time * 10000000ULL + 11644473600ULL;
         FILETIME ftWrite;
         ftWrite.dwLowDateTime = uli.LowPart;
         ftWrite.dwHighDateTime = uli.HighPart;
@@ -243,7 +438,7 @@ bool set_file_properties(const std::string& path, const FileMetadata& metadata)
         log("Failed to open file for setting modification time (WinAPI): " + path, LOG_WARN);
     }
 
-    if (metadata.uid == 0) {
+    if (uid == 0) {
         PSID adminSid = nullptr;
         SID_IDENTIFIER_AUTHORITY sidAuth = SECURITY_NT_AUTHORITY;
         if (AllocateAndInitializeSid(&sidAuth, 2, SECURITY_BUILTIN_DOMAIN_RID, DOMAIN_ALIAS_RID_ADMINS, 0, 0, 0, 0, 0, 0, &adminSid)) {
@@ -254,22 +449,22 @@ bool set_file_properties(const std::string& path, const FileMetadata& metadata)
             FreeSid(adminSid);
         }
     }
-    fs::permissions(path, static_cast<fs::perms>(metadata.permissions), ec);
+    fs::permissions(path, static_cast<fs::perms>(permissions), ec);
 #else
-    if (chmod(path.c_str(), metadata.permissions) != 0) {
+    if (chmod(path.c_str(), permissions) != 0) {
         log("Failed to set permissions for file: " + path, LOG_WARN);
     }
 
-    if (getuid() == 0 || (metadata.uid != 0 && metadata.gid != 0)) {
-        if (chown(path.c_str(), metadata.uid, metadata.gid) != 0) {
+    if (getuid() == 0 || (uid != 0 && gid != 0)) {
+        if (chown(path.c_str(), uid, gid) != 0) {
             log("Failed to set ownership for file: " + path, LOG_WARN);
         }
     }
 
     struct timespec times[2];
-    times[0].tv_sec = metadata.modification_time;
+    times[0].tv_sec = modification_time;
     times[0].tv_nsec = 0;
-    times[1].tv_sec = metadata.modification_time;
+    times[1].tv_sec = modification_time;
     times[1].tv_nsec = 0;
 
     if (utimensat(AT_FDCWD, path.c_str(), times, 0) != 0) {
@@ -3,14 +3,33 @@
 namespace prism {
 namespace core {
 
+namespace detail {
+std::atomic<unsigned> g_active_log_levels{0};
+}
+
 static LogHandler g_log_handler = nullptr;
+static unsigned g_enabled_log_levels = ~0u;
+
+static void update_active_log_levels() {
+    detail::g_active_log_levels.store(g_log_handler ? g_enabled_log_levels : 0u, std::memory_order_relaxed);
+}
 
 void set_log_handler(LogHandler handler) {
     g_log_handler = handler;
+    update_active_log_levels();
+}
+
+void set_log_level_enabled(LogLevel level, bool enabled) {
+    if (enabled) {
+        g_enabled_log_levels |= (1u << level);
+    } else {
+        g_enabled_log_levels &= ~(1u << level);
+    }
+    update_active_log_levels();
 }
 
 void log(const std::string& msg, LogLevel level) {
-    if (g_log_handler) {
+    if (log_enabled(level)) {
         g_log_handler(msg, static_cast<int>(level));
     }
 }
@@ -0,0 +1,48 @@
+#include <prism/core/memory_budget.h>
+#include <algorithm>
+
+namespace prism {
+namespace core {
+
+MemoryBudget& MemoryBudget::global() {
+    static MemoryBudget instance;
+    return instance;
+}
+
+void MemoryBudget::set_limit(uint64_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex);
+    limit_bytes = bytes;
+    peak_bytes = in_use;
+    changed.notify_all();
+}
+
+uint64_t MemoryBudget::peak() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return peak_bytes;
+}
+
+uint64_t MemoryBudget::acquire(uint64_t bytes) {
+    uint64_t limit = limit_bytes.load(std::memory_order_relaxed);
+    if (limit == 0 || bytes == 0) return 0;
+    bytes = std::min(bytes, limit);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    uint64_t ticket = next_ticket++;
+    changed.wait(lock, [&] { return ticket == serving && in_use + bytes <= limit; });
+    serving++;
+    in_use += bytes;
+    peak_bytes = std::max(peak_bytes, in_use);
+    // The next ticket may fit in what is left.
+    changed.notify_all();
+    return bytes;
+}
+
+void MemoryBudget::release(uint64_t bytes) {
+    if (bytes == 0) return;
+    std::lock_guard<std::mutex> lock(mutex);
+    in_use -= bytes;
+    changed.notify_all();
+}
+
+} // namespace core
+} // namespace prism
@@ -0,0 +1,219 @@
+#include <prism/core/metadata_codec.h>
+#include <prism/compression.h>
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace prism {
+namespace core {
+
+static bool g_compact_metadata = true;
+
+void set_compact_metadata(bool enabled) {
+    g_compact_metadata = enabled;
+}
+
+bool compact_metadata_enabled() {
+    return g_compact_metadata;
+}
+
+void put_varint(std::vector<char>& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+uint64_t get_varint(const std::vector<char>& in, size_t& pos) {
+    uint64_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (pos >= in.size()) throw std::runtime_error("Corrupted metadata: truncated varint.");
+        uint8_t byte = static_cast<uint8_t>(in[pos++]);
+        value |= (uint64_t)(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) return value;
+    }
+    throw std::runtime_error("Corrupted metadata: varint too long.");
+}
+
+namespace {
+uint64_t zigzag(int64_t value) {
+    return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+int64_t unzigzag(uint64_t value) {
+    return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+std::string get_bytes(const std::vector<char>& in, size_t& pos, uint64_t length) {
+    if (length > in.size() - pos) throw std::runtime_error("Corrupted metadata: truncated field.");
+    std::string bytes(&in[pos], length);
+    pos += length;
+    return bytes;
+}
+
+template <typename T>
+T read_plain(const std::vector<char>& in, size_t& pos) {
+    if (sizeof(T) > in.size() - pos) throw std::runtime_error("Corrupted metadata: truncated record.");
+    T value;
+    memcpy(&value, &in[pos], sizeof(T));
+    pos += sizeof(T);
+    return value;
+}
+
+template <typename T>
+void write_plain(std::vector<char>& out, T value) {
+    size_t at = out.size();
+    out.resize(at + sizeof(T));
+    memcpy(&out[at], &value, sizeof(T));
+}
+} // anonymous namespace
+
+void put_front_coded(std::vector<char>& out, std::string_view previous, std::string_view path) {
+    size_t shared = 0;
+    size_t limit = std::min(previous.size(), path.size());
+    while (shared < limit && previous[shared] == path[shared]) shared++;
+    put_varint(out, shared);
+    put_varint(out, path.size() - shared);
+    out.insert(out.end(), path.begin() + shared, path.end());
+}
+
+std::string get_front_coded(const std::vector<char>& in, size_t& pos, const std::string& previous) {
+    uint64_t shared = get_varint(in, pos);
+    uint64_t rest = get_varint(in, pos);
+    if (shared > previous.size()) throw std::runtime_error("Corrupted metadata: bad path prefix.");
+    return previous.substr(0, shared) + get_bytes(in, pos, rest);
+}
+
+void put_hash(std::vector<char>& out, const std::string& hash) {
+    bool hex = hash.size() % 2 == 0 && std::all_of(hash.begin(), hash.end(), [](char c) {
+        return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f');
+    });
+    if (!hex) {
+        put_varint(out, hash.size() << 1);
+        out.insert(out.end(), hash.begin(), hash.end());
+        return;
+    }
+    put_varint(out, (hash.size() / 2) << 1 | 1);
+    auto nibble = [](char c) { return c <= '9' ? c - '0' : c - 'a' + 10; };
+    for (size_t i = 0; i < hash.size(); i += 2) {
+        out.push_back(static_cast<char>(nibble(hash[i]) << 4 | nibble(hash[i + 1])));
+    }
+}
+
+std::string get_hash(const std::vector<char>& in, size_t& pos) {
+    uint64_t tag = get_varint(in, pos);
+    std::string bytes = get_bytes(in, pos, tag >> 1);
+    if ((tag & 1) == 0) return bytes;
+    static const char digits[] = "0123456789abcdef";
+    std::string hash;
+    hash.reserve(bytes.size() * 2);
+    for (unsigned char byte : bytes) {
+        hash.push_back(digits[byte >> 4]);
+        hash.push_back(digits[byte & 0x0F]);
+    }
+    return hash;
+}
+
+// Compact records: varint count, then per file a front-coded path, hash type,
+// packed hash, varint size, zigzag deltas of both times against the previous
+// record, and varint permissions, uid and gid.
+std::vector<char> encode_metadata_block(const std::vector<char>& records, CompressionType comp_type, int level, uint64_t& size_field) {
+    if (!g_compact_metadata) {
+        size_field = records.size();
+        return records;
+    }
+
+    std::vector<char> compact;
+    std::vector<char> body;
+    uint64_t count = 0;
+    std::string previous_path;
+    uint64_t previous_ctime = 0;
+    uint64_t previous_mtime = 0;
+    size_t pos = 0;
+    while (pos < records.size()) {
+        uint32_t path_len = read_plain<uint32_t>(records, pos);
+        std::string path = get_bytes(records, pos, path_len);
+        uint8_t hash_type = read_plain<uint8_t>(records, pos);
+        uint16_t hash_len = read_plain<uint16_t>(records, pos);
+        std::string hash = get_bytes(records, pos, hash_len);
+        uint64_t file_size = read_plain<uint64_t>(records, pos);
+        uint64_t ctime = read_plain<uint64_t>(records, pos);
+        uint64_t mtime = read_plain<uint64_t>(records, pos);
+        uint32_t permissions = read_plain<uint32_t>(records, pos);
+        uint32_t uid = read_plain<uint32_t>(records, pos);
+        uint32_t gid = read_plain<uint32_t>(records, pos);
+
+        put_front_coded(body, previous_path, path);
+        body.push_back(static_cast<char>(hash_type));
+        put_hash(body, hash);
+        put_varint(body, file_size);
+        put_varint(body, zigzag((int64_t)(ctime - previous_ctime)));
+        put_varint(body, zigzag((int64_t)(mtime - previous_mtime)));
+        put_varint(body, permissions);
+        put_varint(body, uid);
+        put_varint(body, gid);
+
+        previous_path = std::move(path);
+        previous_ctime = ctime;
+        previous_mtime = mtime;
+        count++;
+    }
+    put_varint(compact, count);
+    compact.insert(compact.end(), body.begin(), body.end());
+
+    std::vector<char> stored;
+    put_varint(stored, compact.size());
+    std::vector<char> compressed = compression::compress_data(compact, comp_type, level);
+    stored.insert(stored.end(), compressed.begin(), compressed.end());
+    size_field = stored.size() | COMPACT_METADATA_FLAG;
+    return stored;
+}
+
+std::vector<char> decode_metadata_block(const std::vector<char>& stored, uint64_t size_field, CompressionType comp_type) {
+    if ((size_field & COMPACT_METADATA_FLAG) == 0) {
+        return stored;
+    }
+
+    size_t pos = 0;
+    uint64_t raw_size = get_varint(stored, pos);
+    std::vector<char> compressed(stored.begin() + pos, stored.end());
+    std::vector<char> compact = compression::decompress_data(compressed, comp_type, raw_size);
+    if (compact.size() != raw_size) {
+        throw std::runtime_error("Corrupted metadata: size mismatch after decompression.");
+    }
+
+    std::vector<char> records;
+    pos = 0;
+    uint64_t count = get_varint(compact, pos);
+    std::string path;
+    uint64_t ctime = 0;
+    uint64_t mtime = 0;
+    for (uint64_t i = 0; i < count; ++i) {
+        path = get_front_coded(compact, pos, path);
+        uint8_t hash_type = static_cast<uint8_t>(read_plain<uint8_t>(compact, pos));
+        std::string hash = get_hash(compact, pos);
+        uint64_t file_size = get_varint(compact, pos);
+        ctime += (uint64_t)unzigzag(get_varint(compact, pos));
+        mtime += (uint64_t)unzigzag(get_varint(compact, pos));
+        uint32_t permissions = (uint32_t)get_varint(compact, pos);
+        uint32_t uid = (uint32_t)get_varint(compact, pos);
+        uint32_t gid = (uint32_t)get_varint(compact, pos);
+
+        write_plain<uint32_t>(records, path.size());
+        records.insert(records.end(), path.begin(), path.end());
+        write_plain<uint8_t>(records, hash_type);
+        write_plain<uint16_t>(records, hash.size());
+        records.insert(records.end(), hash.begin(), hash.end());
+        write_plain<uint64_t>(records, file_size);
+        write_plain<uint64_t>(records, ctime);
+        write_plain<uint64_t>(records, mtime);
+        write_plain<uint32_t>(records, permissions);
+        write_plain<uint32_t>(records, uid);
+        write_plain<uint32_t>(records, gid);
+    }
+    return records;
+}
+
+} // namespace core
+} // namespace prism
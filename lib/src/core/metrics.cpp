@@ -0,0 +1,242 @@
+#include <prism/core/metrics.h>
+#include <sstream>
+#include <iomanip>
+
+namespace prism {
+namespace core {
+
+namespace {
+
+size_t bucket_for(uint64_t ns) {
+    size_t bucket = 0;
+    while (ns > 1 && bucket + 1 < LatencyHistogram::BUCKETS) {
+        ns >>= 1;
+        ++bucket;
+    }
+    return bucket;
+}
+
+void update_max(std::atomic<uint64_t>& target, uint64_t value) {
+    uint64_t current = target.load(std::memory_order_relaxed);
+    while (value > current && !target.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+    }
+}
+
+double mb_per_second(uint64_t bytes, uint64_t ns) {
+    if (ns == 0) return 0.0;
+    return (double)bytes / (1024.0 * 1024.0) / ((double)ns / 1e9);
+}
+
+} // anonymous namespace
+
+const char* stage_name(Stage stage) {
+    switch (stage) {
+        case Stage::WALK: return "walk";
+        case Stage::READ: return "read";
+        case Stage::HASH: return "hash";
+        case Stage::COMPRESS: return "compress";
+        case Stage::WRITE: return "write";
+        case Stage::DECOMPRESS: return "decompress";
+        case Stage::SET_PROPERTIES: return "set_properties";
+        default: return "unknown";
+    }
+}
+
+std::string json_escape(const std::string& text) {
+    std::ostringstream out;
+    for (unsigned char c : text) {
+        switch (c) {
+            case '"': out << "\\\""; break;
+            case '\\': out << "\\\\"; break;
+            case '\n': out << "\\n"; break;
+            case '\r': out << "\\r"; break;
+            case '\t': out << "\\t"; break;
+            default:
+                if (c < 0x20) {
+                    out << "\\u" << std::hex << std::setw(4) << std::setfill('0') << (int)c << std::dec;
+                } else {
+                    out << c;
+                }
+        }
+    }
+    return out.str();
+}
+
+void LatencyHistogram::record(uint64_t ns) {
+    buckets[bucket_for(ns)].fetch_add(1, std::memory_order_relaxed);
+}
+
+void LatencyHistogram::reset() {
+    for (auto& bucket : buckets) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+}
+
+uint64_t LatencyHistogram::count() const {
+    uint64_t total = 0;
+    for (const auto& bucket : buckets) {
+        total += bucket.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+uint64_t LatencyHistogram::quantile_ns(double q) const {
+    uint64_t total = count();
+    if (total == 0) return 0;
+    uint64_t target = (uint64_t)(q * total);
+    if (target >= total) target = total - 1;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKETS; ++i) {
+        seen += buckets[i].load(std::memory_order_relaxed);
+        if (seen > target) {
+            return 1ULL << (i + 1);
+        }
+    }
+    return 1ULL << BUCKETS;
+}
+
+std::string LatencyHistogram::to_json() const {
+    std::ostringstream out;
+    out << "{\"p50_ns\":" << quantile_ns(0.50)
+        << ",\"p90_ns\":" << quantile_ns(0.90)
+        << ",\"p99_ns\":" << quantile_ns(0.99)
+        << ",\"buckets\":[";
+    bool first = true;
+    for (size_t i = 0; i < BUCKETS; ++i) {
+        uint64_t n = buckets[i].load(std::memory_order_relaxed);
+        if (n == 0) continue;
+        if (!first) out << ",";
+        first = false;
+        out << "{\"le_ns\":" << (1ULL << (i + 1)) << ",\"count\":" << n << "}";
+    }
+    out << "]}";
+    return out.str();
+}
+
+Metrics& Metrics::global() {
+    static Metrics instance;
+    return instance;
+}
+
+void Metrics::set_enabled(bool enabled) {
+    is_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+void Metrics::reset() {
+    for (auto& stage : stages) {
+        stage.count = 0;
+        stage.total_ns = 0;
+        stage.max_ns = 0;
+        stage.bytes = 0;
+        stage.latency.reset();
+    }
+    for (auto& codec : codecs) {
+        codec.compress_calls = 0;
+        codec.compress_bytes_in = 0;
+        codec.compress_bytes_out = 0;
+        codec.compress_ns = 0;
+        codec.decompress_calls = 0;
+        codec.decompress_bytes_in = 0;
+        codec.decompress_bytes_out = 0;
+        codec.decompress_ns = 0;
+    }
+    tasks = 0;
+    queue_wait.reset();
+    task_run.reset();
+    queue_wait_total_ns = 0;
+    task_run_total_ns = 0;
+}
+
+void Metrics::record_stage(Stage stage, uint64_t ns, uint64_t bytes) {
+    if (!enabled()) return;
+    StageMetrics& m = stages[static_cast<size_t>(stage)];
+    m.count.fetch_add(1, std::memory_order_relaxed);
+    m.total_ns.fetch_add(ns, std::memory_order_relaxed);
+    m.bytes.fetch_add(bytes, std::memory_order_relaxed);
+    update_max(m.max_ns, ns);
+    m.latency.record(ns);
+}
+
+void Metrics::record_codec(CompressionType type, bool compress, uint64_t bytes_in, uint64_t bytes_out, uint64_t ns) {
+    if (!enabled()) return;
+    size_t slot = static_cast<size_t>(type);
+    if (slot >= CODEC_SLOTS) return;
+    CodecMetrics& m = codecs[slot];
+    if (compress) {
+        m.compress_calls.fetch_add(1, std::memory_order_relaxed);
+        m.compress_bytes_in.fetch_add(bytes_in, std::memory_order_relaxed);
+        m.compress_bytes_out.fetch_add(bytes_out, std::memory_order_relaxed);
+        m.compress_ns.fetch_add(ns, std::memory_order_relaxed);
+    } else {
+        m.decompress_calls.fetch_add(1, std::memory_order_relaxed);
+        m.decompress_bytes_in.fetch_add(bytes_in, std::memory_order_relaxed);
+        m.decompress_bytes_out.fetch_add(bytes_out, std::memory_order_relaxed);
+        m.decompress_ns.fetch_add(ns, std::memory_order_relaxed);
+    }
+}
+
+void Metrics::record_task(uint64_t queue_wait_ns, uint64_t run_ns) {
+    if (!enabled()) return;
+    tasks.fetch_add(1, std::memory_order_relaxed);
+    queue_wait.record(queue_wait_ns);
+    task_run.record(run_ns);
+    queue_wait_total_ns.fetch_add(queue_wait_ns, std::memory_order_relaxed);
+    task_run_total_ns.fetch_add(run_ns, std::memory_order_relaxed);
+}
+
+std::string Metrics::to_json() const {
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(3);
+
+    out << "{\"stages\":{";
+    bool first = true;
+    for (size_t i = 0; i < stages.size(); ++i) {
+        const StageMetrics& m = stages[i];
+        uint64_t count = m.count.load();
+        if (count == 0) continue;
+        if (!first) out << ",";
+        first = false;
+        uint64_t total_ns = m.total_ns.load();
+        uint64_t bytes = m.bytes.load();
+        out << "\"" << stage_name(static_cast<Stage>(i)) << "\":{"
+            << "\"count\":" << count
+            << ",\"total_ns\":" << total_ns
+            << ",\"max_ns\":" << m.max_ns.load()
+            << ",\"bytes\":" << bytes
+            << ",\"mb_per_s\":" << mb_per_second(bytes, total_ns)
+            << ",\"latency\":" << m.latency.to_json() << "}";
+    }
+    out << "},\"codecs\":{";
+
+    first = true;
+    for (size_t i = 0; i < codecs.size(); ++i) {
+        const CodecMetrics& m = codecs[i];
+        if (m.compress_calls.load() == 0 && m.decompress_calls.load() == 0) continue;
+        auto name = COMPRESSION_NAMES.find(static_cast<CompressionType>(i));
+        if (!first) out << ",";
+        first = false;
+        out << "\"" << (name != COMPRESSION_NAMES.end() ? name->second : std::to_string(i)) << "\":{"
+            << "\"compress_calls\":" << m.compress_calls.load()
+            << ",\"compress_bytes_in\":" << m.compress_bytes_in.load()
+            << ",\"compress_bytes_out\":" << m.compress_bytes_out.load()
+            << ",\"compress_ns\":" << m.compress_ns.load()
+            << ",\"compress_mb_per_s\":" << mb_per_second(m.compress_bytes_in.load(), m.compress_ns.load())
+            << ",\"decompress_calls\":" << m.decompress_calls.load()
+            << ",\"decompress_bytes_in\":" << m.decompress_bytes_in.load()
+            << ",\"decompress_bytes_out\":" << m.decompress_bytes_out.load()
+            << ",\"decompress_ns\":" << m.decompress_ns.load()
+            << ",\"decompress_mb_per_s\":" << mb_per_second(m.decompress_bytes_out.load(), m.decompress_ns.load())
+            << "}";
+    }
+    out << "},\"thread_pool\":{"
+        << "\"tasks\":" << tasks.load()
+        << ",\"queue_wait_total_ns\":" << queue_wait_total_ns.load()
+        << ",\"run_total_ns\":" << task_run_total_ns.load()
+        << ",\"queue_wait\":" << queue_wait.to_json()
+        << ",\"run\":" << task_run.to_json()
+        << "}}";
+    return out.str();
+}
+
+} // namespace core
+} // namespace prism
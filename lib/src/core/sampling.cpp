@@ -0,0 +1,103 @@
+#include <prism/core/sampling.h>
+#include <prism/core/file_utils.h>
+#include <prism/core/logging.h>
+#include <prism/core/types.h>
+#include <algorithm>
+#include <fstream>
+
+namespace prism {
+namespace core {
+
+std::vector<SampleChunk> select_sample(const std::vector<ManifestEntry>& manifest, uint64_t budget_bytes,
+                                       uint64_t max_chunk_bytes) {
+    std::vector<SampleChunk> chunks;
+    uint64_t total = 0;
+    for (const auto& entry : manifest) {
+        total += entry.size;
+    }
+    if (total == 0 || budget_bytes == 0) {
+        return chunks;
+    }
+
+    // Everything fits: sample the whole input.
+    if (total <= budget_bytes) {
+        for (const auto& entry : manifest) {
+            if (entry.size == 0) continue;
+            chunks.push_back({entry.path, 0, entry.size, (double)entry.size,
+                              should_compress(entry.path, CompressionType::ZLIB), {}});
+        }
+        return chunks;
+    }
+
+    // Enough points that small-file trees get many files, with the chunk size
+    // shrunk so the total stays within budget.
+    uint64_t points = std::max<uint64_t>(1, budget_bytes / max_chunk_bytes);
+    points = std::max<uint64_t>(points, std::min<uint64_t>(manifest.size(), 1024));
+    uint64_t chunk_cap = std::max<uint64_t>(4096, std::min(max_chunk_bytes, budget_bytes / points));
+    double stride = (double)total / points;
+
+    uint64_t file_start = 0;
+    size_t index = 0;
+    for (uint64_t p = 0; p < points; ++p) {
+        uint64_t position = (uint64_t)((p + 0.5) * stride);
+        while (index < manifest.size() && file_start + manifest[index].size <= position) {
+            file_start += manifest[index].size;
+            index++;
+        }
+        if (index >= manifest.size()) break;
+
+        const ManifestEntry& entry = manifest[index];
+        uint64_t length = std::min(entry.size, chunk_cap);
+        uint64_t offset = 0;
+        if (entry.size > chunk_cap) {
+            uint64_t within = position - file_start;
+            offset = within > chunk_cap / 2 ? within - chunk_cap / 2 : 0;
+            offset = std::min(offset, entry.size - chunk_cap);
+        }
+
+        // Several points inside one small file share a single chunk.
+        if (!chunks.empty() && chunks.back().path == entry.path && chunks.back().offset == offset) {
+            chunks.back().weight += stride;
+            continue;
+        }
+        chunks.push_back({entry.path, offset, length, stride,
+                          should_compress(entry.path, CompressionType::ZLIB), {}});
+    }
+    return chunks;
+}
+
+void load_sample(std::vector<SampleChunk>& chunks) {
+    double lost_weight = 0.0;
+    double kept_weight = 0.0;
+    std::vector<SampleChunk> loaded;
+    loaded.reserve(chunks.size());
+
+    for (auto& chunk : chunks) {
+        std::ifstream in(chunk.path, std::ios::binary);
+        if (in) {
+            chunk.data.resize(chunk.length);
+            in.seekg(chunk.offset);
+            in.read(chunk.data.data(), chunk.length);
+            chunk.data.resize(in.gcount());
+        }
+        if (chunk.data.empty()) {
+            PRISM_LOG(LOG_VERBOSE, "Could not sample '" + chunk.path + "'");
+            lost_weight += chunk.weight;
+            continue;
+        }
+        chunk.length = chunk.data.size();
+        kept_weight += chunk.weight;
+        loaded.push_back(std::move(chunk));
+    }
+
+    if (lost_weight > 0.0 && kept_weight > 0.0) {
+        double scale = (kept_weight + lost_weight) / kept_weight;
+        for (auto& chunk : loaded) {
+            chunk.weight *= scale;
+        }
+    }
+    chunks = std::move(loaded);
+}
+
+} // namespace core
+} // namespace prism
@@ -0,0 +1,230 @@
+#include <prism/core/solid_stream.h>
+#include <prism/core/metrics.h>
+#include <prism/core/memory_budget.h>
+#include <prism/compression.h>
+#include <algorithm>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+
+namespace prism {
+namespace core {
+
+size_t solid_frames_in_flight(int num_threads, uint64_t other_bytes) {
+    size_t frames = std::max(1, num_threads) + 1;
+    uint64_t limit = MemoryBudget::global().limit();
+    if (limit > 0) {
+        uint64_t fit = limit > other_bytes ? (limit - other_bytes) / (2 * (uint64_t)SOLID_FRAME_SIZE) : 0;
+        frames = std::max<size_t>(1, std::min<uint64_t>(frames, fit));
+    }
+    return frames;
+}
+
+uint64_t solid_block_memory(const EntryView& item, uint64_t block_size) {
+    if (item.is_framed()) {
+        return std::min<uint64_t>(block_size, 3 * (uint64_t)SOLID_FRAME_SIZE) + SOLID_FRAME_SIZE;
+    }
+    return block_size + item.compressed_size();
+}
+
+SolidFrameWriter::SolidFrameWriter(std::ostream& out, CompressionType comp_type, int level, ThreadPool& pool, size_t max_in_flight)
+    : out(out), comp_type(comp_type), level(level), pool(pool), max_in_flight(std::max<size_t>(1, max_in_flight)) {
+    current.reserve(SOLID_FRAME_SIZE);
+}
+
+void SolidFrameWriter::write(const char* data, size_t size) {
+    while (size > 0) {
+        size_t take = std::min<size_t>(size, SOLID_FRAME_SIZE - current.size());
+        current.insert(current.end(), data, data + take);
+        data += take;
+        size -= take;
+        if (current.size() == SOLID_FRAME_SIZE) {
+            submit_frame();
+        }
+    }
+}
+
+uint64_t SolidFrameWriter::finish() {
+    if (!current.empty()) {
+        submit_frame();
+    }
+    drain(0);
+    uint32_t end_marker[2] = {0, 0};
+    out.write((char*)end_marker, sizeof(end_marker));
+    bytes_written += sizeof(end_marker);
+    return bytes_written;
+}
+
+void SolidFrameWriter::submit_frame() {
+    drain(max_in_flight - 1);
+    auto frame = std::make_shared<std::vector<char>>(std::move(current));
+    current = std::vector<char>();
+    current.reserve(SOLID_FRAME_SIZE);
+    CompressionType comp = comp_type;
+    int lvl = level;
+    pending.push_back(pool.enqueue([frame, comp, lvl] {
+        StageTimer compress_timer(Stage::COMPRESS);
+        EncodedFrame encoded{(uint32_t)frame->size(), compression::compress_data(*frame, comp, lvl)};
+        compress_timer.stop(frame->size());
+        return encoded;
+    }));
+}
+
+void SolidFrameWriter::drain(size_t keep) {
+    while (pending.size() > keep) {
+        EncodedFrame frame = pending.front().get();
+        pending.pop_front();
+        if (frame.data.size() > UINT32_MAX) {
+            throw std::runtime_error("Compressed solid frame is too large.");
+        }
+        uint32_t sizes[2] = {frame.raw_size, (uint32_t)frame.data.size()};
+        StageTimer write_timer(Stage::WRITE);
+        out.write((char*)sizes, sizeof(sizes));
+        out.write(frame.data.data(), frame.data.size());
+        write_timer.stop(sizeof(sizes) + frame.data.size());
+        bytes_written += sizeof(sizes) + frame.data.size();
+    }
+}
+
+namespace {
+// Reads the next frame header; false at the end marker.
+bool read_frame_header(std::istream& in, uint32_t sizes[2]) {
+    in.read((char*)sizes, 2 * sizeof(uint32_t));
+    if (in.gcount() < (std::streamsize)(2 * sizeof(uint32_t))) {
+        throw std::runtime_error("Unexpected EOF while reading solid frames.");
+    }
+    return sizes[0] != 0;
+}
+
+std::vector<char> read_frame_data(std::istream& in, uint32_t compressed_size) {
+    std::vector<char> compressed(compressed_size);
+    StageTimer read_timer(Stage::READ);
+    in.read(compressed.data(), compressed_size);
+    if ((uint32_t)in.gcount() < compressed_size) {
+        throw std::runtime_error("Unexpected EOF while reading solid frame data.");
+    }
+    read_timer.stop(compressed_size);
+    return compressed;
+}
+
+std::vector<char> decode_frame(const std::vector<char>& compressed, CompressionType comp_type, uint32_t raw_size) {
+    StageTimer decompress_timer(Stage::DECOMPRESS);
+    std::vector<char> frame = compression::decompress_data(compressed, comp_type, raw_size);
+    decompress_timer.stop(frame.size());
+    if (frame.size() != raw_size) {
+        throw std::runtime_error("Corrupted solid frame: size mismatch.");
+    }
+    return frame;
+}
+} // namespace
+
+uint64_t skip_solid_frames(std::istream& in) {
+    uint64_t start = in.tellg();
+    uint32_t sizes[2];
+    while (read_frame_header(in, sizes)) {
+        in.seekg(sizes[1], std::ios::cur);
+    }
+    return (uint64_t)in.tellg() - start;
+}
+
+void decode_solid_block(const std::string& archive_file, const FileMetadata& item, uint64_t block_size,
+                        const std::function<bool(uint64_t, uint64_t)>& wanted,
+                        const std::function<void(uint64_t, const char*, size_t)>& consume) {
+    FileSource source(archive_file);
+    decode_solid_block(source, item, block_size, wanted, consume);
+}
+
+void decode_solid_block(const ArchiveSource& source, const FileMetadata& item, uint64_t block_size,
+                        const std::function<bool(uint64_t, uint64_t)>& wanted,
+                        const std::function<void(uint64_t, const char*, size_t)>& consume) {
+    if (!item.is_framed) {
+        std::vector<char> block = read_solid_block(source, item, block_size);
+        consume(0, block.data(), block.size());
+        return;
+    }
+
+    SourceStream in(source);
+    in.seekg(item.header_start_offset);
+
+    // The first wanted frame is held compressed. Only when a second one turns
+    // up is a decoder thread started to run a frame ahead of consume, so a
+    // block with a single wanted frame is decoded inline. The caller may
+    // itself be a pool worker, so the shared pool cannot be used for this.
+    std::unique_ptr<ThreadPool> decoder;
+    std::vector<char> held;
+    uint32_t held_raw_size = 0;
+    bool holding = false;
+    std::future<std::vector<char>> pending;
+    uint64_t pending_offset = 0;
+    uint64_t offset = 0;
+    CompressionType comp_type = item.compression_type;
+    uint32_t sizes[2];
+    while (read_frame_header(in, sizes)) {
+        uint64_t frame_offset = offset;
+        offset += sizes[0];
+        if (!wanted(frame_offset, offset)) {
+            in.seekg(sizes[1], std::ios::cur);
+            continue;
+        }
+        if (!holding && !pending.valid()) {
+            held = read_frame_data(in, sizes[1]);
+            held_raw_size = sizes[0];
+            holding = true;
+            pending_offset = frame_offset;
+            continue;
+        }
+        if (!decoder) decoder.reset(new ThreadPool(1));
+        auto compressed = std::make_shared<std::vector<char>>(read_frame_data(in, sizes[1]));
+        uint32_t raw_size = sizes[0];
+        std::future<std::vector<char>> decoded = decoder->enqueue([compressed, comp_type, raw_size] {
+            return decode_frame(*compressed, comp_type, raw_size);
+        });
+        std::vector<char> frame = holding ? decode_frame(held, comp_type, held_raw_size) : pending.get();
+        holding = false;
+        consume(pending_offset, frame.data(), frame.size());
+        pending = std::move(decoded);
+        pending_offset = frame_offset;
+    }
+    if (holding || pending.valid()) {
+        std::vector<char> frame = holding ? decode_frame(held, comp_type, held_raw_size) : pending.get();
+        consume(pending_offset, frame.data(), frame.size());
+    }
+}
+
+std::vector<char> read_solid_frames(std::istream& in, uint64_t offset, CompressionType comp_type, uint64_t expected_size) {
+    std::vector<char> block;
+    block.reserve(expected_size);
+    in.seekg(offset);
+    uint32_t sizes[2];
+    while (read_frame_header(in, sizes)) {
+        std::vector<char> frame = decode_frame(read_frame_data(in, sizes[1]), comp_type, sizes[0]);
+        block.insert(block.end(), frame.begin(), frame.end());
+    }
+    return block;
+}
+
+std::vector<char> read_solid_block(const std::string& archive_file, const FileMetadata& item, uint64_t block_size) {
+    FileSource source(archive_file);
+    return read_solid_block(source, item, block_size);
+}
+
+std::vector<char> read_solid_block(const ArchiveSource& source, const FileMetadata& item, uint64_t block_size) {
+    if (item.is_framed) {
+        SourceStream in(source);
+        return read_solid_frames(in, item.header_start_offset, item.compression_type, block_size);
+    }
+
+    std::vector<char> compressed_block(item.compressed_size);
+    {
+        StageTimer read_timer(Stage::READ);
+        compressed_block.resize(source.read_at(item.header_start_offset, compressed_block.data(), item.compressed_size));
+        read_timer.stop(item.compressed_size);
+    }
+    StageTimer decompress_timer(Stage::DECOMPRESS);
+    std::vector<char> block = compression::decompress_data(compressed_block, item.compression_type, block_size);
+    decompress_timer.stop(block.size());
+    return block;
+}
+
+} // namespace core
+} // namespace prism
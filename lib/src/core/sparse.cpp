@@ -0,0 +1,165 @@
+#include <prism/core/sparse.h>
+#include <prism/compression.h>
+#include <prism/hashing.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace prism {
+namespace core {
+
+bool get_data_extents(const std::string& path, std::vector<FileExtent>& extents, uint64_t& file_size) {
+    extents.clear();
+#if defined(SEEK_DATA) && defined(SEEK_HOLE)
+    // Cheap check first: a file whose allocation covers its size has no holes.
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) return false;
+    if ((uint64_t)st.st_size < SPARSE_MIN_FILE_SIZE || (uint64_t)st.st_blocks * 512 >= (uint64_t)st.st_size) return false;
+
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+
+    file_size = st.st_size;
+    uint64_t data_bytes = 0;
+    off_t pos = 0;
+    while ((uint64_t)pos < file_size) {
+        off_t data = lseek(fd, pos, SEEK_DATA);
+        if (data < 0) {
+            if (errno == ENXIO) break;  // only a hole remains
+            close(fd);
+            extents.clear();
+            return false;
+        }
+        if ((uint64_t)data >= file_size) break;  // the file grew after stat
+        off_t hole = lseek(fd, data, SEEK_HOLE);
+        if (hole < 0 || (uint64_t)hole > file_size) hole = file_size;
+        extents.push_back({(uint64_t)data, (uint64_t)(hole - data)});
+        data_bytes += hole - data;
+        pos = hole;
+    }
+    close(fd);
+
+    if (data_bytes == file_size) {
+        extents.clear();
+        return false;
+    }
+    return true;
+#else
+    (void)path;
+    (void)file_size;
+    return false;
+#endif
+}
+
+bool read_extents(const std::string& path, const std::vector<FileExtent>& extents, std::vector<char>& data) {
+    uint64_t total = 0;
+    for (const auto& extent : extents) total += extent.length;
+    data.assign(total, 0);
+
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return false;
+
+    // A file that shrank since its extents were mapped reads back as zeros.
+    char* out = data.data();
+    for (const auto& extent : extents) {
+        in.clear();
+        in.seekg(extent.offset);
+        in.read(out, extent.length);
+        out += extent.length;
+    }
+    return !in.bad();
+}
+
+bool write_sparse_file(const std::string& path, uint64_t file_size, const std::vector<FileExtent>& extents, const char* data) {
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        if (!out) return false;
+        // Seeking past the end and writing leaves the gap unallocated.
+        for (const auto& extent : extents) {
+            out.seekp(extent.offset);
+            out.write(data, extent.length);
+            data += extent.length;
+        }
+        out.close();
+        if (!out) return false;
+    }
+    std::error_code ec;
+    fs::resize_file(path, file_size, ec);
+    return !ec;
+}
+
+std::string hash_sparse_contents(const std::vector<FileExtent>& extents, const char* data, uint64_t file_size, HashType hash_type) {
+    if (hash_type == HashType::NONE) return "";
+    hashing::StreamHasher hasher(hash_type);
+    std::vector<char> zeros(std::min<uint64_t>(file_size, 1024 * 1024), 0);
+    uint64_t position = 0;
+    auto fill_to = [&](uint64_t offset) {
+        while (position < offset) {
+            size_t take = std::min<uint64_t>(offset - position, zeros.size());
+            hasher.update(zeros.data(), take);
+            position += take;
+        }
+    };
+    for (const auto& extent : extents) {
+        fill_to(extent.offset);
+        hasher.update(data, extent.length);
+        data += extent.length;
+        position += extent.length;
+    }
+    fill_to(file_size);
+    return hasher.finish();
+}
+
+std::vector<char> encode_sparse_payload(const std::vector<FileExtent>& extents, const std::vector<char>& compressed_data) {
+    std::vector<char> payload(4 + extents.size() * 16);
+    uint32_t count = extents.size();
+    memcpy(&payload[0], &count, 4);
+    size_t pos = 4;
+    for (const auto& extent : extents) {
+        memcpy(&payload[pos], &extent.offset, 8);
+        memcpy(&payload[pos + 8], &extent.length, 8);
+        pos += 16;
+    }
+    payload.insert(payload.end(), compressed_data.begin(), compressed_data.end());
+    return payload;
+}
+
+std::vector<char> decode_sparse_payload(const std::vector<char>& payload, CompressionType compression_type,
+                                        uint64_t file_size, std::vector<FileExtent>& extents) {
+    if (payload.size() < 4) throw std::runtime_error("Corrupted sparse entry: missing extent table.");
+    uint32_t count;
+    memcpy(&count, &payload[0], 4);
+    if ((payload.size() - 4) / 16 < count) throw std::runtime_error("Corrupted sparse entry: truncated extent table.");
+
+    extents.resize(count);
+    uint64_t data_bytes = 0;
+    uint64_t end = 0;
+    size_t pos = 4;
+    for (auto& extent : extents) {
+        memcpy(&extent.offset, &payload[pos], 8);
+        memcpy(&extent.length, &payload[pos + 8], 8);
+        pos += 16;
+        if (extent.offset < end || extent.length > file_size || extent.offset > file_size - extent.length) {
+            throw std::runtime_error("Corrupted sparse entry: invalid extent.");
+        }
+        end = extent.offset + extent.length;
+        data_bytes += extent.length;
+    }
+
+    std::vector<char> compressed(payload.begin() + pos, payload.end());
+    return compression::decompress_data(compressed, compression_type, data_bytes);
+}
+
+} // namespace core
+} // namespace prism
@@ -53,6 +53,9 @@ const std::set<std::string> COMPRESSED_EXTENSIONS = {
 };
 
 const char* SOLID_BLOCK_MAGIC = "SLDB";
+const char* SOLID_GROUP_MAGIC = "SLDG";
+const char* SOLID_STREAM_MAGIC = "SLDS";
+const char* ARCHIVE_INDEX_MAGIC = "PIDX";
 
 } // namespace core
 } // namespace prism
\ No newline at end of file
@@ -2,6 +2,7 @@
 #include <prism/core/file_utils.h>
 #include <iostream>
 #include <iomanip>
+#include <sstream>
 #include <chrono>
 
 namespace prism {
@@ -13,55 +14,119 @@ void set_progress_bar_detailed(bool detailed) {
     g_detailed_progress_bar = detailed;
 }
 
-void show_progress_bar(int current, int total, const std::string& file_path, uint64_t file_size, uint64_t compressed_size, std::chrono::steady_clock::time_point start_time, bool raw_output, bool use_basic_chars) {
-    if (raw_output) {
-        std::cout << current << "/" << total << "\r";
-        if (current == total) {
-            std::cout << std::endl;
+ProgressReporter::ProgressReporter(size_t total_files, uint64_t total_bytes, bool raw_output, bool use_basic_chars,
+                                   std::mutex* output_mutex, int refresh_hz)
+    : total_files(total_files), total_bytes(total_bytes), raw_output(raw_output), use_basic_chars(use_basic_chars),
+      output_mutex(output_mutex), interval(1000 / (refresh_hz > 0 ? refresh_hz : 10)),
+      start_time(std::chrono::steady_clock::now()) {
+    thread = std::thread(&ProgressReporter::run, this);
+}
+
+ProgressReporter::~ProgressReporter() {
+    stop();
+}
+
+void ProgressReporter::file_done(const std::string& file_path, uint64_t in, uint64_t out) {
+    bytes_in.fetch_add(in, std::memory_order_relaxed);
+    bytes_out.fetch_add(out, std::memory_order_relaxed);
+    files_done.fetch_add(1, std::memory_order_relaxed);
+    // The name is cosmetic; skip it rather than wait for the renderer.
+    if (g_detailed_progress_bar && current_file_mutex.try_lock()) {
+        current_file = file_path;
+        current_file_mutex.unlock();
+    }
+}
+
+void ProgressReporter::add_total(size_t files, uint64_t bytes) {
+    total_files.fetch_add(files, std::memory_order_relaxed);
+    total_bytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void ProgressReporter::stop() {
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex);
+        if (stopping) {
+            return;
         }
+        stopping = true;
+    }
+    wake.notify_all();
+    if (thread.joinable()) {
+        thread.join();
+    }
+    render();
+    if (raw_output && total_files.load() > 0) {
+        std::cout << std::endl;
+    }
+}
+
+void ProgressReporter::run() {
+    std::unique_lock<std::mutex> lock(wake_mutex);
+    while (!wake.wait_for(lock, interval, [this] { return stopping; })) {
+        lock.unlock();
+        render();
+        lock.lock();
+    }
+}
+
+void ProgressReporter::render() {
+    size_t files = files_done.load(std::memory_order_relaxed);
+    size_t files_total = total_files.load(std::memory_order_relaxed);
+    uint64_t in = bytes_in.load(std::memory_order_relaxed);
+    uint64_t out = bytes_out.load(std::memory_order_relaxed);
+    uint64_t bytes_total = total_bytes.load(std::memory_order_relaxed);
+    if (files_total == 0) {
+        return;
+    }
+
+    std::ostringstream line;
+    if (raw_output) {
+        line << files << "/" << files_total << "\r";
     } else {
+        double progress = bytes_total > 0 ? (double)in / bytes_total : (double)files / files_total;
+        if (progress > 1.0) progress = 1.0;
+
         const int bar_width = 30;
-        float progress = (float)current / total;
         int pos = bar_width * progress;
 
-        std::cout << "[";
-        if (use_basic_chars) {
-            for (int i = 0; i < bar_width; ++i) {
-                if (i < pos) std::cout << "=";
-                else if (i == pos) std::cout << ">";
-                else std::cout << " ";
+        line << "[";
+        for (int i = 0; i < bar_width; ++i) {
+            if (use_basic_chars) {
+                line << (i < pos ? "=" : (i == pos ? ">" : " "));
+            } else {
+                line << (i < pos ? "█" : "░");
             }
-        } else {
-            for (int i = 0; i < bar_width; ++i) {
-                if (i < pos) std::cout << "█";
-                else std::cout << "░";
+        }
+        line << "] " << std::fixed << std::setprecision(1) << progress * 100.0 << "% ("
+             << files << "/" << files_total << ")";
+
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+        if (elapsed > 0) {
+            line << " " << format_size((uint64_t)(in / elapsed)) << "/s";
+            if (progress > 0 && progress < 1.0) {
+                line << " ETA " << std::setprecision(1) << elapsed * (1.0 - progress) / progress << "s";
             }
         }
-        std::cout << "] " << std::fixed << std::setprecision(1) << progress * 100.0 << "% ("
-                  << current << "/" << total << ") - Added file '" << file_path 
-                  << "' (" << format_size(file_size) << ")";
 
         if (g_detailed_progress_bar) {
-            double ratio = 0;
-            if (file_size > 0) {
-                ratio = 100.0 * (1.0 - (double)compressed_size / file_size);
+            if (in > 0 && out > 0) {
+                double ratio = 100.0 * (1.0 - (double)out / in);
+                line << " (Ratio: " << std::setprecision(1) << ratio << "%)";
             }
-            std::cout << " (Ratio: " << std::fixed << std::setprecision(1) << ratio << "%)";
-
-            auto now = std::chrono::steady_clock::now();
-            auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - start_time).count();
-            if (current > 0 && elapsed > 0) {
-                double time_per_file = (double)elapsed / current;
-                double remaining_time = time_per_file * (total - current) / 1000.0;
-                std::cout << " (ETA: " << std::fixed << std::setprecision(1) << remaining_time << "s)";
+            std::lock_guard<std::mutex> lock(current_file_mutex);
+            if (!current_file.empty()) {
+                line << " - '" << current_file << "'";
             }
         }
-        std::cout << "\r";
-        
-        std::cout.flush();
-        if (current == total) {
-            std::cout << std::endl;
-        }
+        // Clear whatever a longer previous line left behind.
+        line << "\033[K\r";
+    }
+
+    if (output_mutex) {
+        std::lock_guard<std::mutex> lock(*output_mutex);
+        std::cout << line.str() << std::flush;
+    } else {
+        std::cout << line.str() << std::flush;
     }
 }
 
@@ -4,8 +4,14 @@
 #include <prism/hashing/xxhash.h>
 #include <prism/hashing/crc.h>
 #include <prism/hashing/blake3.h>
+#include <openssl/evp.h>
+#include <xxhash.h>
+#include <zlib.h>
+#include <blake3.h>
 #include <stdexcept>
 #include <fstream>
+#include <sstream>
+#include <iomanip>
 
 namespace prism {
 namespace hashing {
@@ -14,6 +20,7 @@ namespace hashing {
 namespace internal {
     std::string calculate_openssl_hash(const std::string& file_path, prism::core::HashType hash_type);
     std::string calculate_openssl_hash_from_data(const std::vector<char>& data, prism::core::HashType hash_type);
+    const EVP_MD* get_evp_md(core::HashType hash_type);
 }
 
 std::string calculate_hash(const std::string& file_path, prism::core::HashType hash_type) {
@@ -73,5 +80,107 @@ std::string calculate_hash_from_data(const std::vector<char>& data, prism::core:
     }
 }
 
+
+struct StreamHasher::State {
+    core::HashType hash_type;
+    uint64_t total = 0;
+    EVP_MD_CTX* evp = nullptr;
+    XXH3_state_t* xxh = nullptr;
+    uLong crc32_value = 0;
+    uint64_t crc64_value = 0;
+    blake3_hasher blake3;
+};
+
+StreamHasher::StreamHasher(core::HashType hash_type) : state_(new State) {
+    state_->hash_type = hash_type;
+    switch (hash_type) {
+        case core::HashType::XXHASH3:
+            state_->xxh = XXH3_createState();
+            XXH3_64bits_reset(state_->xxh);
+            break;
+        case core::HashType::XXHASH128:
+            state_->xxh = XXH3_createState();
+            XXH3_128bits_reset(state_->xxh);
+            break;
+        case core::HashType::CRC32:
+            state_->crc32_value = crc32(0L, Z_NULL, 0);
+            break;
+        case core::HashType::BLAKE3:
+            blake3_hasher_init(&state_->blake3);
+            break;
+        default:
+            if (const EVP_MD* md = internal::get_evp_md(hash_type)) {
+                state_->evp = EVP_MD_CTX_new();
+                EVP_DigestInit_ex(state_->evp, md, nullptr);
+            }
+            break;
+    }
+}
+
+StreamHasher::~StreamHasher() {
+    if (state_->evp) EVP_MD_CTX_free(state_->evp);
+    if (state_->xxh) XXH3_freeState(state_->xxh);
+}
+
+void StreamHasher::update(const char* data, size_t size) {
+    if (size == 0) return;
+    state_->total += size;
+    switch (state_->hash_type) {
+        case core::HashType::XXHASH3: XXH3_64bits_update(state_->xxh, data, size); break;
+        case core::HashType::XXHASH128: XXH3_128bits_update(state_->xxh, data, size); break;
+        case core::HashType::CRC32:
+            state_->crc32_value = crc32(state_->crc32_value, reinterpret_cast<const Bytef*>(data), size);
+            break;
+        case core::HashType::CRC64:
+            state_->crc64_value = crc64_ecma_update(state_->crc64_value, reinterpret_cast<const unsigned char*>(data), size);
+            break;
+        case core::HashType::BLAKE3: blake3_hasher_update(&state_->blake3, data, size); break;
+        default:
+            if (state_->evp) EVP_DigestUpdate(state_->evp, data, size);
+            break;
+    }
+}
+
+std::string StreamHasher::finish() {
+    // Empty inputs have per-algorithm conventions; defer to the one-shot path.
+    if (state_->total == 0) return calculate_hash_from_data({}, state_->hash_type);
+
+    std::stringstream ss;
+    ss << std::hex << std::setfill('0');
+    switch (state_->hash_type) {
+        case core::HashType::NONE:
+            return "";
+        case core::HashType::XXHASH3:
+            ss << std::setw(16) << XXH3_64bits_digest(state_->xxh);
+            break;
+        case core::HashType::XXHASH128: {
+            XXH128_hash_t hash = XXH3_128bits_digest(state_->xxh);
+            ss << std::setw(16) << hash.high64 << std::setw(16) << hash.low64;
+            break;
+        }
+        case core::HashType::CRC32:
+            ss << std::setw(8) << state_->crc32_value;
+            break;
+        case core::HashType::CRC64:
+            ss << std::setw(16) << state_->crc64_value;
+            break;
+        case core::HashType::BLAKE3: {
+            uint8_t output[BLAKE3_OUT_LEN];
+            blake3_hasher_finalize(&state_->blake3, output, BLAKE3_OUT_LEN);
+            for (size_t i = 0; i < BLAKE3_OUT_LEN; i++) ss << std::setw(2) << (int)output[i];
+            break;
+        }
+        default: {
+            if (!state_->evp) return "";
+            unsigned char hash[EVP_MAX_MD_SIZE];
+            unsigned int hash_len;
+            EVP_DigestFinal_ex(state_->evp, hash, &hash_len);
+            for (unsigned int i = 0; i < hash_len; i++) ss << std::setw(2) << (int)hash[i];
+            break;
+        }
+    }
+    return ss.str();
+}
+
 } 
-} 
+}
@@ -60,7 +60,7 @@ std::string calculate_openssl_hash_from_data(const std::vector<char>& data, core
 std::string calculate_openssl_hash(const std::string& file_path, core::HashType hash_type) {
     if (hash_type == core::HashType::NONE) return "";
     
-    core::log("Starting hash calculation for '" + file_path + "'...", core::LOG_VERBOSE);
+    PRISM_LOG(core::LOG_VERBOSE, "Starting hash calculation for '" + file_path + "'...");
     
     std::ifstream file(file_path, std::ios::binary | std::ios::ate);
     if (!file) {
@@ -76,7 +76,7 @@ std::string calculate_openssl_hash(const std::string& file_path, core::HashType
     }
     
     std::string hash_result = calculate_openssl_hash_from_data(data, hash_type);
-    core::log("Finished hash calculation for '" + file_path + "'.", core::LOG_VERBOSE);
+    PRISM_LOG(core::LOG_VERBOSE, "Finished hash calculation for '" + file_path + "'.");
     return hash_result;
 }
 